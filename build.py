@@ -57,6 +57,11 @@ def run(system, configuration):
   assert os.system(f"build{bar}{system}{bar}sprout_editor{bar}sprout_editor_{configuration}") == 0
   return
 
+# ----- Cook -----
+def cook(system, configuration, asset_directory):
+  assert os.system(f"build{bar}{system}{bar}magnolia_cook{bar}magnolia_cook_{configuration} {asset_directory}") == 0
+  return
+
 # ----- Clean -----
 def clean(configuration):
   assert os.system(f"cd build && make clean config={configuration}") == 0
@@ -66,6 +71,7 @@ def clean(configuration):
 def format():
   os.system(f"find magnolia/src/ -iname *.hpp -o -iname *.cpp -o -iname *.h | xargs clang-format -i -style=file")
   os.system(f"find sprout_editor/src/ -iname *.hpp -o -iname *.cpp -o -iname *.h | xargs clang-format -i -style=file")
+  os.system(f"find magnolia_cook/src/ -iname *.hpp -o -iname *.cpp -o -iname *.h | xargs clang-format -i -style=file")
   return
 
 # ----- Lint -----
@@ -146,6 +152,14 @@ def main():
     elif command == "lint":
       lint()
 
+    elif command == "cook":
+      if len(sys.argv) < 4:
+        print("Usage: <command> <configuration> <asset_directory>")
+        return
+
+      asset_directory = str(sys.argv[3])
+      cook(system, configuration, asset_directory)
+
     elif command == "scripts":
       if len(sys.argv) < 4:
         print("Usage: <command> <configuration> <target>")
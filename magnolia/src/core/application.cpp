@@ -8,6 +8,7 @@
 #include "platform/file_system.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/shader.hpp"
+#include "resources/asset_graph.hpp"
 #include "resources/image.hpp"
 #include "resources/material.hpp"
 #include "resources/model.hpp"
@@ -33,6 +34,7 @@ namespace mag
             unique<Renderer> renderer;
             unique<FileWatcher> file_watcher;
             unique<JobSystem> job_system;
+            unique<AssetGraph> asset_graph;
             unique<TextureManager> texture_loader;
             unique<MaterialManager> material_manager;
             unique<ModelManager> model_manager;
@@ -56,6 +58,9 @@ namespace mag
         ivec2 window_position = WindowOptions::CenterPos;
         str window_title = "Magnolia";
         str window_icon = "";
+        b8 cpu_mip_generation = true;
+        b8 indirect_draws = true;
+        u64 texture_streaming_budget = DEFAULT_TEXTURE_STREAMING_BUDGET;
 
         if (fs::read_json_data(config_file_path, config))
         {
@@ -75,6 +80,27 @@ namespace mag
 
             window_title = config["WindowTitle"].get<str>();
             window_icon = config["WindowIcon"].get<str>();
+
+            // Assets are read from the packs before the loose files (see PackFile)
+            if (config.contains("PackFiles"))
+            {
+                for (const auto& pack_file_path : config["PackFiles"])
+                {
+                    fs::mount(pack_file_path.get<str>());
+                }
+            }
+
+            // Mips of source images are generated on the GPU otherwise (i.e. to compare both)
+            cpu_mip_generation = config.value("CpuMipGeneration", cpu_mip_generation);
+
+            // Passes submit their draws with indirect draws when supported (disable to compare both)
+            indirect_draws = config.value("IndirectDraws", indirect_draws);
+
+            // GPU memory for textures in megabytes, unused textures and mips are evicted past it
+            if (config.contains("TextureStreamingBudget"))
+            {
+                texture_streaming_budget = config["TextureStreamingBudget"].get<u64>() * 1024 * 1024;
+            }
         }
 
         // Set target frame rate
@@ -89,6 +115,7 @@ namespace mag
 
         // Create the renderer
         impl->renderer = create_unique<Renderer>(*impl->window);
+        impl->renderer->set_indirect_draws(indirect_draws);
         LOG_SUCCESS("Renderer initialized");
 
         // Create the file watcher
@@ -99,8 +126,14 @@ namespace mag
         impl->job_system = create_unique<JobSystem>(std::thread::hardware_concurrency());
         LOG_SUCCESS("JobSystem initialized");
 
+        // Create the asset graph (the managers add the dependencies of the assets they load)
+        impl->asset_graph = create_unique<AssetGraph>();
+        LOG_SUCCESS("AssetGraph initialized");
+
         // Create the texture manager
         impl->texture_loader = create_unique<TextureManager>();
+        impl->texture_loader->set_cpu_mip_generation(cpu_mip_generation);
+        impl->texture_loader->set_streaming_budget(texture_streaming_budget);
         LOG_SUCCESS("TextureManager initialized");
 
         // Create the material manager
@@ -149,6 +182,10 @@ namespace mag
             }
 
             impl->job_system->process_callbacks();
+            impl->texture_loader->update();
+            impl->material_manager->update();
+            impl->model_manager->update();
+            impl->asset_graph->update();
 
             // Update the user application
             on_update(dt);
@@ -194,6 +231,7 @@ namespace mag
     Renderer& Application::get_renderer() { return *impl->renderer; }
     FileWatcher& Application::get_file_watcher() { return *impl->file_watcher; }
     JobSystem& Application::get_job_system() { return *impl->job_system; }
+    AssetGraph& Application::get_asset_graph() { return *impl->asset_graph; }
     TextureManager& Application::get_texture_manager() { return *impl->texture_loader; }
     MaterialManager& Application::get_material_manager() { return *impl->material_manager; }
     ModelManager& Application::get_model_manager() { return *impl->model_manager; }
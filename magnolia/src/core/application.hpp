@@ -8,6 +8,7 @@ namespace mag
     class Renderer;
     class FileWatcher;
     class JobSystem;
+    class AssetGraph;
 
     class ShaderManager;
     class TextureManager;
@@ -38,6 +39,7 @@ namespace mag
             Renderer& get_renderer();
             FileWatcher& get_file_watcher();
             JobSystem& get_job_system();
+            AssetGraph& get_asset_graph();
             TextureManager& get_texture_manager();
             MaterialManager& get_material_manager();
             ModelManager& get_model_manager();
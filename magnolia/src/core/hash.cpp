@@ -0,0 +1,26 @@
+#include "core/hash.hpp"
+
+#include "core/buffer.hpp"
+
+namespace mag
+{
+#define FNV_PRIME 0x100000001b3
+
+    u64 hash_data(const void* data, const u64 size, const u64 seed)
+    {
+        const u8* bytes = static_cast<const u8*>(data);
+
+        u64 hash = seed;
+        for (u64 i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    u64 hash_buffer(const Buffer& buffer) { return hash_data(buffer.data.data(), buffer.get_size()); }
+
+    u64 hash_string(const str& string) { return hash_data(string.data(), string.size()); }
+};  // namespace mag
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    struct Buffer;
+
+    // 64 bit FNV-1a. Not cryptographic, only used to detect changes in asset contents.
+    u64 hash_data(const void* data, const u64 size, const u64 seed = 0xcbf29ce484222325);
+    u64 hash_buffer(const Buffer& buffer);
+    u64 hash_string(const str& string);
+};  // namespace mag
@@ -72,6 +72,7 @@ constexpr ref<T> create_ref(Args&&... args)
 const u32 Invalid_ID = 1e9;
 const u64 Timeout = 1'000'000'000; /* 1 second in nanoseconds */
 const u32 Max_U32 = 0xFFFFFFFF;
+const u64 Max_U64 = 0xFFFFFFFFFFFFFFFF;
 const i32 Max_I32 = 0xFFFFFFFF / 2;
 
 // Common macros
@@ -8,16 +8,14 @@ namespace mag
     using namespace mag::math;
 
     ECS::ECS(const u32 max_entity_id, ComponentAddedCallbackFn on_component_added)
-        : on_component_added(on_component_added)
+        : max_entity_id(max_entity_id), on_component_added(on_component_added)
     {
-        for (u32 id = 0; id <= max_entity_id; id++)
-        {
-            available_ids.insert(id);
-        }
     }
 
     ECS::ECS(const ECS& other)
     {
+        max_entity_id = other.max_entity_id;
+        next_id = other.next_id;
         available_ids = other.available_ids;
         entities = copy_entities(other.entities);
         component_map = other.component_map;
@@ -29,10 +27,20 @@ namespace mag
     // Return a new id (create a new entity)
     u32 ECS::create_entity(const str& name)
     {
-        ASSERT(!available_ids.empty(), "No available IDs left");
+        ASSERT(!available_ids.empty() || next_id <= max_entity_id, "No available IDs left");
 
-        const u32 id = *available_ids.begin();
-        available_ids.erase(id);
+        // Reuse the lowest freed id, the freed ids are always lower than the next one
+        u32 id = next_id;
+        if (!available_ids.empty())
+        {
+            id = *available_ids.begin();
+            available_ids.erase(available_ids.begin());
+        }
+
+        else
+        {
+            next_id++;
+        }
 
         entities[id] = Entity();
 
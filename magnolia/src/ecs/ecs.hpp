@@ -68,7 +68,7 @@ namespace mag
 
                 if (!entity_exists(entity_id)) return nullptr;
 
-                auto& entity = entities[entity_id];
+                auto& entity = entities.at(entity_id);
 
                 // Search for the component
                 for (auto& c : entity)
@@ -91,7 +91,14 @@ namespace mag
 
                 std::vector<T*> components;
 
-                for (auto& id : component_map[typeid(T)])
+                // Queries never insert into the maps, so passes may run them from several threads
+                auto it = component_map.find(typeid(T));
+                if (it == component_map.end())
+                {
+                    return components;
+                }
+
+                for (auto& id : it->second)
                 {
                     if (auto c = get_component<T>(id))
                     {
@@ -119,7 +126,8 @@ namespace mag
                     // Check if entity has all components
                     for (auto& component_type : component_types)
                     {
-                        if (component_map[component_type].find(id) == component_map[component_type].end())
+                        auto it = component_map.find(component_type);
+                        if (it == component_map.end() || !it->second.contains(id))
                         {
                             has_all_components = false;
                             break;
@@ -173,7 +181,10 @@ namespace mag
         private:
             std::map<u32, Entity> copy_entities(const std::map<u32, Entity>& source);
 
-            // Entities IDs
+            // Entities IDs. Ids are only handed out when needed so big limits don't cost anything, the freed ones are
+            // reused first.
+            u32 max_entity_id;
+            u32 next_id = 0;
             std::set<u32> available_ids;
 
             // Table of entities
@@ -1,19 +1,104 @@
 #include "platform/file_system.hpp"
 
+#include <array>
+#include <atomic>
 #include <fstream>
 #include <mutex>
+#include <set>
+#include <thread>
 
 #include "core/buffer.hpp"
 #include "core/logger.hpp"
+#include "platform/pack_file.hpp"
+
+#if MAG_PLATFORM_LINUX
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
 
 namespace mag
 {
+#define FILE_WATCHER_DEBOUNCE 50        // Milliseconds without changes before they are handed over
+#define FILE_WATCHER_POLL_INTERVAL 20   // Milliseconds, platforms without file events
+#define FILE_WATCHER_MAX_BATCHES 64
+
     namespace fs
     {
+        // Mounted pack files, the last one is searched first
+        static std::vector<ref<PackFile>> mounted_packs;
+        static std::mutex packs_mutex;
+
+        // The pack is kept alive by the ref while it is read, even if it is unmounted by another thread
+        static ref<PackFile> find_pack(const std::filesystem::path& file_path, str& normalized_path)
+        {
+            std::vector<ref<PackFile>> packs;
+            {
+                std::lock_guard<std::mutex> lock(packs_mutex);
+                if (mounted_packs.empty())
+                {
+                    return nullptr;
+                }
+
+                packs = mounted_packs;
+            }
+
+            normalized_path = get_normalized_path(file_path).string();
+
+            for (auto it = packs.rbegin(); it != packs.rend(); it++)
+            {
+                if ((*it)->contains(normalized_path))
+                {
+                    return *it;
+                }
+            }
+
+            return nullptr;
+        }
+
+        b8 mount(const std::filesystem::path& raw_pack_file_path)
+        {
+            const str pack_file_path = get_fixed_path(raw_pack_file_path).string();
+
+            auto pack = create_ref<PackFile>();
+            if (!pack->open(pack_file_path))
+            {
+                LOG_ERROR("Failed to mount pack file: '{0}'", pack_file_path);
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(packs_mutex);
+
+            // Mounting the same pack again reopens it
+            std::erase_if(mounted_packs, [&pack_file_path](const ref<PackFile>& mounted_pack)
+                          { return mounted_pack->get_file_path() == pack_file_path; });
+
+            mounted_packs.push_back(pack);
+
+            LOG_SUCCESS("Mounted pack file: '{0}'", pack_file_path);
+            return true;
+        }
+
+        void unmount(const std::filesystem::path& raw_pack_file_path)
+        {
+            const str pack_file_path = get_fixed_path(raw_pack_file_path).string();
+
+            std::lock_guard<std::mutex> lock(packs_mutex);
+            std::erase_if(mounted_packs, [&pack_file_path](const ref<PackFile>& mounted_pack)
+                          { return mounted_pack->get_file_path() == pack_file_path; });
+        }
+
         b8 read_binary_data(const std::filesystem::path& raw_file_path, Buffer& buffer)
         {
             const auto file_path = get_fixed_path(raw_file_path);
 
+            str normalized_path = "";
+            if (auto pack = find_pack(file_path, normalized_path))
+            {
+                return pack->read(normalized_path, buffer);
+            }
+
             std::ifstream file(file_path, std::ios::binary | std::ios::ate);
 
             // Failed to open the file
@@ -42,6 +127,39 @@ namespace mag
             return true;
         }
 
+        b8 read_binary_data(const std::filesystem::path& raw_file_path, const u64 offset, const u64 size,
+                            Buffer& buffer)
+        {
+            const auto file_path = get_fixed_path(raw_file_path);
+
+            str normalized_path = "";
+            if (auto pack = find_pack(file_path, normalized_path))
+            {
+                return pack->read(normalized_path, offset, size, buffer);
+            }
+
+            std::ifstream file(file_path, std::ios::binary);
+
+            if (!file)
+            {
+                LOG_ERROR("Failed to open file: '{0}'", file_path.string());
+                return false;
+            }
+
+            buffer.data.resize(size);
+
+            file.seekg(offset);
+            file.read(buffer.cast<c8>(), size);
+
+            if (!file)
+            {
+                LOG_ERROR("Failed to read {0} bytes at offset {1} of file: '{2}'", size, offset, file_path.string());
+                return false;
+            }
+
+            return true;
+        }
+
         b8 write_binary_data(const std::filesystem::path& raw_file_path, Buffer& buffer)
         {
             const auto file_path = get_fixed_path(raw_file_path);
@@ -70,16 +188,31 @@ namespace mag
         {
             const auto file_path = get_fixed_path(raw_file_path);
 
-            // Parse data from the json file
-            std::ifstream file(file_path);
-
-            if (!file)
+            str normalized_path = "";
+            if (auto pack = find_pack(file_path, normalized_path))
             {
-                LOG_ERROR("Failed to open file: '{0}'", file_path.string());
-                return false;
+                Buffer buffer;
+                if (!pack->read(normalized_path, buffer))
+                {
+                    return false;
+                }
+
+                data = json::parse(buffer.data.begin(), buffer.data.end(), nullptr, false);
             }
 
-            data = json::parse(file, nullptr, false);
+            else
+            {
+                // Parse data from the json file
+                std::ifstream file(file_path);
+
+                if (!file)
+                {
+                    LOG_ERROR("Failed to open file: '{0}'", file_path.string());
+                    return false;
+                }
+
+                data = json::parse(file, nullptr, false);
+            }
 
             if (data.is_discarded())
             {
@@ -131,16 +264,70 @@ namespace mag
             return fixed_path;
         }
 
+        std::filesystem::path get_normalized_path(const std::filesystem::path& raw_file_path)
+        {
+            const auto file_path = get_fixed_path(raw_file_path);
+
+            // Resolves the existing part of the path, the rest is only normalized lexically
+            std::error_code error;
+            const auto normalized_path = std::filesystem::proximate(file_path, error);
+            if (error)
+            {
+                return file_path.lexically_normal();
+            }
+
+            return get_fixed_path(normalized_path);
+        }
+
+        str get_output_directory()
+        {
+            const str last_folder = std::filesystem::current_path().filename().string();
+            if (last_folder != "Magnolia")
+            {
+                return "";
+            }
+
+#if MAG_PLATFORM_WINDOWS
+            return "build/windows/";
+#else
+            return "build/linux/";
+#endif
+        }
+
+        str get_tool_path(const str& tool_name)
+        {
+#if MAG_PLATFORM_WINDOWS
+            return "ext/windows/" + tool_name + ".exe";
+#else
+            return "ext/linux/" + tool_name;
+#endif
+        }
+
         str get_file_extension(const std::filesystem::path& raw_file_path)
         {
             const auto file_path = get_fixed_path(raw_file_path);
             return file_path.extension().c_str();
         }
 
+        std::filesystem::file_time_type get_last_write_time(const std::filesystem::path& raw_file_path)
+        {
+            const auto file_path = get_fixed_path(raw_file_path);
+
+            str normalized_path = "";
+            if (auto pack = find_pack(file_path, normalized_path))
+            {
+                return std::filesystem::last_write_time(pack->get_file_path());
+            }
+
+            return std::filesystem::last_write_time(file_path);
+        }
+
         b8 exists(const std::filesystem::path& raw_file_path)
         {
             const auto path = get_fixed_path(raw_file_path);
-            return std::filesystem::exists(path);
+
+            str normalized_path = "";
+            return std::filesystem::exists(path) || find_pack(path, normalized_path);
         }
 
         b8 is_directory(const std::filesystem::path& raw_file_path)
@@ -150,91 +337,386 @@ namespace mag
         }
     };  // namespace fs
 
-    FileWatcher::FileWatcher()
+    struct FileWatcher::IMPL
+    {
+            // Consumer side, called with the files mutex locked so there is only one consumer at a time
+            void process_batches();
+            void process_changed_file(const str& file_path);
+
+            // Producer side (watcher thread). Returns false if there is no room for the batch yet.
+            b8 publish_batch(std::set<str>& changed_files);
+
+            std::thread watcher_thread;
+            std::atomic<b8> running = true;
+
+            // Watched file -> last write time seen
+            std::map<str, std::filesystem::file_time_type> files_on_watch;
+            std::set<str> modified_files;
+            std::mutex files_mutex;
+
+            // Batches of changed files, handed from the watcher thread to the users without locks (single producer
+            // and single consumer ring). An empty path means events were lost and every file must be checked.
+            std::array<std::vector<str>, FILE_WATCHER_MAX_BATCHES> batches;
+            std::atomic<u64> batches_head = 0;  // Next batch to be consumed
+            std::atomic<u64> batches_tail = 0;  // Next batch to be produced
+
+#if MAG_PLATFORM_LINUX
+            void add_directory_watch(const str& directory);
+            void read_events(std::set<str>& changed_files);
+
+            i32 inotify_descriptor = -1;
+            i32 wake_descriptor = -1;  // Wakes the watcher thread up on shutdown
+
+            // The directories of the files are watched, not the files. The same directory may be reached by more
+            // than one path, so a watch descriptor can have many paths.
+            std::map<i32, std::set<str>> watched_directories;
+            std::map<str, i32> directory_watches;
+            std::mutex directories_mutex;
+#endif
+    };
+
+    FileWatcher::FileWatcher() : impl(new FileWatcher::IMPL())
     {
-        running = true;
+#if MAG_PLATFORM_LINUX
+        impl->inotify_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        impl->wake_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-        watcher_thread = std::thread(
+        if (impl->inotify_descriptor < 0 || impl->wake_descriptor < 0)
+        {
+            LOG_ERROR("Failed to initialize inotify, files will not be watched");
+            return;
+        }
+
+        impl->watcher_thread = std::thread(
             [this]
             {
-                while (running)
+                std::set<str> changed_files;
+                auto last_event_time = std::chrono::steady_clock::now();
+
+                while (impl->running)
                 {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    // Sleep until something happens, or until the changes stop coming to hand them over
+                    i32 timeout = -1;
+                    if (!changed_files.empty())
+                    {
+                        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - last_event_time);
 
-                    std::vector<str> marked_for_removal;
+                        timeout = std::max(FILE_WATCHER_DEBOUNCE - static_cast<i32>(elapsed.count()), 0);
+                    }
 
-                    std::lock_guard<std::mutex> lock(files_mutex);
-                    for (auto& [file_path, file_status] : files_on_watch)
+                    pollfd descriptors[2] = {{impl->inotify_descriptor, POLLIN, 0}, {impl->wake_descriptor, POLLIN, 0}};
+                    if (poll(descriptors, 2, timeout) < 0 && errno != EINTR)
                     {
-                        // Remove files that have been deleted
-                        if (!fs::exists(file_path))
-                        {
-                            marked_for_removal.push_back(file_path);
-                            continue;
-                        }
+                        LOG_ERROR("Failed to wait for file events, files will not be watched anymore");
+                        break;
+                    }
 
-                        auto current_write_time = std::filesystem::last_write_time(file_path);
-                        if (current_write_time != file_status.last_write_time)
+                    if (descriptors[0].revents & POLLIN)
+                    {
+                        impl->read_events(changed_files);
+                        last_event_time = std::chrono::steady_clock::now();
+                    }
+
+                    // Writes usually come in bursts (i.e. big files or editors saving through temporary files), wait
+                    // for the files to settle before handing the batch over
+                    const auto now = std::chrono::steady_clock::now();
+                    if (!changed_files.empty() &&
+                        now - last_event_time >= std::chrono::milliseconds(FILE_WATCHER_DEBOUNCE))
+                    {
+                        // The users did not catch up yet, keep gathering changes and try again later
+                        if (!impl->publish_batch(changed_files))
                         {
-                            file_status.last_write_time = current_write_time;
-                            file_status.modified = true;
+                            last_event_time = now;
                         }
                     }
+                }
+            });
+#else
+        // @TODO: use ReadDirectoryChangesW on windows
+        impl->watcher_thread = std::thread(
+            [this]
+            {
+                while (impl->running)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(FILE_WATCHER_POLL_INTERVAL));
+
+                    std::lock_guard<std::mutex> lock(impl->files_mutex);
+
+                    std::vector<str> file_paths;
+                    for (const auto& file_p : impl->files_on_watch)
+                    {
+                        file_paths.push_back(file_p.first);
+                    }
 
-                    for (const auto& file_path : marked_for_removal)
+                    for (const auto& file_path : file_paths)
                     {
-                        files_on_watch.erase(file_path);
+                        impl->process_changed_file(file_path);
                     }
                 }
             });
+#endif
     }
 
     FileWatcher::~FileWatcher()
     {
-        running = false;
+        impl->running = false;
+
+#if MAG_PLATFORM_LINUX
+        if (impl->wake_descriptor >= 0)
+        {
+            const u64 value = 1;
+            [[maybe_unused]] const auto result = write(impl->wake_descriptor, &value, sizeof(value));
+        }
+#endif
+
+        if (impl->watcher_thread.joinable())
+        {
+            impl->watcher_thread.join();
+        }
+
+#if MAG_PLATFORM_LINUX
+        if (impl->inotify_descriptor >= 0)
+        {
+            close(impl->inotify_descriptor);
+        }
 
-        if (watcher_thread.joinable())
+        if (impl->wake_descriptor >= 0)
         {
-            watcher_thread.join();
+            close(impl->wake_descriptor);
         }
+#endif
     }
 
     void FileWatcher::watch_file(const std::filesystem::path& file_path)
     {
-        std::lock_guard<std::mutex> lock(files_mutex);
-        if (!fs::exists(file_path) || files_on_watch.contains(file_path))
+#if MAG_PLATFORM_LINUX
+        // Watch the directory before reading the write time so that no change is missed
+        impl->add_directory_watch(file_path.parent_path().string());
+#endif
+
+        // Only loose files are watched, the packed ones don't change
+        std::error_code error;
+        const auto last_write_time = std::filesystem::last_write_time(file_path, error);
+        if (error)
         {
             return;
         }
 
-        files_on_watch[file_path].last_write_time = std::filesystem::last_write_time(file_path);
-        files_on_watch[file_path].modified = false;
+        std::lock_guard<std::mutex> lock(impl->files_mutex);
+        impl->files_on_watch.try_emplace(file_path.string(), last_write_time);
     }
 
     void FileWatcher::stop_watching_file(const std::filesystem::path& file_path)
     {
-        std::lock_guard<std::mutex> lock(files_mutex);
-        if (files_on_watch.contains(file_path))
-        {
-            files_on_watch.erase(file_path);
-        }
+        std::lock_guard<std::mutex> lock(impl->files_mutex);
+        impl->files_on_watch.erase(file_path.string());
+        impl->modified_files.erase(file_path.string());
     }
 
     void FileWatcher::reset_file_status(const std::filesystem::path& file_path)
     {
-        std::unique_lock<std::mutex> lock(files_mutex);
-        if (files_on_watch.contains(file_path))
+        std::lock_guard<std::mutex> lock(impl->files_mutex);
+        impl->process_batches();
+
+        auto it = impl->files_on_watch.find(file_path.string());
+        if (it == impl->files_on_watch.end())
         {
-            lock.unlock();
+            return;
+        }
 
-            stop_watching_file(file_path);
-            watch_file(file_path);
+        // Changes already seen (and the ones still being handed over) are ignored from now on
+        std::error_code error;
+        const auto last_write_time = std::filesystem::last_write_time(file_path, error);
+        if (error)
+        {
+            impl->files_on_watch.erase(it);
         }
+
+        else
+        {
+            it->second = last_write_time;
+        }
+
+        impl->modified_files.erase(file_path.string());
     }
 
     b8 FileWatcher::was_file_modified(const std::filesystem::path& file_path)
     {
-        std::lock_guard<std::mutex> lock(files_mutex);
-        return files_on_watch.contains(file_path) && files_on_watch[file_path].modified;
+        std::lock_guard<std::mutex> lock(impl->files_mutex);
+        impl->process_batches();
+
+        return impl->modified_files.contains(file_path.string());
+    }
+
+    std::vector<str> FileWatcher::get_modified_files()
+    {
+        std::lock_guard<std::mutex> lock(impl->files_mutex);
+        impl->process_batches();
+
+        return std::vector<str>(impl->modified_files.begin(), impl->modified_files.end());
+    }
+
+    void FileWatcher::IMPL::process_batches()
+    {
+        const u64 tail = batches_tail.load(std::memory_order_acquire);
+
+        for (u64 head = batches_head.load(std::memory_order_relaxed); head != tail; head++)
+        {
+            auto& batch = batches[head % FILE_WATCHER_MAX_BATCHES];
+
+            for (const auto& file_path : batch)
+            {
+                if (!file_path.empty())
+                {
+                    process_changed_file(file_path);
+                    continue;
+                }
+
+                // Events were lost, check everything
+                std::vector<str> file_paths;
+                for (const auto& file_p : files_on_watch)
+                {
+                    file_paths.push_back(file_p.first);
+                }
+
+                for (const auto& watched_file_path : file_paths)
+                {
+                    process_changed_file(watched_file_path);
+                }
+            }
+
+            batch.clear();
+            batches_head.store(head + 1, std::memory_order_release);
+        }
+    }
+
+    void FileWatcher::IMPL::process_changed_file(const str& file_path)
+    {
+        // Changes to files in the same directories that are not watched
+        auto it = files_on_watch.find(file_path);
+        if (it == files_on_watch.end())
+        {
+            return;
+        }
+
+        // Remove files that have been deleted
+        std::error_code error;
+        const auto last_write_time = std::filesystem::last_write_time(file_path, error);
+        if (error)
+        {
+            files_on_watch.erase(it);
+            modified_files.erase(file_path);
+            return;
+        }
+
+        // The write time may be the same if the file was only touched or the change was already reset
+        if (last_write_time != it->second)
+        {
+            it->second = last_write_time;
+            modified_files.insert(file_path);
+        }
+    }
+
+    b8 FileWatcher::IMPL::publish_batch(std::set<str>& changed_files)
+    {
+        const u64 tail = batches_tail.load(std::memory_order_relaxed);
+        if (tail - batches_head.load(std::memory_order_acquire) == FILE_WATCHER_MAX_BATCHES)
+        {
+            return false;
+        }
+
+        batches[tail % FILE_WATCHER_MAX_BATCHES].assign(changed_files.begin(), changed_files.end());
+        batches_tail.store(tail + 1, std::memory_order_release);
+
+        changed_files.clear();
+        return true;
+    }
+
+#if MAG_PLATFORM_LINUX
+    void FileWatcher::IMPL::add_directory_watch(const str& directory)
+    {
+        if (inotify_descriptor < 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(directories_mutex);
+        if (directory_watches.contains(directory))
+        {
+            return;
+        }
+
+        // Editors usually save by renaming a temporary file over the old one, so moves count as writes too
+        const u32 mask = IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+        const i32 watch_descriptor =
+            inotify_add_watch(inotify_descriptor, directory.empty() ? "." : directory.c_str(), mask);
+
+        if (watch_descriptor < 0)
+        {
+            LOG_ERROR("Failed to watch directory: '{0}'", directory);
+            return;
+        }
+
+        watched_directories[watch_descriptor].insert(directory);
+        directory_watches[directory] = watch_descriptor;
+    }
+
+    void FileWatcher::IMPL::read_events(std::set<str>& changed_files)
+    {
+        alignas(inotify_event) c8 events[4096];
+
+        while (true)
+        {
+            const i64 length = read(inotify_descriptor, events, sizeof(events));
+            if (length <= 0)
+            {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(directories_mutex);
+
+            const inotify_event* event = nullptr;
+            for (i64 offset = 0; offset < length; offset += sizeof(inotify_event) + event->len)
+            {
+                event = reinterpret_cast<const inotify_event*>(events + offset);
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    changed_files.insert("");
+                    continue;
+                }
+
+                auto it = watched_directories.find(event->wd);
+                if (it == watched_directories.end())
+                {
+                    continue;
+                }
+
+                // The directory was removed, it is watched again if one of its files is watched again
+                if (event->mask & IN_IGNORED)
+                {
+                    for (const auto& directory : it->second)
+                    {
+                        directory_watches.erase(directory);
+                    }
+
+                    watched_directories.erase(it);
+                    continue;
+                }
+
+                if (event->len == 0)
+                {
+                    continue;
+                }
+
+                for (const auto& directory : it->second)
+                {
+                    changed_files.insert(directory.empty() ? str(event->name) : directory + "/" + event->name);
+                }
+            }
+        }
     }
+#endif
 };  // namespace mag
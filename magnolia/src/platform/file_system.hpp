@@ -1,6 +1,6 @@
 #pragma once
 
-#include <thread>
+#include <vector>
 
 #include "core/types.hpp"
 #include "nlohmann/json.hpp"
@@ -15,7 +15,13 @@ namespace mag
 
     namespace fs
     {
+        // Pack files (see PackFile) are searched before the loose files, the last one mounted first. Loading the
+        // loose files from the directories is kept for development.
+        b8 mount(const std::filesystem::path& pack_file_path);
+        void unmount(const std::filesystem::path& pack_file_path);
+
         b8 read_binary_data(const std::filesystem::path& file_path, Buffer& buffer);
+        b8 read_binary_data(const std::filesystem::path& file_path, const u64 offset, const u64 size, Buffer& buffer);
         b8 write_binary_data(const std::filesystem::path& file_path, Buffer& buffer);
 
         b8 read_json_data(const std::filesystem::path& file_path, json& data);
@@ -26,10 +32,27 @@ namespace mag
         str get_file_extension(const std::filesystem::path& file_path);
         std::filesystem::path get_fixed_path(const std::filesystem::path& file_path);
 
+        // Same path for every way of reaching a file ('.', '..', symlinks), relative to the working directory when
+        // possible. Used as the key of the cached resources.
+        std::filesystem::path get_normalized_path(const std::filesystem::path& file_path);
+
+        // Files in a pack have the write time of the pack
+        std::filesystem::file_time_type get_last_write_time(const std::filesystem::path& file_path);
+
         b8 exists(const std::filesystem::path& path);
         b8 is_directory(const std::filesystem::path& path);
+
+        // Folder of the build outputs (compiled shaders, scripts, pipeline cache), with a trailing slash if not empty.
+        // The application runs from the build folder, except during development when it runs from the repo root.
+        str get_output_directory();
+
+        // External tools shipped with the engine (i.e. 'glslc'), same as build.py
+        str get_tool_path(const str& tool_name);
     };  // namespace fs
 
+    // Keeps track of the watched files that changed since their status was last reset. On linux the directories of
+    // the files are watched with inotify, so the cost does not grow with the number of files. Changes are gathered
+    // until the files settle and handed over in batches. Other platforms poll the write times of the files.
     class FileWatcher
     {
         public:
@@ -42,16 +65,11 @@ namespace mag
 
             b8 was_file_modified(const std::filesystem::path& file_path);
 
+            // All watched files that were modified, cheaper than asking for each file
+            std::vector<str> get_modified_files();
+
         private:
-            struct FileStatus
-            {
-                    b8 modified = false;
-                    std::filesystem::file_time_type last_write_time;
-            };
-
-            std::thread watcher_thread;
-            std::map<str, FileStatus> files_on_watch;
-            std::mutex files_mutex;
-            b8 running;
+            struct IMPL;
+            unique<IMPL> impl;
     };
 };  // namespace mag
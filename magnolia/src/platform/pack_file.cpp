@@ -0,0 +1,513 @@
+#include "platform/pack_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "core/buffer.hpp"
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+#include "platform/file_system.hpp"
+
+#if MAG_PLATFORM_LINUX
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace mag
+{
+#define PACK_FILE_MAGIC 0x4b41504d  // "MPAK"
+#define PACK_FILE_VERSION 1
+
+// LZ4 constants (see the block format description in the LZ4 repository)
+#define LZ4_MIN_MATCH 4
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_LAST_LITERALS 5  // The last bytes of a block are always literals
+#define LZ4_MATCH_LIMIT 12   // The last match starts at least this many bytes before the end of the block
+#define LZ4_HASH_BITS 16
+
+    struct PackFileHeader
+    {
+            u32 magic;
+            u32 version;
+            u64 entry_count;
+            u64 index_offset;
+    };
+
+    struct PackEntry
+    {
+            u64 path_hash;
+            u64 offset;
+            u64 size;         // Uncompressed
+            u64 stored_size;  // Size in the pack
+            u32 compression;
+            u32 padding;
+    };
+
+    static void write_lz4_length(std::vector<u8>& output, u64 length)
+    {
+        while (length >= 255)
+        {
+            output.push_back(255);
+            length -= 255;
+        }
+
+        output.push_back(static_cast<u8>(length));
+    }
+
+    static void write_lz4_sequence(std::vector<u8>& output, const u8* literals, const u64 literal_length,
+                                   const u64 match_offset, const u64 match_length)
+    {
+        const u64 match_code = match_length > 0 ? match_length - LZ4_MIN_MATCH : 0;
+
+        const u8 token = (std::min<u64>(literal_length, 15) << 4) | std::min<u64>(match_code, 15);
+        output.push_back(token);
+
+        if (literal_length >= 15)
+        {
+            write_lz4_length(output, literal_length - 15);
+        }
+
+        output.insert(output.end(), literals, literals + literal_length);
+
+        // The last sequence only has literals
+        if (match_length == 0)
+        {
+            return;
+        }
+
+        output.push_back(match_offset & 0xff);
+        output.push_back(match_offset >> 8);
+
+        if (match_code >= 15)
+        {
+            write_lz4_length(output, match_code - 15);
+        }
+    }
+
+    // Greedy compressor, a single hash table of the last position of each 4 byte sequence
+    static std::vector<u8> compress_lz4(const u8* data, const u64 size)
+    {
+        std::vector<u8> output;
+        output.reserve(size + size / 255 + 16);
+
+        std::vector<i64> positions(1 << LZ4_HASH_BITS, -1);
+
+        const u64 match_limit = size > LZ4_MATCH_LIMIT ? size - LZ4_MATCH_LIMIT : 0;
+
+        u64 anchor = 0;
+        u64 i = 0;
+        while (i < match_limit)
+        {
+            u32 sequence = 0;
+            memcpy(&sequence, data + i, sizeof(u32));
+
+            const u32 hash = (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            const i64 candidate = positions[hash];
+            positions[hash] = i;
+
+            if (candidate < 0 || i - candidate > LZ4_MAX_OFFSET || memcmp(data + candidate, data + i, sizeof(u32)) != 0)
+            {
+                i++;
+                continue;
+            }
+
+            const u64 max_match_length = size - LZ4_LAST_LITERALS - i;
+
+            u64 match_length = LZ4_MIN_MATCH;
+            while (match_length < max_match_length && data[candidate + match_length] == data[i + match_length])
+            {
+                match_length++;
+            }
+
+            write_lz4_sequence(output, data + anchor, i - anchor, i - candidate, match_length);
+
+            i += match_length;
+            anchor = i;
+        }
+
+        write_lz4_sequence(output, data + anchor, size - anchor, 0, 0);
+
+        return output;
+    }
+
+    static b8 read_lz4_length(const u8* data, const u64 size, u64& position, u64& length)
+    {
+        u8 byte = 255;
+        while (byte == 255)
+        {
+            if (position >= size)
+            {
+                return false;
+            }
+
+            byte = data[position++];
+            length += byte;
+        }
+
+        return true;
+    }
+
+    static b8 decompress_lz4(const u8* data, const u64 size, u8* output, const u64 output_size)
+    {
+        u64 in = 0, out = 0;
+        while (in < size)
+        {
+            const u8 token = data[in++];
+
+            u64 literal_length = token >> 4;
+            if (literal_length == 15 && !read_lz4_length(data, size, in, literal_length))
+            {
+                return false;
+            }
+
+            if (in + literal_length > size || out + literal_length > output_size)
+            {
+                return false;
+            }
+
+            memcpy(output + out, data + in, literal_length);
+            in += literal_length;
+            out += literal_length;
+
+            // Last sequence
+            if (in == size)
+            {
+                break;
+            }
+
+            if (in + 2 > size)
+            {
+                return false;
+            }
+
+            const u64 match_offset = data[in] | (data[in + 1] << 8);
+            in += 2;
+
+            u64 match_length = token & 0xf;
+            if (match_length == 15 && !read_lz4_length(data, size, in, match_length))
+            {
+                return false;
+            }
+
+            match_length += LZ4_MIN_MATCH;
+
+            if (match_offset == 0 || match_offset > out || out + match_length > output_size)
+            {
+                return false;
+            }
+
+            // Matches may overlap the bytes being written (i.e. runs), copy byte by byte
+            for (u64 i = 0; i < match_length; i++)
+            {
+                output[out + i] = output[out - match_offset + i];
+            }
+
+            out += match_length;
+        }
+
+        return out == output_size;
+    }
+
+    struct PackFile::IMPL
+    {
+            const PackEntry* find(const str& normalized_path) const
+            {
+                const u64 path_hash = hash_string(normalized_path);
+
+                auto it =
+                    std::lower_bound(entries, entries + entry_count, path_hash,
+                                     [](const PackEntry& entry, const u64 hash) { return entry.path_hash < hash; });
+
+                if (it == entries + entry_count || it->path_hash != path_hash)
+                {
+                    return nullptr;
+                }
+
+                return it;
+            }
+
+            str file_path = "";
+
+            const u8* data = nullptr;
+            u64 size = 0;
+
+            const PackEntry* entries = nullptr;
+            u64 entry_count = 0;
+
+            // @TODO: memory map the file on windows too, for now it is read whole
+            std::vector<u8> contents;
+    };
+
+    PackFile::PackFile() : impl(new PackFile::IMPL()) {}
+
+    PackFile::~PackFile() { close(); }
+
+    b8 PackFile::open(const str& raw_file_path)
+    {
+        close();
+
+        const str file_path = fs::get_fixed_path(raw_file_path).string();
+
+#if MAG_PLATFORM_LINUX
+        const i32 file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+        if (file_descriptor < 0)
+        {
+            LOG_ERROR("Failed to open pack file: '{0}'", file_path);
+            return false;
+        }
+
+        struct stat file_stat;
+        if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size == 0)
+        {
+            LOG_ERROR("Failed to read pack file: '{0}'", file_path);
+            ::close(file_descriptor);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+        // The mapping stays valid after the file is closed
+        ::close(file_descriptor);
+
+        if (mapping == MAP_FAILED)
+        {
+            LOG_ERROR("Failed to map pack file: '{0}'", file_path);
+            return false;
+        }
+
+        impl->data = static_cast<const u8*>(mapping);
+        impl->size = file_stat.st_size;
+#else
+        Buffer buffer;
+        if (!fs::read_binary_data(file_path, buffer))
+        {
+            return false;
+        }
+
+        impl->contents = std::move(buffer.data);
+        impl->data = impl->contents.data();
+        impl->size = impl->contents.size();
+#endif
+
+        impl->file_path = file_path;
+
+        PackFileHeader header;
+        if (impl->size < sizeof(PackFileHeader))
+        {
+            LOG_ERROR("Invalid pack file: '{0}'", file_path);
+            close();
+            return false;
+        }
+
+        memcpy(&header, impl->data, sizeof(PackFileHeader));
+
+        if (header.magic != PACK_FILE_MAGIC || header.version != PACK_FILE_VERSION ||
+            header.index_offset > impl->size ||
+            header.entry_count > (impl->size - header.index_offset) / sizeof(PackEntry))
+        {
+            LOG_ERROR("Invalid pack file: '{0}'", file_path);
+            close();
+            return false;
+        }
+
+        impl->entries = reinterpret_cast<const PackEntry*>(impl->data + header.index_offset);
+        impl->entry_count = header.entry_count;
+
+        return true;
+    }
+
+    void PackFile::close()
+    {
+#if MAG_PLATFORM_LINUX
+        if (impl->data)
+        {
+            munmap(const_cast<u8*>(impl->data), impl->size);
+        }
+#endif
+
+        impl->contents.clear();
+        impl->data = nullptr;
+        impl->size = 0;
+        impl->entries = nullptr;
+        impl->entry_count = 0;
+        impl->file_path = "";
+    }
+
+    b8 PackFile::contains(const str& normalized_path) const { return impl->find(normalized_path) != nullptr; }
+
+    b8 PackFile::read(const str& normalized_path, Buffer& buffer) const
+    {
+        const PackEntry* entry = impl->find(normalized_path);
+        if (!entry)
+        {
+            return false;
+        }
+
+        return read(normalized_path, 0, entry->size, buffer);
+    }
+
+    b8 PackFile::read(const str& normalized_path, const u64 offset, const u64 size, Buffer& buffer) const
+    {
+        const PackEntry* entry = impl->find(normalized_path);
+        if (!entry)
+        {
+            return false;
+        }
+
+        if (offset + size > entry->size || entry->offset + entry->stored_size > impl->size)
+        {
+            LOG_ERROR("Invalid read of '{0}' from pack file '{1}'", normalized_path, impl->file_path);
+            return false;
+        }
+
+        const u8* stored_data = impl->data + entry->offset;
+
+        switch (static_cast<PackCompression>(entry->compression))
+        {
+            case PackCompression::None:
+                buffer.data.assign(stored_data + offset, stored_data + offset + size);
+                break;
+
+            case PackCompression::LZ4:
+            {
+                // Blocks can't be decompressed partially, the requested range is copied from the whole file
+                std::vector<u8> contents(entry->size);
+                if (!decompress_lz4(stored_data, entry->stored_size, contents.data(), contents.size()))
+                {
+                    LOG_ERROR("Failed to decompress '{0}' from pack file '{1}'", normalized_path, impl->file_path);
+                    return false;
+                }
+
+                if (offset == 0 && size == contents.size())
+                {
+                    buffer.data = std::move(contents);
+                }
+
+                else
+                {
+                    buffer.data.assign(contents.begin() + offset, contents.begin() + offset + size);
+                }
+
+                break;
+            }
+
+            default:
+                LOG_ERROR("Unknown compression of '{0}' in pack file '{1}'", normalized_path, impl->file_path);
+                return false;
+        }
+
+        return true;
+    }
+
+    const str& PackFile::get_file_path() const { return impl->file_path; }
+
+    b8 PackFile::write(const str& raw_file_path, const std::vector<str>& file_paths, const b8 compress)
+    {
+        const str file_path = fs::get_fixed_path(raw_file_path).string();
+
+        std::ofstream file(file_path, std::ios::binary);
+        if (!file)
+        {
+            LOG_ERROR("Failed to open file: '{0}'", file_path);
+            return false;
+        }
+
+        PackFileHeader header = {};
+        header.magic = PACK_FILE_MAGIC;
+        header.version = PACK_FILE_VERSION;
+
+        // Written again once the index is known
+        file.write(reinterpret_cast<const c8*>(&header), sizeof(PackFileHeader));
+
+        std::vector<PackEntry> entries;
+        std::map<u64, str> hashed_paths;
+        u64 offset = sizeof(PackFileHeader);
+
+        for (const auto& entry_file_path : file_paths)
+        {
+            const str normalized_path = fs::get_normalized_path(entry_file_path).string();
+
+            PackEntry entry = {};
+            entry.path_hash = hash_string(normalized_path);
+            entry.offset = offset;
+
+            auto it = hashed_paths.find(entry.path_hash);
+            if (it != hashed_paths.end())
+            {
+                // Same file listed twice
+                if (it->second == normalized_path)
+                {
+                    continue;
+                }
+
+                LOG_ERROR("Paths '{0}' and '{1}' have the same hash", it->second, normalized_path);
+                return false;
+            }
+
+            hashed_paths[entry.path_hash] = normalized_path;
+
+            Buffer buffer;
+            if (!fs::read_binary_data(entry_file_path, buffer))
+            {
+                return false;
+            }
+
+            entry.size = buffer.get_size();
+
+            std::vector<u8> compressed_data;
+            if (compress)
+            {
+                compressed_data = compress_lz4(buffer.data.data(), buffer.get_size());
+            }
+
+            // Keep files that don't shrink by at least 10% uncompressed, not worth the decompression
+            if (compress && compressed_data.size() < buffer.get_size() - buffer.get_size() / 10)
+            {
+                entry.compression = static_cast<u32>(PackCompression::LZ4);
+                entry.stored_size = compressed_data.size();
+                file.write(reinterpret_cast<const c8*>(compressed_data.data()), compressed_data.size());
+            }
+
+            else
+            {
+                entry.compression = static_cast<u32>(PackCompression::None);
+                entry.stored_size = buffer.get_size();
+                file.write(buffer.cast<c8>(), buffer.get_size());
+            }
+
+            offset += entry.stored_size;
+            entries.push_back(entry);
+        }
+
+        std::sort(entries.begin(), entries.end(),
+                  [](const PackEntry& a, const PackEntry& b) { return a.path_hash < b.path_hash; });
+
+        // The index is memory mapped as an array of entries, keep it aligned
+        const u64 padding = (alignof(PackEntry) - offset % alignof(PackEntry)) % alignof(PackEntry);
+        const std::vector<c8> padding_bytes(padding, 0);
+        file.write(padding_bytes.data(), padding);
+
+        header.entry_count = entries.size();
+        header.index_offset = offset + padding;
+
+        file.write(reinterpret_cast<const c8*>(entries.data()), VEC_SIZE_BYTES(entries));
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const c8*>(&header), sizeof(PackFileHeader));
+
+        if (!file)
+        {
+            LOG_ERROR("Failed to write pack file: '{0}'", file_path);
+            return false;
+        }
+
+        LOG_SUCCESS("Packed {0} files into '{1}' ({2:.2f} MiB)", entries.size(), file_path,
+                    (header.index_offset + VEC_SIZE_BYTES(entries)) / (1024.0 * 1024.0));
+
+        return true;
+    }
+};  // namespace mag
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "core/types.hpp"
+
+namespace mag
+{
+#define PACK_FILE_EXTENSION ".pak"
+
+    struct Buffer;
+
+    enum class PackCompression : u32
+    {
+        None = 0,
+        LZ4  // LZ4 block format
+    };
+
+    // Archive of asset files: a header, the contents of the files and an index of path hash -> offset/size/compression
+    // sorted by hash. The files are found by the hash of their normalized path (see fs::get_normalized_path), so the
+    // pack must be written from the same working directory the application runs from. The pack is memory mapped and
+    // the files are read (and decompressed) straight from the mapping. Mounted with fs::mount.
+    class PackFile
+    {
+        public:
+            PackFile();
+            ~PackFile();
+
+            b8 open(const str& file_path);
+            void close();
+
+            b8 contains(const str& normalized_path) const;
+
+            // Whole file or only a range of the uncompressed contents
+            b8 read(const str& normalized_path, Buffer& buffer) const;
+            b8 read(const str& normalized_path, const u64 offset, const u64 size, Buffer& buffer) const;
+
+            const str& get_file_path() const;
+
+            // Files are stored compressed only when it is worth it (i.e. BCn textures barely compress)
+            static b8 write(const str& file_path, const std::vector<str>& file_paths, const b8 compress = true);
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
@@ -5,6 +5,7 @@
 #include "core/logger.hpp"
 #include "renderer/render_graph.hpp"
 #include "renderer/sampler.hpp"
+#include "resources/image.hpp"
 
 namespace mag
 {
@@ -319,6 +320,44 @@ namespace mag
         }
     }
 
+    vk::Format mag_to_vk(const TextureFormat format, const ColorSpace color_space)
+    {
+        const b8 srgb = color_space == ColorSpace::Srgb;
+
+        switch (format)
+        {
+            case TextureFormat::R8:
+                return srgb ? vk::Format::eR8Srgb : vk::Format::eR8Unorm;
+                break;
+
+            case TextureFormat::RG8:
+                return srgb ? vk::Format::eR8G8Srgb : vk::Format::eR8G8Unorm;
+                break;
+
+            case TextureFormat::BC1:
+                return srgb ? vk::Format::eBc1RgbaSrgbBlock : vk::Format::eBc1RgbaUnormBlock;
+                break;
+
+            case TextureFormat::BC3:
+                return srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+                break;
+
+            // BC5 has no sRGB variant
+            case TextureFormat::BC5:
+                return vk::Format::eBc5UnormBlock;
+                break;
+
+            case TextureFormat::BC7:
+                return srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+                break;
+
+            default:
+                LOG_ERROR("Invalid texture format");
+                return vk::Format::eR8G8B8A8Srgb;
+                break;
+        }
+    }
+
     vk::PrimitiveTopology str_to_vk_topology(const str& topology)
     {
         if (topology == "Triangle") return vk::PrimitiveTopology::eTriangleList;
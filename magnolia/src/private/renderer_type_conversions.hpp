@@ -40,6 +40,12 @@ namespace mag
     AttachmentType vk_to_mag(const vk::ImageAspectFlagBits image_aspect);
     vk::ImageAspectFlags mag_to_vk(const AttachmentType image_aspect);
 
+    enum class TextureFormat;
+    enum class ColorSpace;
+
+    // Uncompressed formats depend on the device, see Context::get_supported_color_format
+    vk::Format mag_to_vk(const TextureFormat format, const ColorSpace color_space);
+
     vk::PrimitiveTopology str_to_vk_topology(const str& topology);
     vk::PolygonMode str_to_vk_polygon_mode(const str& polygon_mode);
     vk::CullModeFlags str_to_vk_cull_mode(const str& cull_mode);
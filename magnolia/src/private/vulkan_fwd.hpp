@@ -64,6 +64,7 @@ namespace vk
     class ImageView;
     class Instance;
     class PhysicalDevice;
+    class PipelineCache;
     class PipelineLayout;
     class Queue;
     class Semaphore;
@@ -0,0 +1,190 @@
+#include "renderer/bindless_textures.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+
+#include "core/logger.hpp"
+#include "renderer/context.hpp"
+#include "renderer/renderer_image.hpp"
+#include "renderer/sampler.hpp"
+
+namespace mag
+{
+    struct BindlessTextures::IMPL
+    {
+            vk::DescriptorImageInfo get_image_info(const RendererImage& image) const;
+
+            u32 capacity = 0;
+
+            vk::DescriptorPool descriptor_pool;
+            vk::DescriptorSetLayout descriptor_set_layout;
+
+            // One per frame in flight
+            std::vector<vk::DescriptorSet> descriptor_sets;
+            std::vector<std::map<u32, vk::DescriptorImageInfo>> pending_writes;
+            std::vector<std::vector<b8>> written_slots;
+
+            std::vector<u32> free_slots;
+            u32 next_slot = 0;
+    };
+
+    BindlessTextures::BindlessTextures() : impl(new IMPL())
+    {
+        auto& context = get_context();
+        auto& device = context.get_device();
+        const u32 frame_count = context.get_frame_count();
+
+        // Samplers of the other descriptors of a stage also count towards the limits
+        const auto& limits = context.get_physical_device().getProperties().limits;
+        impl->capacity = std::min({static_cast<u32>(BINDLESS_MAX_TEXTURES), limits.maxPerStageDescriptorSamplers / 2,
+                                   limits.maxPerStageDescriptorSampledImages / 2});
+
+        // Layout
+        const vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+        const vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, impl->capacity,
+                                                     stages);
+
+        const vk::DescriptorBindingFlags binding_flags = vk::DescriptorBindingFlagBits::ePartiallyBound;
+        const vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info(binding_flags);
+
+        const vk::DescriptorSetLayoutCreateInfo layout_info({}, binding, &binding_flags_info);
+        impl->descriptor_set_layout = device.createDescriptorSetLayout(layout_info);
+
+        // The sets are never freed, so they get their own pool
+        const vk::DescriptorPoolSize pool_size(vk::DescriptorType::eCombinedImageSampler,
+                                               impl->capacity * frame_count);
+
+        const vk::DescriptorPoolCreateInfo pool_info({}, frame_count, pool_size);
+        impl->descriptor_pool = device.createDescriptorPool(pool_info);
+
+        const std::vector<vk::DescriptorSetLayout> layouts(frame_count, impl->descriptor_set_layout);
+        impl->descriptor_sets = device.allocateDescriptorSets({impl->descriptor_pool, layouts});
+
+        impl->pending_writes.resize(frame_count);
+        impl->written_slots.resize(frame_count, std::vector<b8>(impl->capacity, false));
+
+        LOG_INFO("Bindless texture capacity: {0}", impl->capacity);
+    }
+
+    BindlessTextures::~BindlessTextures()
+    {
+        // Frames in flight may still be using the descriptor sets
+        get_context().defer_deletion(
+            [descriptor_pool = impl->descriptor_pool, descriptor_set_layout = impl->descriptor_set_layout]
+            {
+                auto& device = get_context().get_device();
+
+                device.destroyDescriptorPool(descriptor_pool);
+                device.destroyDescriptorSetLayout(descriptor_set_layout);
+            });
+    }
+
+    u32 BindlessTextures::add(const RendererImage& image)
+    {
+        u32 index = BINDLESS_INVALID_INDEX;
+
+        if (!impl->free_slots.empty())
+        {
+            index = impl->free_slots.back();
+            impl->free_slots.pop_back();
+        }
+
+        else if (impl->next_slot < impl->capacity)
+        {
+            index = impl->next_slot++;
+        }
+
+        else
+        {
+            LOG_ERROR("Bindless texture array is full ({0} textures)", impl->capacity);
+            return BINDLESS_INVALID_INDEX;
+        }
+
+        update(index, image);
+
+        return index;
+    }
+
+    void BindlessTextures::update(const u32 index, const RendererImage& image)
+    {
+        if (index >= impl->capacity)
+        {
+            return;
+        }
+
+        const vk::DescriptorImageInfo image_info = impl->get_image_info(image);
+
+        for (auto& writes : impl->pending_writes)
+        {
+            writes[index] = image_info;
+        }
+    }
+
+    void BindlessTextures::remove(const u32 index)
+    {
+        if (index >= impl->capacity)
+        {
+            return;
+        }
+
+        // The slot is not rewritten, the old descriptor is never sampled again
+        for (u32 f = 0; f < impl->descriptor_sets.size(); f++)
+        {
+            impl->pending_writes[f].erase(index);
+            impl->written_slots[f][index] = false;
+        }
+
+        impl->free_slots.push_back(index);
+    }
+
+    void BindlessTextures::begin_frame()
+    {
+        const u32 frame = get_context().get_curr_frame_number();
+
+        auto& pending_writes = impl->pending_writes[frame];
+        if (pending_writes.empty())
+        {
+            return;
+        }
+
+        std::vector<vk::WriteDescriptorSet> writes;
+        writes.reserve(pending_writes.size());
+
+        for (const auto& [index, image_info] : pending_writes)
+        {
+            writes.push_back(vk::WriteDescriptorSet(impl->descriptor_sets[frame], 0, index, 1,
+                                                    vk::DescriptorType::eCombinedImageSampler, &image_info));
+
+            impl->written_slots[frame][index] = true;
+        }
+
+        get_context().get_device().updateDescriptorSets(writes, {});
+
+        pending_writes.clear();
+    }
+
+    b8 BindlessTextures::is_valid(const u32 index) const
+    {
+        const u32 frame = get_context().get_curr_frame_number();
+
+        return index < impl->capacity && impl->written_slots[frame][index];
+    }
+
+    const vk::DescriptorSetLayout& BindlessTextures::get_descriptor_set_layout() const
+    {
+        return impl->descriptor_set_layout;
+    }
+
+    const vk::DescriptorSet& BindlessTextures::get_descriptor_set() const
+    {
+        return impl->descriptor_sets[get_context().get_curr_frame_number()];
+    }
+
+    u32 BindlessTextures::get_capacity() const { return impl->capacity; }
+
+    vk::DescriptorImageInfo BindlessTextures::IMPL::get_image_info(const RendererImage& image) const
+    {
+        return vk::DescriptorImageInfo(*static_cast<const vk::Sampler*>(image.get_sampler().get_handle()),
+                                       image.get_image_view(), vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+};  // namespace mag
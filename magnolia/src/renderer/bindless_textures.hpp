@@ -0,0 +1,49 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "core/types.hpp"
+#include "private/vulkan_fwd.hpp"
+
+namespace mag
+{
+#define BINDLESS_MAX_TEXTURES 4096
+#define BINDLESS_INVALID_INDEX Max_U32
+
+    class RendererImage;
+
+    // One array with every texture, bound once per shader instead of one descriptor set per material. Shaders index
+    // it with the indices stored in the material data.
+    //
+    // Each frame in flight has its own descriptor set and the changes are only written to it when the frame begins,
+    // so sets that may still be in use are never updated. Slots without a texture are left unwritten (partially
+    // bound), only the valid ones may be sampled (see is_valid).
+    class BindlessTextures
+    {
+        public:
+            BindlessTextures();
+            ~BindlessTextures();
+
+            // Returns the slot of the texture in the array
+            u32 add(const RendererImage& image);
+
+            // The image was recreated (i.e. when the texture is streamed)
+            void update(const u32 index, const RendererImage& image);
+            void remove(const u32 index);
+
+            // Writes the changes to the descriptor set of the current frame, before it is bound
+            void begin_frame();
+
+            // The texture can be sampled in the current frame
+            b8 is_valid(const u32 index) const;
+
+            const vk::DescriptorSetLayout& get_descriptor_set_layout() const;
+            const vk::DescriptorSet& get_descriptor_set() const;
+            u32 get_capacity() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
@@ -1,10 +1,12 @@
 #include "renderer/buffers.hpp"
 
+#include <algorithm>
 #include <vulkan/vulkan.hpp>
 
 #include "core/assert.hpp"
 #include "renderer/command.hpp"
 #include "renderer/context.hpp"
+#include "renderer/upload_queue.hpp"
 
 namespace mag
 {
@@ -76,26 +78,21 @@ namespace mag
 
     void GPUBuffer::initialize(const void* data, const u64 size_bytes, const vk::BufferUsageFlags usage)
     {
-        auto& context = get_context();
-
-        // Create staging buffer to send data to the gpu
-        VulkanBuffer staging_buffer;
-        staging_buffer.initialize(size_bytes, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-                                  VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
-        staging_buffer.copy(data, size_bytes);
+        auto& upload_queue = get_context().get_upload_queue();
 
         buffer.initialize(size_bytes, usage | vk::BufferUsageFlagBits::eTransferDst,
                           VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
 
-        // Copy data from the staging buffer to the gpu buffer
-        context.submit_commands_immediate([&staging_buffer, size_bytes, this](CommandBuffer& cmd)
-                                          { cmd.copy_buffer(staging_buffer, buffer, size_bytes, 0, 0); });
-
-        staging_buffer.shutdown();
+        // Copy data to the gpu buffer with the next upload batch
+        const StagingAllocation staging = upload_queue.stage(data, size_bytes);
+        upload_queue.get_command_buffer().copy_buffer(*staging.buffer, buffer, size_bytes, staging.offset, 0);
     }
 
-    void GPUBuffer::shutdown() { buffer.shutdown(); }
+    void GPUBuffer::shutdown()
+    {
+        // Frames in flight and pending uploads may still be using the buffer
+        get_context().defer_deletion([buffer = this->buffer]() mutable { buffer.shutdown(); });
+    }
 
     VulkanBuffer& GPUBuffer::get_buffer() { return buffer; }
 
@@ -132,4 +129,123 @@ namespace mag
     }
 
     VulkanBuffer& IndexBuffer::get_buffer() { return gpu_buffer.get_buffer(); }
+
+    // IndirectBuffer
+    // -----------------------------------------------------------------------------------------------------------------
+    static_assert(sizeof(DrawIndexedCommand) == sizeof(vk::DrawIndexedIndirectCommand), "Layouts must match");
+
+    IndirectBuffer::IndirectBuffer(const u32 max_draws) : max_draws(max_draws)
+    {
+        buffers.resize(get_context().get_frame_count());
+
+        for (auto& buffer : buffers)
+        {
+            buffer.initialize(max_draws * sizeof(DrawIndexedCommand), vk::BufferUsageFlagBits::eIndirectBuffer,
+                              VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                              VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        }
+    }
+
+    IndirectBuffer::~IndirectBuffer()
+    {
+        // Frames in flight may still be using the buffers
+        get_context().defer_deletion(
+            [buffers = this->buffers]() mutable
+            {
+                for (auto& buffer : buffers)
+                {
+                    buffer.shutdown();
+                }
+            });
+    }
+
+    void IndirectBuffer::begin_frame() { used_draws = 0; }
+
+    b8 IndirectBuffer::write(const DrawIndexedCommand* commands, const u32 count, u64& offset)
+    {
+        u32 first_draw = used_draws;
+        do
+        {
+            if (first_draw + count > max_draws)
+            {
+                return false;
+            }
+        } while (!used_draws.compare_exchange_weak(first_draw, first_draw + count));
+
+        offset = first_draw * sizeof(DrawIndexedCommand);
+        get_buffer().copy(commands, count * sizeof(DrawIndexedCommand), offset);
+
+        return true;
+    }
+
+    VulkanBuffer& IndirectBuffer::get_buffer() { return buffers[get_context().get_curr_frame_number()]; }
+
+    // UniformAllocator
+    // -----------------------------------------------------------------------------------------------------------------
+    UniformAllocator::UniformAllocator(const u64 size) : size(size)
+    {
+        auto& context = get_context();
+
+        const auto& limits = context.get_physical_device().getProperties().limits;
+        alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+        buffers.resize(context.get_frame_count());
+
+        for (auto& buffer : buffers)
+        {
+            buffer.initialize(size, vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                              VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                              VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+        }
+    }
+
+    UniformAllocator::~UniformAllocator()
+    {
+        // Frames in flight may still be using the buffers
+        get_context().defer_deletion(
+            [buffers = this->buffers]() mutable
+            {
+                for (auto& buffer : buffers)
+                {
+                    buffer.shutdown();
+                }
+            });
+    }
+
+    void UniformAllocator::begin_frame()
+    {
+        used_size = 0;
+        frame_index++;
+    }
+
+    void* UniformAllocator::allocate(const u64 size_bytes, u64& offset, const u64 range)
+    {
+        // Only the written bytes are reserved, the rest of the range is never read by the shaders
+        const u64 required_size = std::max(size_bytes, range);
+
+        // Alignment is a power of two
+        u64 used = used_size;
+        u64 aligned_offset = 0;
+        do
+        {
+            aligned_offset = (used + alignment - 1) & ~(alignment - 1);
+            if (aligned_offset + required_size > size)
+            {
+                return nullptr;
+            }
+        } while (!used_size.compare_exchange_weak(used, aligned_offset + size_bytes));
+
+        offset = aligned_offset;
+
+        auto& buffer = get_buffer(get_context().get_curr_frame_number());
+        return static_cast<c8*>(buffer.get_data()) + offset;
+    }
+
+    VulkanBuffer& UniformAllocator::get_buffer(const u32 frame) { return buffers[frame]; }
+
+    u64 UniformAllocator::get_frame_index() const { return frame_index; }
+
+    u64 UniformAllocator::get_size() const { return size; }
+
+    u64 UniformAllocator::get_used_size() const { return used_size; }
 };  // namespace mag
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "core/types.hpp"
 #include "private/vulkan_fwd.hpp"
 #include "vk_mem_alloc.h"
@@ -9,6 +12,16 @@ namespace mag
     class Context;
     class CommandBuffer;
 
+    // Same layout as VkDrawIndexedIndirectCommand
+    struct DrawIndexedCommand
+    {
+            u32 index_count;
+            u32 instance_count;
+            u32 first_index;
+            i32 vertex_offset;
+            u32 first_instance;
+    };
+
     class VulkanBuffer
     {
         public:
@@ -79,4 +92,60 @@ namespace mag
         private:
             GPUBuffer gpu_buffer;
     };
+
+    // Draw commands written by the CPU during the frame. Each frame in flight has its own buffer, so the commands are
+    // not overwritten while the GPU reads them.
+    class IndirectBuffer
+    {
+        public:
+            IndirectBuffer(const u32 max_draws);
+            ~IndirectBuffer();
+
+            // Starts writing to the buffer of the current frame
+            void begin_frame();
+
+            // Appends the commands to the ones written this frame, 'offset' is where they start (in bytes). Passes
+            // recorded in parallel may write at the same time.
+            b8 write(const DrawIndexedCommand* commands, const u32 count, u64& offset);
+
+            VulkanBuffer& get_buffer();
+
+        private:
+            std::vector<VulkanBuffer> buffers;
+            u32 max_draws;
+            std::atomic<u32> used_draws = 0;
+    };
+
+    // Linear allocator for the uniform and storage data of a frame. Each frame in flight has one persistently mapped
+    // buffer, allocations only bump an offset and the whole buffer is rewound when the frame begins. Offsets are
+    // aligned to be used as dynamic descriptor offsets.
+    class UniformAllocator
+    {
+        public:
+            UniformAllocator(const u64 size);
+            ~UniformAllocator();
+
+            // Rewinds the buffer of the current frame
+            void begin_frame();
+
+            // Returns the mapped memory or nullptr if the buffer of the frame is full. Safe to call from the threads
+            // that record passes. 'range' is the range of the descriptor bound at the offset, it must fit in the
+            // buffer too.
+            void* allocate(const u64 size_bytes, u64& offset, const u64 range = 0);
+
+            VulkanBuffer& get_buffer(const u32 frame);
+
+            // Incremented every frame, allocations of older frames are no longer valid
+            u64 get_frame_index() const;
+
+            u64 get_size() const;
+            u64 get_used_size() const;
+
+        private:
+            std::vector<VulkanBuffer> buffers;
+            u64 size;
+            u64 alignment = 1;
+            std::atomic<u64> used_size = 0;
+            u64 frame_index = 0;
+    };
 };  // namespace mag
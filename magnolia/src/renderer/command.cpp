@@ -30,6 +30,21 @@ namespace mag
         this->command_buffer->begin(begin_info);
     }
 
+    void CommandBuffer::begin(const std::vector<vk::Format>& color_formats, const vk::Format depth_format)
+    {
+        const vk::CommandBufferInheritanceRenderingInfo inheritance_rendering_info(
+            {}, 0, color_formats, depth_format, vk::Format::eUndefined, vk::SampleCountFlagBits::e1);
+
+        vk::CommandBufferInheritanceInfo inheritance_info;
+        inheritance_info.setPNext(&inheritance_rendering_info);
+
+        const vk::CommandBufferBeginInfo begin_info(
+            vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+            &inheritance_info);
+
+        this->command_buffer->begin(begin_info);
+    }
+
     void CommandBuffer::end() { this->command_buffer->end(); }
 
     void CommandBuffer::begin_rendering(const vk::RenderingInfo& rendering_info)
@@ -39,6 +54,11 @@ namespace mag
 
     void CommandBuffer::end_rendering() { this->command_buffer->endRendering(); }
 
+    void CommandBuffer::execute_commands(const CommandBuffer& secondary_command_buffer)
+    {
+        this->command_buffer->executeCommands(secondary_command_buffer.get_handle());
+    }
+
     void CommandBuffer::draw(const u32 vertex_count, const u32 instance_count, const u32 first_vertex,
                              const u32 first_instance)
     {
@@ -51,6 +71,13 @@ namespace mag
         this->command_buffer->drawIndexed(index_count, instance_count, first_index, vertex_offset, first_instance);
     }
 
+    void CommandBuffer::draw_indexed_indirect(const VulkanBuffer& buffer, const u64 offset, const u32 draw_count,
+                                              const u32 stride)
+    {
+        this->command_buffer->drawIndexedIndirect(*static_cast<const vk::Buffer*>(buffer.get_handle()), offset,
+                                                  draw_count, stride);
+    }
+
     void CommandBuffer::bind_vertex_buffer(const VulkanBuffer& buffer, const u64 offset)
     {
         this->command_buffer->bindVertexBuffers(0, *static_cast<const vk::Buffer*>(buffer.get_handle()), offset);
@@ -68,6 +95,13 @@ namespace mag
         this->command_buffer->bindDescriptorSets(bind_point, layout, first_set, descriptor_set, nullptr);
     }
 
+    void CommandBuffer::bind_descriptor_set(const vk::PipelineBindPoint bind_point, const vk::PipelineLayout layout,
+                                            const u32 first_set, const vk::DescriptorSet descriptor_set,
+                                            const u32 dynamic_offset)
+    {
+        this->command_buffer->bindDescriptorSets(bind_point, layout, first_set, descriptor_set, dynamic_offset);
+    }
+
     void CommandBuffer::copy_buffer(const VulkanBuffer& src, const VulkanBuffer& dst, const u64 size_bytes,
                                     const u64 src_offset, const u64 dst_offset)
     {
@@ -76,7 +110,8 @@ namespace mag
                                          *static_cast<const vk::Buffer*>(dst.get_handle()), copy);
     }
 
-    void CommandBuffer::copy_buffer_to_image(const VulkanBuffer& src, const RendererImage& image)
+    void CommandBuffer::copy_buffer_to_image(const VulkanBuffer& src, const RendererImage& image,
+                                             const std::vector<u64>& mip_offsets)
     {
         const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, image.get_mip_levels(), 0, 1);
         const vk::ImageMemoryBarrier to_transfer_barrier(
@@ -86,11 +121,25 @@ namespace mag
         this->get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
                                            vk::DependencyFlagBits::eByRegion, {}, {}, to_transfer_barrier);
 
-        const vk::ImageSubresourceLayers image_subresource(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
-        const vk::BufferImageCopy copy_region(0, 0, 0, image_subresource, {}, mag_to_vk(image.get_extent()));
+        std::vector<vk::BufferImageCopy> copy_regions;
+
+        if (mip_offsets.empty())
+        {
+            const vk::ImageSubresourceLayers image_subresource(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+            copy_regions.emplace_back(0, 0, 0, image_subresource, vk::Offset3D(), mag_to_vk(image.get_extent()));
+        }
+
+        for (u32 i = 0; i < mip_offsets.size(); i++)
+        {
+            const uvec3& extent = image.get_extent();
+            const uvec3 mip_extent(std::max(extent.x >> i, 1u), std::max(extent.y >> i, 1u), 1);
+
+            const vk::ImageSubresourceLayers image_subresource(vk::ImageAspectFlagBits::eColor, i, 0, 1);
+            copy_regions.emplace_back(mip_offsets[i], 0, 0, image_subresource, vk::Offset3D(), mag_to_vk(mip_extent));
+        }
 
         this->command_buffer->copyBufferToImage(*static_cast<const vk::Buffer*>(src.get_handle()), image.get_image(),
-                                                vk::ImageLayout::eTransferDstOptimal, copy_region);
+                                                vk::ImageLayout::eTransferDstOptimal, copy_regions);
 
         vk::ImageMemoryBarrier to_readable_barrier = to_transfer_barrier;
         to_readable_barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "core/types.hpp"
 #include "private/vulkan_fwd.hpp"
 
@@ -17,16 +19,24 @@ namespace mag
             void initialize(const vk::CommandPool& pool, const vk::CommandBufferLevel level);
 
             void begin();
+
+            // Secondary command buffers continue the rendering of a pass with these attachment formats
+            void begin(const std::vector<vk::Format>& color_formats, const vk::Format depth_format);
             void end();
             void begin_rendering(const vk::RenderingInfo& rendering_info);
             void end_rendering();
 
+            void execute_commands(const CommandBuffer& secondary_command_buffer);
+
             void draw(const u32 vertex_count, const u32 instance_count = 1, const u32 first_vertex = 0,
                       const u32 first_instance = 0);
 
             void draw_indexed(const u32 index_count, const u32 instance_count = 1, const u32 first_index = 0,
                               const i32 vertex_offset = 0, const u32 first_instance = 0);
 
+            void draw_indexed_indirect(const VulkanBuffer& buffer, const u64 offset, const u32 draw_count,
+                                       const u32 stride);
+
             void bind_vertex_buffer(const VulkanBuffer& buffer, const u64 offset = 0);
 
             void bind_index_buffer(const VulkanBuffer& buffer, const u64 offset = 0);
@@ -34,10 +44,17 @@ namespace mag
             void bind_descriptor_set(const vk::PipelineBindPoint bind_point, const vk::PipelineLayout layout,
                                      const u32 first_set, const vk::DescriptorSet descriptor_set);
 
+            // For sets with a single dynamic buffer
+            void bind_descriptor_set(const vk::PipelineBindPoint bind_point, const vk::PipelineLayout layout,
+                                     const u32 first_set, const vk::DescriptorSet descriptor_set,
+                                     const u32 dynamic_offset);
+
             void copy_buffer(const VulkanBuffer& src, const VulkanBuffer& dst, const u64 size_bytes,
                              const u64 src_offset, const u64 dst_offset);
 
-            void copy_buffer_to_image(const VulkanBuffer& src, const RendererImage& image);
+            // Copy the base level or, if mip offsets are provided, all mip levels of the image
+            void copy_buffer_to_image(const VulkanBuffer& src, const RendererImage& image,
+                                      const std::vector<u64>& mip_offsets = {});
 
             void copy_image_to_image(const vk::Image& src, const vk::Extent3D& src_extent, const vk::Image& dst,
                                      const vk::Extent3D& dst_extent);
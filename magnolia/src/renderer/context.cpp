@@ -6,8 +6,11 @@
 #include "core/logger.hpp"
 #include "core/window.hpp"
 #include "math/generic.hpp"
+#include "platform/file_system.hpp"
 #include "renderer/descriptors.hpp"
 #include "renderer/frame.hpp"
+#include "renderer/pipeline.hpp"
+#include "renderer/upload_queue.hpp"
 #include "tools/profiler.hpp"
 
 // Use to trace VMA allocations
@@ -32,8 +35,13 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 namespace mag
 {
+#define PIPELINE_CACHE_FILE "pipeline_cache.bin"
+
     static Context* context = nullptr;
 
+    // Set while a pass is recorded (see Context::get_command_buffer)
+    static thread_local CommandBuffer* thread_command_buffer = nullptr;
+
     Context& get_context()
     {
         ASSERT(context != nullptr, "Context is null");
@@ -80,6 +88,7 @@ namespace mag
             vk::PresentModeKHR surface_present_mode;
             vk::SwapchainKHR swapchain;
             vk::Queue graphics_queue;
+            vk::Queue transfer_queue;
             vk::CommandPool immediate_command_pool;
             vk::Fence upload_fence;
             vk::DebugUtilsMessengerEXT debug_utils_messenger;
@@ -95,6 +104,7 @@ namespace mag
             u32 frame_count = {};
             const u32 query_count = 2;
             b8 is_query_supported = {};
+            b8 is_indirect_draw_supported = {};
             f32 timestamp_period = {};
             ProfileResult timestamp = {};
 
@@ -102,6 +112,9 @@ namespace mag
             VmaAllocator allocator = {};
             unique<DescriptorLayoutCache> descriptor_layout_cache;
             unique<DescriptorAllocator> descriptor_allocator;
+            std::vector<unique<DescriptorAllocator>> frame_descriptor_allocators;
+            unique<PipelineCache> pipeline_cache;
+            unique<UploadQueue> upload_queue;
 
             CommandBuffer submit_command_buffer;
     };
@@ -215,6 +228,8 @@ namespace mag
         vk::PhysicalDeviceFeatures required_physical_device_features;
         required_physical_device_features.setSamplerAnisotropy(true);
         required_physical_device_features.setFillModeNonSolid(true);
+        required_physical_device_features.setTextureCompressionBC(true);
+        required_physical_device_features.setShaderSampledImageArrayDynamicIndexing(true);  // Bindless textures
 
         LOG_INFO("Enumerating physical devices");
         const auto available_physical_devices = impl->instance.enumeratePhysicalDevices();
@@ -253,7 +268,45 @@ namespace mag
             // Also check available features
             const auto available_physical_device_features = available_physical_device.getFeatures();
             if (!available_physical_device_features.samplerAnisotropy ||
-                !available_physical_device_features.fillModeNonSolid)
+                !available_physical_device_features.fillModeNonSolid ||
+                !available_physical_device_features.textureCompressionBC)
+            {
+                continue;
+            }
+
+            // Bindless textures index a partially bound array of variable size with the material texture indices (see
+            // BindlessTextures). There is no fallback, so devices without them are skipped.
+            vk::PhysicalDeviceDescriptorIndexingFeatures available_descriptor_indexing_features;
+            vk::PhysicalDeviceFeatures2 available_physical_device_features_2({},
+                                                                            &available_descriptor_indexing_features);
+            available_physical_device.getFeatures2(&available_physical_device_features_2);
+
+            if (!available_physical_device_features.shaderSampledImageArrayDynamicIndexing ||
+                !available_descriptor_indexing_features.runtimeDescriptorArray ||
+                !available_descriptor_indexing_features.descriptorBindingPartiallyBound ||
+                !available_descriptor_indexing_features.descriptorBindingVariableDescriptorCount)
+            {
+                LOG_WARNING("Device '{0}' does not support bindless textures", str(properties.deviceName));
+                continue;
+            }
+
+            // Single and dual channel textures are sampled as sRGB or UNORM and their mips are generated with blits
+            const vk::FormatFeatureFlags texture_features =
+                vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear |
+                vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+
+            b8 texture_formats_supported = true;
+            for (const auto format :
+                 {vk::Format::eR8Srgb, vk::Format::eR8G8Srgb, vk::Format::eR8Unorm, vk::Format::eR8G8Unorm})
+            {
+                const auto format_properties = available_physical_device.getFormatProperties(format);
+                if ((format_properties.optimalTilingFeatures & texture_features) != texture_features)
+                {
+                    texture_formats_supported = false;
+                }
+            }
+
+            if (!texture_formats_supported)
             {
                 continue;
             }
@@ -274,6 +327,14 @@ namespace mag
         // Query support
         impl->is_query_supported = impl->physical_device_properties.properties.limits.timestampComputeAndGraphics;
 
+        // Indirect draws of several commands with instance offsets (optional, draws are direct otherwise)
+        const auto physical_device_features = impl->physical_device.getFeatures();
+        impl->is_indirect_draw_supported =
+            physical_device_features.multiDrawIndirect && physical_device_features.drawIndirectFirstInstance;
+
+        required_physical_device_features.setMultiDrawIndirect(impl->is_indirect_draw_supported);
+        required_physical_device_features.setDrawIndirectFirstInstance(impl->is_indirect_draw_supported);
+
         // Check available MSAA samples
         const auto properties = impl->physical_device_properties.properties;
         const auto counts = properties.limits.framebufferColorSampleCounts &
@@ -312,9 +373,15 @@ namespace mag
             if (format.format == vk::Format::eR8G8B8A8Srgb || format.format == vk::Format::eB8G8R8A8Srgb)
                 impl->surface_format = format;
 
+        // Uploads use a second queue of the same family (if available) so they don't need ownership transfers
+        const auto queue_family_properties = impl->physical_device.getQueueFamilyProperties();
+        const u32 queue_count = min(queue_family_properties[impl->queue_family_index].queueCount, 2u);
+
         vk::DeviceQueueCreateInfo device_queue_create_info;
-        std::array queue_priorities = {1.0f};
-        device_queue_create_info.setQueuePriorities(queue_priorities).setQueueFamilyIndex(impl->queue_family_index);
+        std::array queue_priorities = {1.0f, 0.5f};
+        device_queue_create_info.setQueueCount(queue_count)
+            .setPQueuePriorities(queue_priorities.data())
+            .setQueueFamilyIndex(impl->queue_family_index);
 
         LOG_INFO("Enumerating device extension properties");
         const auto device_properties = impl->physical_device.enumerateDeviceExtensionProperties();
@@ -359,9 +426,13 @@ namespace mag
         }
         vk::PhysicalDeviceSynchronization2Features synchronization_2_features(true, p_next);
 
+        vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features(true, &synchronization_2_features);
+
         vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features({});
         descriptor_indexing_features.setDescriptorBindingVariableDescriptorCount(true);
-        descriptor_indexing_features.setPNext(&synchronization_2_features);
+        descriptor_indexing_features.setDescriptorBindingPartiallyBound(true);  // Bindless textures
+        descriptor_indexing_features.setRuntimeDescriptorArray(true);
+        descriptor_indexing_features.setPNext(&timeline_semaphore_features);
 
         vk::PhysicalDeviceBufferDeviceAddressFeatures buffer_device_address_features(true, {}, {},
                                                                                      &descriptor_indexing_features);
@@ -384,6 +455,17 @@ namespace mag
         VULKAN_HPP_DEFAULT_DISPATCHER.init(impl->device);
 
         impl->graphics_queue = impl->device.getQueue(impl->queue_family_index, 0);
+        impl->transfer_queue = impl->graphics_queue;
+
+        if (queue_count > 1)
+        {
+            impl->transfer_queue = impl->device.getQueue(impl->queue_family_index, 1);
+        }
+
+        else
+        {
+            LOG_WARNING("No dedicated upload queue available, uploads will share the graphics queue");
+        }
 
         // Debug callback
 #if MAG_CONFIG_DEBUG
@@ -444,15 +526,34 @@ namespace mag
 
         // Descriptors
         impl->descriptor_layout_cache = create_unique<DescriptorLayoutCache>();
-        impl->descriptor_allocator = create_unique<DescriptorAllocator>();
+        impl->descriptor_allocator = create_unique<DescriptorAllocator>(DescriptorAllocatorType::Persistent);
+
+        for (u32 f = 0; f < impl->frame_count; f++)
+        {
+            impl->frame_descriptor_allocators.push_back(
+                create_unique<DescriptorAllocator>(DescriptorAllocatorType::Frame));
+        }
+
+        // Pipelines
+        const str pipeline_cache_path = fs::get_output_directory() + PIPELINE_CACHE_FILE;
+
+        impl->pipeline_cache = create_unique<PipelineCache>(pipeline_cache_path);
+
+        // Uploads
+        impl->upload_queue = create_unique<UploadQueue>();
     }
 
     Context::~Context()
     {
         impl->device.waitIdle();
 
+        impl->frame_provider.flush_deletion_queues();
+
+        impl->upload_queue.reset();
         impl->descriptor_layout_cache.reset();
         impl->descriptor_allocator.reset();
+        impl->frame_descriptor_allocators.clear();
+        impl->pipeline_cache.reset();
 
         vmaDestroyAllocator(impl->allocator);
 
@@ -515,7 +616,18 @@ namespace mag
         }
     }
 
-    b8 Context::begin_frame() { return impl->frame_provider.begin_frame(); }
+    b8 Context::begin_frame()
+    {
+        if (!impl->frame_provider.begin_frame())
+        {
+            return false;
+        }
+
+        // The GPU is done with the sets of this frame
+        get_frame_descriptor_allocator().reset_pools();
+
+        return true;
+    }
 
     b8 Context::end_frame(const RendererImage& image, const vk::Extent3D& extent)
     {
@@ -539,6 +651,11 @@ namespace mag
         impl->device.resetCommandPool(impl->immediate_command_pool);
     }
 
+    void Context::defer_deletion(std::function<void()>&& function)
+    {
+        impl->frame_provider.defer_deletion(std::move(function));
+    }
+
     void Context::begin_timestamp()
     {
         if (!impl->is_query_supported) return;
@@ -589,6 +706,7 @@ namespace mag
     const vk::Device& Context::get_device() const { return impl->device; }
     const vk::PhysicalDevice& Context::get_physical_device() const { return impl->physical_device; }
     const vk::Queue& Context::get_graphics_queue() const { return impl->graphics_queue; }
+    const vk::Queue& Context::get_transfer_queue() const { return impl->transfer_queue; }
     const vk::SurfaceKHR& Context::get_surface() const { return impl->surface; }
     const vk::SurfaceFormatKHR& Context::get_surface_format() const { return impl->surface_format; }
     const vk::Extent2D& Context::get_surface_extent() const { return impl->surface_extent; }
@@ -646,6 +764,11 @@ namespace mag
                                             vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment);
                 break;
 
+            case ImageFormat::Unorm:
+                return get_supported_format({vk::Format::eR8G8B8A8Unorm, vk::Format::eB8G8R8A8Unorm},
+                                            vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eColorAttachment);
+                break;
+
             case ImageFormat::Float:
                 return get_supported_format(
                     {vk::Format::eR16G16B16A16Sfloat, vk::Format::eR32G32B32A32Sfloat, vk::Format::eR64G64B64A64Sfloat},
@@ -662,10 +785,30 @@ namespace mag
     vk::SampleCountFlags Context::get_available_msaa_samples() const { return impl->msaa_samples; }
 
     Frame& Context::get_curr_frame() { return impl->frame_provider.get_current_frame(); }
+
+    CommandBuffer& Context::get_command_buffer()
+    {
+        return thread_command_buffer ? *thread_command_buffer : get_curr_frame().command_buffer;
+    }
+
+    CommandBuffer* Context::set_command_buffer(CommandBuffer* command_buffer)
+    {
+        return std::exchange(thread_command_buffer, command_buffer);
+    }
+
     DescriptorLayoutCache& Context::get_descriptor_layout_cache() { return *impl->descriptor_layout_cache; }
     DescriptorAllocator& Context::get_descriptor_allocator() { return *impl->descriptor_allocator; }
 
+    DescriptorAllocator& Context::get_frame_descriptor_allocator()
+    {
+        return *impl->frame_descriptor_allocators[get_curr_frame_number()];
+    }
+
+    PipelineCache& Context::get_pipeline_cache() { return *impl->pipeline_cache; }
+    UploadQueue& Context::get_upload_queue() { return *impl->upload_queue; }
+
     u32 Context::get_queue_family_index() const { return impl->queue_family_index; }
     u32 Context::get_swapchain_image_index() const { return impl->frame_provider.get_swapchain_image_index(); }
     u32 Context::get_frame_count() const { return impl->frame_count; }
+    b8 Context::is_indirect_draw_supported() const { return impl->is_indirect_draw_supported; }
 };  // namespace mag
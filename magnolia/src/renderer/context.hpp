@@ -18,7 +18,9 @@ namespace mag
     class DescriptorAllocator;
     class DescriptorLayoutCache;
     class FrameProvider;
+    class PipelineCache;
     class RendererImage;
+    class UploadQueue;
 
     struct Frame;
     struct ProfileResult;
@@ -33,6 +35,7 @@ namespace mag
     enum class ImageFormat
     {
         Srgb,
+        Unorm,
         Float
     };
 
@@ -48,6 +51,9 @@ namespace mag
             b8 end_frame(const RendererImage& image, const vk::Extent3D& extent);
             void submit_commands_immediate(std::function<void(CommandBuffer& cmd)>&& function);
 
+            // Destroys the resource once the frames that may be using it are done
+            void defer_deletion(std::function<void()>&& function);
+
             void begin_timestamp();
             void end_timestamp();
             void calculate_timestamp();
@@ -56,6 +62,7 @@ namespace mag
             const vk::Device& get_device() const;
             const vk::PhysicalDevice& get_physical_device() const;
             const vk::Queue& get_graphics_queue() const;
+            const vk::Queue& get_transfer_queue() const;
             const vk::SurfaceKHR& get_surface() const;
             const vk::SurfaceFormatKHR& get_surface_format() const;
             const vk::Extent2D& get_surface_extent() const;
@@ -76,12 +83,24 @@ namespace mag
             vk::SampleCountFlags get_available_msaa_samples() const;
 
             Frame& get_curr_frame();
+
+            // The command buffer the calling thread records to. Passes are recorded to secondary command buffers (see
+            // RenderGraph), outside of them it is the command buffer of the frame. Returns the previous command buffer.
+            CommandBuffer& get_command_buffer();
+            CommandBuffer* set_command_buffer(CommandBuffer* command_buffer);
+
             DescriptorLayoutCache& get_descriptor_layout_cache();
             DescriptorAllocator& get_descriptor_allocator();
 
+            // Sets allocated from it are only valid while the current frame is recorded
+            DescriptorAllocator& get_frame_descriptor_allocator();
+            PipelineCache& get_pipeline_cache();
+            UploadQueue& get_upload_queue();
+
             u32 get_queue_family_index() const;
             u32 get_swapchain_image_index() const;
             u32 get_frame_count() const;
+            b8 is_indirect_draw_supported() const;
 
         private:
             struct IMPL;
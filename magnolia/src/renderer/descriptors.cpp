@@ -1,5 +1,8 @@
 #include "renderer/descriptors.hpp"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <vulkan/vulkan.hpp>
 
 #include "core/assert.hpp"
@@ -10,6 +13,10 @@
 
 namespace mag
 {
+#define DESCRIPTOR_POOL_SET_COUNT 1000
+#define DESCRIPTOR_POOL_HEADROOM 1.5f
+#define DESCRIPTOR_POOL_MIN_RATIO 0.1f
+
     vk::DescriptorPool create_pool(const DescriptorAllocator::PoolSizes& pool_sizes, const u32 count,
                                    const vk::DescriptorPoolCreateFlags flags)
     {
@@ -34,19 +41,41 @@ namespace mag
             IMPL() = default;
             ~IMPL() = default;
 
-            // Add more types if necessary
+            void update_statistics();
+
+            DescriptorAllocatorType type = DescriptorAllocatorType::Persistent;
+
+            // Add more types if necessary. Used until the first sets are allocated.
             PoolSizes descriptor_sizes = {{vk::DescriptorType::eUniformBuffer, 1},
+                                          {vk::DescriptorType::eUniformBufferDynamic, 1},
                                           {vk::DescriptorType::eStorageBuffer, 1},
+                                          {vk::DescriptorType::eStorageBufferDynamic, 1},
                                           {vk::DescriptorType::eCombinedImageSampler, 1}};
 
             vk::DescriptorPool current_pool = {};
             std::vector<vk::DescriptorPool> used_pools;
             std::vector<vk::DescriptorPool> free_pools;
+
+            // Pool of each live set and the number of live sets in each pool
+            std::unordered_map<VkDescriptorSet, VkDescriptorPool> set_pools;
+            std::unordered_map<VkDescriptorPool, u32> pool_set_counts;
+
+            // Descriptors of each type per allocated set, new pools are sized with it
+            std::map<vk::DescriptorType, u64> observed_descriptors;
+            u64 observed_sets = 0;
+
+            DescriptorAllocatorStatistics statistics;
+
+            // Passes recorded in parallel allocate from the same frame allocator (see RenderGraph)
+            std::mutex mutex;
     };
 
     // DescriptorAllocator
     // ---------------------------------------------------------------------------------------------------------------------
-    DescriptorAllocator::DescriptorAllocator() : impl(new IMPL()) {}
+    DescriptorAllocator::DescriptorAllocator(const DescriptorAllocatorType type) : impl(new IMPL())
+    {
+        impl->type = type;
+    }
 
     DescriptorAllocator::~DescriptorAllocator()
     {
@@ -56,8 +85,11 @@ namespace mag
         for (const auto& p : impl->used_pools) vkDestroyDescriptorPool(context.get_device(), p, nullptr);
     }
 
-    b8 DescriptorAllocator::allocate(vk::DescriptorSet* set, const vk::DescriptorSetLayout layout)
+    b8 DescriptorAllocator::allocate(vk::DescriptorSet* set, const vk::DescriptorSetLayout layout,
+                                     const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
     {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+
         auto& context = get_context();
 
         // initialize the currentPool handle if it's null
@@ -71,43 +103,90 @@ namespace mag
 
         // try to allocate the descriptor set
         vk::Result alloc_result = context.get_device().allocateDescriptorSets(&alloc_info, set);
-        b8 needReallocate = false;
 
         switch (alloc_result)
         {
             case vk::Result::eSuccess:
-                return true;
+                break;
 
             // reallocate pool
             case vk::Result::eErrorFragmentedPool:
             case vk::Result::eErrorOutOfPoolMemory:
-                needReallocate = true;
+                // allocate a new pool and retry
+                impl->current_pool = grab_pool();
+                impl->used_pools.push_back(impl->current_pool);
+                impl->statistics.pool_overflows++;
+
+                alloc_info.setDescriptorPool(impl->current_pool);
+                alloc_result = context.get_device().allocateDescriptorSets(&alloc_info, set);
                 break;
 
             // unrecoverable error
             default:
-                LOG_ERROR("Error during descriptor allocation: '{0}'", vk::to_string(alloc_result));
-                return false;
+                break;
         }
 
-        if (needReallocate)
+        // if it still fails then we have big issues
+        if (alloc_result != vk::Result::eSuccess)
         {
-            // allocate a new pool and retry
-            impl->current_pool = grab_pool();
-            impl->used_pools.push_back(impl->current_pool);
+            LOG_ERROR("Error during descriptor allocation: '{0}'", vk::to_string(alloc_result));
+            return false;
+        }
+
+        // Keep track of the usage
+        impl->observed_sets++;
+        for (const auto& binding : bindings)
+        {
+            impl->observed_descriptors[binding.descriptorType] += binding.descriptorCount;
+        }
+
+        impl->set_pools[*set] = impl->current_pool;
+        impl->pool_set_counts[impl->current_pool]++;
+        impl->update_statistics();
+
+        return true;
+    }
 
-            alloc_result = context.get_device().allocateDescriptorSets(&alloc_info, set);
+    void DescriptorAllocator::free(const vk::DescriptorSet set)
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
 
-            if (alloc_result == vk::Result::eSuccess) return true;
+        if (impl->type != DescriptorAllocatorType::Persistent)
+        {
+            LOG_ERROR("Descriptor sets of frame allocators can't be freed individually");
+            return;
         }
 
-        // if it still fails then we have big issues
-        LOG_ERROR("Error during descriptor allocation: '{0}'", vk::to_string(alloc_result));
-        return false;
+        auto it = impl->set_pools.find(set);
+        if (it == impl->set_pools.end())
+        {
+            LOG_ERROR("Tried to free invalid descriptor set");
+            return;
+        }
+
+        auto& context = get_context();
+        const vk::DescriptorPool pool = it->second;
+
+        context.get_device().freeDescriptorSets(pool, set);
+        impl->set_pools.erase(it);
+
+        // Recycle the pools without sets, except the one being allocated from
+        if (--impl->pool_set_counts[pool] == 0 && pool != impl->current_pool)
+        {
+            context.get_device().resetDescriptorPool(pool);
+
+            impl->pool_set_counts.erase(pool);
+            impl->used_pools.erase(std::find(impl->used_pools.begin(), impl->used_pools.end(), pool));
+            impl->free_pools.push_back(pool);
+        }
+
+        impl->update_statistics();
     }
 
     void DescriptorAllocator::reset_pools()
     {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+
         auto& context = get_context();
 
         // reset all used pools and add them to the free pools
@@ -119,11 +198,17 @@ namespace mag
 
         // clear the used pools, since we've put them all in the free pools
         impl->used_pools.clear();
+        impl->set_pools.clear();
+        impl->pool_set_counts.clear();
 
         // reset the current pool handle back to null
         impl->current_pool = nullptr;
+
+        impl->update_statistics();
     }
 
+    const DescriptorAllocatorStatistics& DescriptorAllocator::get_statistics() const { return impl->statistics; }
+
     vk::DescriptorPool DescriptorAllocator::grab_pool()
     {
         // there are reusable pools availible
@@ -136,7 +221,47 @@ namespace mag
         }
 
         // no pools availible, so create a new one
-        return create_pool(impl->descriptor_sizes, 1000, {});
+        const vk::DescriptorPoolCreateFlags flags = impl->type == DescriptorAllocatorType::Persistent
+                                                        ? vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet
+                                                        : vk::DescriptorPoolCreateFlags();
+
+        impl->statistics.pool_count++;
+
+        return create_pool(get_pool_sizes(), DESCRIPTOR_POOL_SET_COUNT, flags);
+    }
+
+    DescriptorAllocator::PoolSizes DescriptorAllocator::get_pool_sizes() const
+    {
+        if (impl->observed_sets == 0)
+        {
+            return impl->descriptor_sizes;
+        }
+
+        // Observed descriptors per set with some headroom. Types that were not seen yet keep a few descriptors.
+        PoolSizes pool_sizes;
+        for (const auto& [type, size] : impl->descriptor_sizes)
+        {
+            if (!impl->observed_descriptors.contains(type))
+            {
+                pool_sizes.push_back({type, DESCRIPTOR_POOL_MIN_RATIO});
+            }
+        }
+
+        for (const auto& [type, count] : impl->observed_descriptors)
+        {
+            const f32 ratio = static_cast<f32>(count) / impl->observed_sets * DESCRIPTOR_POOL_HEADROOM;
+            pool_sizes.push_back({type, std::max(ratio, DESCRIPTOR_POOL_MIN_RATIO)});
+        }
+
+        return pool_sizes;
+    }
+
+    void DescriptorAllocator::IMPL::update_statistics()
+    {
+        statistics.used_pool_count = used_pools.size();
+        statistics.allocated_sets = set_pools.size();
+        statistics.peak_allocated_sets = std::max(statistics.peak_allocated_sets, statistics.allocated_sets);
+        statistics.set_capacity = used_pools.size() * DESCRIPTOR_POOL_SET_COUNT;
     }
 
     // DescriptorLayoutCache
@@ -186,6 +311,8 @@ namespace mag
                       { return a.binding < b.binding; });
         }
 
+        std::lock_guard<std::mutex> lock(layout_cache_mutex);
+
         // try to grab from cache
         auto it = layout_cache.find(layout_info);
         if (it != layout_cache.end())
@@ -316,7 +443,7 @@ namespace mag
         layout = cache->create_descriptor_layout(&layout_info);
 
         // allocate descriptor
-        b8 success = alloc->allocate(&set, layout);
+        b8 success = alloc->allocate(&set, layout, bindings);
         if (!success) return false;
 
         // write descriptor
@@ -359,11 +486,12 @@ namespace mag
     void DescriptorBuilder::create_descriptor_for_textures(const u32 binding,
                                                            const std::vector<ref<RendererImage>>& textures,
                                                            vk::DescriptorSet& descriptor_set,
-                                                           vk::DescriptorSetLayout& descriptor_set_layout)
+                                                           vk::DescriptorSetLayout& descriptor_set_layout,
+                                                           DescriptorAllocator* allocator)
     {
         // Create descriptors for this texture
         auto& descriptor_layout_cache = get_context().get_descriptor_layout_cache();
-        auto& descriptor_allocator = get_context().get_descriptor_allocator();
+        auto* descriptor_allocator = allocator != nullptr ? allocator : &get_context().get_descriptor_allocator();
 
         std::vector<vk::DescriptorImageInfo> descriptor_image_infos;
 
@@ -377,7 +505,7 @@ namespace mag
         }
 
         const b8 result =
-            DescriptorBuilder::begin(&descriptor_layout_cache, &descriptor_allocator)
+            DescriptorBuilder::begin(&descriptor_layout_cache, descriptor_allocator)
                 .bind(binding, vk::DescriptorType::eCombinedImageSampler,
                       vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, descriptor_image_infos)
                 .build(descriptor_set, descriptor_set_layout);
@@ -388,11 +516,12 @@ namespace mag
     void DescriptorBuilder::create_descriptor_for_textures(const u32 binding,
                                                            const std::vector<RendererImage*>& textures,
                                                            vk::DescriptorSet& descriptor_set,
-                                                           vk::DescriptorSetLayout& descriptor_set_layout)
+                                                           vk::DescriptorSetLayout& descriptor_set_layout,
+                                                           DescriptorAllocator* allocator)
     {
         // Create descriptors for this texture
         auto& descriptor_layout_cache = get_context().get_descriptor_layout_cache();
-        auto& descriptor_allocator = get_context().get_descriptor_allocator();
+        auto* descriptor_allocator = allocator != nullptr ? allocator : &get_context().get_descriptor_allocator();
 
         std::vector<vk::DescriptorImageInfo> descriptor_image_infos;
 
@@ -406,7 +535,7 @@ namespace mag
         }
 
         const b8 result =
-            DescriptorBuilder::begin(&descriptor_layout_cache, &descriptor_allocator)
+            DescriptorBuilder::begin(&descriptor_layout_cache, descriptor_allocator)
                 .bind(binding, vk::DescriptorType::eCombinedImageSampler,
                       vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, descriptor_image_infos)
                 .build(descriptor_set, descriptor_set_layout);
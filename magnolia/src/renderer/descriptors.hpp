@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -10,19 +11,44 @@ namespace mag
 {
     // DescriptorAllocator
     // ---------------------------------------------------------------------------------------------------------------------
+    enum class DescriptorAllocatorType
+    {
+        Persistent,  // Sets live until they are freed, empty pools are recycled
+        Frame        // Sets live until the pools are reset (once per frame in flight)
+    };
+
+    struct DescriptorAllocatorStatistics
+    {
+            u32 pool_count = 0;           // Pools created
+            u32 used_pool_count = 0;      // Pools holding sets
+            u64 allocated_sets = 0;       // Live sets
+            u64 peak_allocated_sets = 0;  // Most live sets at once
+            u64 set_capacity = 0;         // Sets the used pools can hold
+            u32 pool_overflows = 0;       // Allocations that needed another pool
+    };
+
     class DescriptorAllocator
     {
         public:
-            DescriptorAllocator();
+            DescriptorAllocator(const DescriptorAllocatorType type = DescriptorAllocatorType::Persistent);
             ~DescriptorAllocator();
 
             using PoolSizes = std::vector<std::pair<vk::DescriptorType, f32>>;
 
-            b8 allocate(vk::DescriptorSet* set, const vk::DescriptorSetLayout layout);
+            // The bindings of the layout are used to size the next pools from the observed usage
+            b8 allocate(vk::DescriptorSet* set, const vk::DescriptorSetLayout layout,
+                        const std::vector<vk::DescriptorSetLayoutBinding>& bindings);
+
+            // Persistent allocators only
+            void free(const vk::DescriptorSet set);
+
             void reset_pools();
 
+            const DescriptorAllocatorStatistics& get_statistics() const;
+
         private:
             vk::DescriptorPool grab_pool();
+            PoolSizes get_pool_sizes() const;
 
             struct IMPL;
             unique<IMPL> impl;
@@ -53,11 +79,9 @@ namespace mag
             };
 
             std::unordered_map<DescriptorLayoutInfo, vk::DescriptorSetLayout, DescriptorLayoutHash> layout_cache;
+            std::mutex layout_cache_mutex;
     };
 
-    // @TODO: for now descriptors are only freed when the application is closed. This means that eventually, we will run
-    // out of pool memory to create descriptors. If you resize the viewport enough times, this error happens.
-
     // DescriptorBuilder
     // ---------------------------------------------------------------------------------------------------------------------
     class RendererImage;
@@ -81,7 +105,8 @@ namespace mag
             b8 build(vk::DescriptorSet& set, vk::DescriptorSetLayout& layout);
             b8 build(vk::DescriptorSet& set);
 
-            // Helpers
+            // Helpers. Sets are allocated from the persistent allocator unless another one is provided (i.e. the
+            // frame allocator, see Context::get_frame_descriptor_allocator).
             static void create_descriptor_for_buffer(const u32 binding, vk::DescriptorSet& descriptor_set,
                                                      vk::DescriptorSetLayout& descriptor_set_layout,
                                                      const vk::DescriptorType type, const VulkanBuffer& buffer,
@@ -90,11 +115,13 @@ namespace mag
             static void create_descriptor_for_textures(const u32 binding,
                                                        const std::vector<ref<RendererImage>>& textures,
                                                        vk::DescriptorSet& descriptor_set,
-                                                       vk::DescriptorSetLayout& descriptor_set_layout);
+                                                       vk::DescriptorSetLayout& descriptor_set_layout,
+                                                       DescriptorAllocator* allocator = nullptr);
 
             static void create_descriptor_for_textures(const u32 binding, const std::vector<RendererImage*>& textures,
                                                        vk::DescriptorSet& descriptor_set,
-                                                       vk::DescriptorSetLayout& descriptor_set_layout);
+                                                       vk::DescriptorSetLayout& descriptor_set_layout,
+                                                       DescriptorAllocator* allocator = nullptr);
 
         private:
             std::vector<vk::WriteDescriptorSet> writes;
@@ -1,14 +1,88 @@
 #include "renderer/frame.hpp"
 
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <vulkan/vulkan.hpp>
 
 #include "core/assert.hpp"
 #include "core/logger.hpp"
 #include "renderer/context.hpp"
 #include "renderer/renderer_image.hpp"
+#include "renderer/upload_queue.hpp"
 
 namespace mag
 {
+    // ThreadCommandPools
+    // -----------------------------------------------------------------------------------------------------------------
+    struct ThreadCommandPools::IMPL
+    {
+            struct ThreadPool
+            {
+                    vk::CommandPool command_pool;
+                    std::deque<CommandBuffer> command_buffers;
+                    u32 used_command_buffers = 0;
+            };
+
+            // Nodes are not moved, so each thread keeps using its pool without holding the lock
+            std::map<std::thread::id, ThreadPool> thread_pools;
+            std::mutex thread_pools_mutex;
+    };
+
+    ThreadCommandPools::ThreadCommandPools() : impl(new IMPL()) {}
+
+    ThreadCommandPools::~ThreadCommandPools()
+    {
+        auto& context = get_context();
+
+        for (const auto& [thread_id, thread_pool] : impl->thread_pools)
+        {
+            context.get_device().destroyCommandPool(thread_pool.command_pool);
+        }
+    }
+
+    void ThreadCommandPools::reset()
+    {
+        auto& context = get_context();
+
+        for (auto& [thread_id, thread_pool] : impl->thread_pools)
+        {
+            context.get_device().resetCommandPool(thread_pool.command_pool);
+            thread_pool.used_command_buffers = 0;
+        }
+    }
+
+    CommandBuffer& ThreadCommandPools::get_secondary_command_buffer()
+    {
+        auto& context = get_context();
+
+        IMPL::ThreadPool* thread_pool = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(impl->thread_pools_mutex);
+
+            const auto [it, inserted] = impl->thread_pools.try_emplace(std::this_thread::get_id());
+            thread_pool = &it->second;
+
+            if (inserted)
+            {
+                const vk::CommandPoolCreateInfo command_pool_info({}, context.get_queue_family_index());
+                thread_pool->command_pool = context.get_device().createCommandPool(command_pool_info);
+            }
+        }
+
+        if (thread_pool->used_command_buffers == thread_pool->command_buffers.size())
+        {
+            thread_pool->command_buffers.emplace_back();
+            thread_pool->command_buffers.back().initialize(thread_pool->command_pool,
+                                                           vk::CommandBufferLevel::eSecondary);
+        }
+
+        return thread_pool->command_buffers[thread_pool->used_command_buffers++];
+    }
+
+    // FrameProvider
+    // -----------------------------------------------------------------------------------------------------------------
     void FrameProvider::initialize(const u32 frame_count)
     {
         auto& context = get_context();
@@ -29,6 +103,8 @@ namespace mag
             const vk::CommandPoolCreateInfo command_pool_info({}, context.get_queue_family_index());
             *frames[i].command_pool = context.get_device().createCommandPool(command_pool_info);
             frames[i].command_buffer.initialize(*frames[i].command_pool, vk::CommandBufferLevel::ePrimary);
+
+            frames[i].thread_command_pools = new ThreadCommandPools();
         }
     }
 
@@ -46,14 +122,35 @@ namespace mag
             delete frame.render_semaphore;
             delete frame.present_semaphore;
             delete frame.command_pool;
+            delete frame.thread_command_pools;
 
             frame.render_fence = nullptr;
             frame.render_semaphore = nullptr;
             frame.present_semaphore = nullptr;
             frame.command_pool = nullptr;
+            frame.thread_command_pools = nullptr;
+        }
+    }
+
+    void FrameProvider::flush_deletion_queues()
+    {
+        for (auto& frame : frames)
+        {
+            for (auto& function : frame.deletion_queue) function();
+            frame.deletion_queue.clear();
         }
     }
 
+    void FrameProvider::defer_deletion(std::function<void()>&& function)
+    {
+        // Between frames the current frame was not waited on yet and the last submitted one may still be running
+        auto& frame = frames[recording ? frame_number : last_submitted_frame];
+        frame.deletion_queue.push_back(std::move(function));
+
+        // Recorded uploads may also use the resource
+        frame.deletion_upload_value = get_context().get_upload_queue().get_recorded_value();
+    }
+
     // Start recording commands
     b8 FrameProvider::begin_frame()
     {
@@ -96,9 +193,21 @@ namespace mag
         VK_CHECK(device.waitForFences(*curr_frame.render_fence, true, Timeout));
         device.resetFences(*curr_frame.render_fence);
 
+        // The GPU is done with this frame
+        if (!curr_frame.deletion_queue.empty())
+        {
+            context.get_upload_queue().wait(curr_frame.deletion_upload_value);
+        }
+
+        for (auto& function : curr_frame.deletion_queue) function();
+        curr_frame.deletion_queue.clear();
+
         context.get_device().resetCommandPool(*curr_frame.command_pool);
+        curr_frame.thread_command_pools->reset();
         curr_frame.command_buffer.begin();
 
+        recording = true;
+
         return true;
     }
 
@@ -128,16 +237,29 @@ namespace mag
         // End command recording
         curr_frame.command_buffer.end();
 
-        std::vector<vk::PipelineStageFlags> wait_stage = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
+        // Submit the uploads recorded this frame, the frame waits on them (value is ignored for binary semaphores)
+        auto& upload_queue = context.get_upload_queue();
+        const u64 upload_value = upload_queue.flush();
+
+        std::vector<vk::PipelineStageFlags> wait_stage = {vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                                          vk::PipelineStageFlagBits::eAllCommands};
+        std::vector<vk::Semaphore> wait_semaphores = {*curr_frame.present_semaphore, upload_queue.get_semaphore()};
+        std::vector<u64> wait_values = {0, upload_value};
+
+        const vk::TimelineSemaphoreSubmitInfo timeline_submit_info(wait_values);
 
         vk::SubmitInfo submit;
         submit.setWaitDstStageMask(wait_stage)
-            .setWaitSemaphores(*curr_frame.present_semaphore)
+            .setWaitSemaphores(wait_semaphores)
             .setSignalSemaphores(*curr_frame.render_semaphore)
-            .setCommandBuffers(curr_frame.command_buffer.get_handle());
+            .setCommandBuffers(curr_frame.command_buffer.get_handle())
+            .setPNext(&timeline_submit_info);
 
         context.get_graphics_queue().submit(submit, *curr_frame.render_fence);
 
+        last_submitted_frame = frame_number;
+        recording = false;
+
         vk::PresentInfoKHR present_info;
         present_info.setSwapchains(context.get_swapchain())
             .setWaitSemaphores(*curr_frame.render_semaphore)
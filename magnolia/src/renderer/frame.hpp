@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "core/types.hpp"
@@ -10,6 +11,25 @@ namespace mag
     class Context;
     class RendererImage;
 
+    // Pools of the threads that record secondary command buffers (see RenderGraph). A pool can't be used by two threads
+    // at once, so each thread gets its own.
+    class ThreadCommandPools
+    {
+        public:
+            ThreadCommandPools();
+            ~ThreadCommandPools();
+
+            // The GPU is done with the command buffers, they are reused
+            void reset();
+
+            // Allocated from the pool of the calling thread
+            CommandBuffer& get_secondary_command_buffer();
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+
     struct Frame
     {
             vk::Fence* render_fence = nullptr;
@@ -17,6 +37,12 @@ namespace mag
             vk::Semaphore* present_semaphore = nullptr;
             vk::CommandPool* command_pool = nullptr;
             CommandBuffer command_buffer;
+            ThreadCommandPools* thread_command_pools = nullptr;
+
+            // Resources that may still be in use by this frame are destroyed the next time it begins (see
+            // FrameProvider::defer_deletion)
+            std::vector<std::function<void()>> deletion_queue;
+            u64 deletion_upload_value = 0;  // Uploads that must finish before the deletion queue is flushed
     };
 
     class FrameProvider
@@ -24,6 +50,10 @@ namespace mag
         public:
             void initialize(const u32 frame_count);
             void shutdown();
+            void flush_deletion_queues();
+
+            // Queues the deletion in the frame being recorded or, between frames, in the last submitted one
+            void defer_deletion(std::function<void()>&& function);
 
             b8 begin_frame();
             b8 end_frame(const RendererImage& draw_image, const vk::Extent3D& extent);
@@ -36,5 +66,7 @@ namespace mag
             std::vector<Frame> frames;
             u32 frame_number = {};
             u32 swapchain_image_index = {};
+            u32 last_submitted_frame = {};
+            b8 recording = false;
     };
 };  // namespace mag
@@ -0,0 +1,263 @@
+#include "renderer/geometry_arena.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan.hpp>
+
+#include "core/logger.hpp"
+#include "renderer/buffers.hpp"
+#include "renderer/command.hpp"
+#include "renderer/context.hpp"
+#include "renderer/upload_queue.hpp"
+
+namespace mag
+{
+    // RangeAllocator
+    // -----------------------------------------------------------------------------------------------------------------
+    RangeAllocator::RangeAllocator(const u64 capacity) : capacity(capacity)
+    {
+        if (capacity > 0)
+        {
+            free_ranges[0] = capacity;
+        }
+    }
+
+    b8 RangeAllocator::allocate(const u64 size, u64& offset)
+    {
+        for (auto it = free_ranges.begin(); it != free_ranges.end(); it++)
+        {
+            if (it->second < size)
+            {
+                continue;
+            }
+
+            offset = it->first;
+            const u64 remaining = it->second - size;
+
+            free_ranges.erase(it);
+            if (remaining > 0)
+            {
+                free_ranges[offset + size] = remaining;
+            }
+
+            used += size;
+            return true;
+        }
+
+        return false;
+    }
+
+    void RangeAllocator::free(const u64 offset, const u64 size)
+    {
+        used -= size;
+
+        auto it = free_ranges.emplace(offset, size).first;
+
+        // Merge with the next range
+        auto next = std::next(it);
+        if (next != free_ranges.end() && it->first + it->second == next->first)
+        {
+            it->second += next->second;
+            free_ranges.erase(next);
+        }
+
+        // And with the previous one
+        if (it != free_ranges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first)
+            {
+                prev->second += it->second;
+                free_ranges.erase(it);
+            }
+        }
+    }
+
+    void RangeAllocator::grow(const u64 new_capacity)
+    {
+        if (new_capacity <= capacity)
+        {
+            return;
+        }
+
+        // Same as releasing the new space
+        const u64 old_capacity = capacity;
+        capacity = new_capacity;
+        used += new_capacity - old_capacity;
+
+        free(old_capacity, new_capacity - old_capacity);
+    }
+
+    u64 RangeAllocator::get_capacity() const { return capacity; }
+
+    u64 RangeAllocator::get_used() const { return used; }
+
+    // GeometryArena
+    // -----------------------------------------------------------------------------------------------------------------
+
+    // Shared with the deferred releases, which may run after the arena is destroyed
+    struct GeometryRanges
+    {
+            GeometryRanges(const u64 vertex_capacity, const u64 index_capacity)
+                : vertices(vertex_capacity), indices(index_capacity)
+            {
+            }
+
+            RangeAllocator vertices;
+            RangeAllocator indices;
+    };
+
+    struct GeometryArena::IMPL
+    {
+            void initialize_buffer(VulkanBuffer& buffer, const u64 size_bytes, const vk::BufferUsageFlags usage);
+            void grow(VulkanBuffer& buffer, RangeAllocator& ranges, const u64 element_size, const u64 required,
+                      const vk::BufferUsageFlags usage);
+            void upload(VulkanBuffer& buffer, const void* data, const u64 size_bytes, const u64 offset);
+
+            u32 vertex_size;
+
+            VulkanBuffer vertex_buffer;
+            VulkanBuffer index_buffer;
+            ref<GeometryRanges> ranges;
+    };
+
+    GeometryArena::GeometryArena(const u32 vertex_size, const u64 vertex_capacity, const u64 index_capacity)
+        : impl(new GeometryArena::IMPL())
+    {
+        impl->vertex_size = vertex_size;
+        impl->ranges = create_ref<GeometryRanges>(vertex_capacity, index_capacity);
+
+        impl->initialize_buffer(impl->vertex_buffer, vertex_capacity * vertex_size,
+                                vk::BufferUsageFlagBits::eVertexBuffer);
+        impl->initialize_buffer(impl->index_buffer, index_capacity * sizeof(u32),
+                                vk::BufferUsageFlagBits::eIndexBuffer);
+    }
+
+    GeometryArena::~GeometryArena()
+    {
+        // Frames in flight and pending uploads may still be using the buffers
+        get_context().defer_deletion(
+            [vertex_buffer = impl->vertex_buffer, index_buffer = impl->index_buffer]() mutable
+            {
+                vertex_buffer.shutdown();
+                index_buffer.shutdown();
+            });
+    }
+
+    GeometryAllocation GeometryArena::allocate(const void* vertices, const u32 vertex_count, const u32* indices,
+                                               const u32 index_count)
+    {
+        GeometryAllocation allocation;
+
+        // Vulkan doesn't allow empty copies
+        if (vertex_count == 0 || index_count == 0)
+        {
+            return allocation;
+        }
+
+        auto& ranges = *impl->ranges;
+
+        u64 vertex_offset = 0;
+        if (!ranges.vertices.allocate(vertex_count, vertex_offset))
+        {
+            impl->grow(impl->vertex_buffer, ranges.vertices, impl->vertex_size, vertex_count,
+                       vk::BufferUsageFlagBits::eVertexBuffer);
+            ranges.vertices.allocate(vertex_count, vertex_offset);
+        }
+
+        u64 index_offset = 0;
+        if (!ranges.indices.allocate(index_count, index_offset))
+        {
+            impl->grow(impl->index_buffer, ranges.indices, sizeof(u32), index_count,
+                       vk::BufferUsageFlagBits::eIndexBuffer);
+            ranges.indices.allocate(index_count, index_offset);
+        }
+
+        impl->upload(impl->vertex_buffer, vertices, static_cast<u64>(vertex_count) * impl->vertex_size,
+                     vertex_offset * impl->vertex_size);
+        impl->upload(impl->index_buffer, indices, static_cast<u64>(index_count) * sizeof(u32),
+                     index_offset * sizeof(u32));
+
+        allocation.base_vertex = static_cast<u32>(vertex_offset);
+        allocation.vertex_count = vertex_count;
+        allocation.base_index = static_cast<u32>(index_offset);
+        allocation.index_count = index_count;
+
+        return allocation;
+    }
+
+    void GeometryArena::free(const GeometryAllocation& allocation)
+    {
+        if (allocation.vertex_count == 0 || allocation.index_count == 0)
+        {
+            return;
+        }
+
+        // The frames in flight may still be drawing the ranges
+        get_context().defer_deletion(
+            [ranges = impl->ranges, allocation]
+            {
+                ranges->vertices.free(allocation.base_vertex, allocation.vertex_count);
+                ranges->indices.free(allocation.base_index, allocation.index_count);
+            });
+    }
+
+    void GeometryArena::bind(CommandBuffer& command_buffer)
+    {
+        command_buffer.bind_vertex_buffer(impl->vertex_buffer);
+        command_buffer.bind_index_buffer(impl->index_buffer);
+    }
+
+    GeometryArenaStatistics GeometryArena::get_statistics() const
+    {
+        const auto& ranges = *impl->ranges;
+
+        return {ranges.vertices.get_used(), ranges.vertices.get_capacity(), ranges.indices.get_used(),
+                ranges.indices.get_capacity()};
+    }
+
+    void GeometryArena::IMPL::initialize_buffer(VulkanBuffer& buffer, const u64 size_bytes,
+                                                const vk::BufferUsageFlags usage)
+    {
+        // Transfer source so the contents can be copied when the buffer grows
+        buffer.initialize(size_bytes,
+                          usage | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+                          VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+    }
+
+    void GeometryArena::IMPL::grow(VulkanBuffer& buffer, RangeAllocator& ranges, const u64 element_size,
+                                   const u64 required, const vk::BufferUsageFlags usage)
+    {
+        auto& context = get_context();
+        auto& command_buffer = context.get_upload_queue().get_command_buffer();
+
+        const u64 capacity = ranges.get_capacity();
+        const u64 new_capacity = std::max(capacity * 2, capacity + required);
+
+        VulkanBuffer new_buffer;
+        initialize_buffer(new_buffer, new_capacity * element_size, usage);
+
+        // The uploads already recorded/submitted must finish before the old contents are copied
+        const vk::MemoryBarrier barrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead);
+        command_buffer.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                                    vk::PipelineStageFlagBits::eTransfer, {}, barrier, {}, {});
+
+        command_buffer.copy_buffer(buffer, new_buffer, capacity * element_size, 0, 0);
+
+        // The frames in flight keep using the old buffer
+        context.defer_deletion([old_buffer = buffer]() mutable { old_buffer.shutdown(); });
+
+        buffer = new_buffer;
+        ranges.grow(new_capacity);
+
+        LOG_INFO("Geometry arena grew from {0} to {1} elements", capacity, new_capacity);
+    }
+
+    void GeometryArena::IMPL::upload(VulkanBuffer& buffer, const void* data, const u64 size_bytes, const u64 offset)
+    {
+        auto& upload_queue = get_context().get_upload_queue();
+
+        // Copy data to the arena with the next upload batch
+        const StagingAllocation staging = upload_queue.stage(data, size_bytes);
+        upload_queue.get_command_buffer().copy_buffer(*staging.buffer, buffer, size_bytes, staging.offset, offset);
+    }
+};  // namespace mag
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+
+#include "core/types.hpp"
+
+namespace mag
+{
+#define GEOMETRY_ARENA_VERTEX_CAPACITY (1024 * 1024)     // Initial capacity in vertices
+#define GEOMETRY_ARENA_INDEX_CAPACITY (4 * 1024 * 1024)  // Initial capacity in indices (u32)
+
+    class CommandBuffer;
+
+    // First fit allocator of ranges in [0, capacity). Freed ranges are merged with their neighbours.
+    class RangeAllocator
+    {
+        public:
+            RangeAllocator(const u64 capacity);
+
+            b8 allocate(const u64 size, u64& offset);
+            void free(const u64 offset, const u64 size);
+
+            // The new space is added to the end
+            void grow(const u64 new_capacity);
+
+            u64 get_capacity() const;
+            u64 get_used() const;
+
+        private:
+            std::map<u64, u64> free_ranges;  // Offset -> size
+            u64 capacity;
+            u64 used = 0;
+    };
+
+    struct GeometryAllocation
+    {
+            u32 base_vertex = 0;
+            u32 vertex_count = 0;
+            u32 base_index = 0;
+            u32 index_count = 0;
+    };
+
+    struct GeometryArenaStatistics
+    {
+            u64 used_vertices = 0;
+            u64 vertex_capacity = 0;
+            u64 used_indices = 0;
+            u64 index_capacity = 0;
+    };
+
+    // One device local vertex buffer and one index buffer shared by every model, so they are bound once per pass
+    // instead of once per model. The data is copied with the next upload batch (see UploadQueue). Released ranges are
+    // only reused after the frames in flight are done with them and the buffers grow (and are copied) when they run
+    // out of space.
+    class GeometryArena
+    {
+        public:
+            GeometryArena(const u32 vertex_size, const u64 vertex_capacity = GEOMETRY_ARENA_VERTEX_CAPACITY,
+                          const u64 index_capacity = GEOMETRY_ARENA_INDEX_CAPACITY);
+            ~GeometryArena();
+
+            GeometryAllocation allocate(const void* vertices, const u32 vertex_count, const u32* indices,
+                                        const u32 index_count);
+            void free(const GeometryAllocation& allocation);
+
+            void bind(CommandBuffer& command_buffer);
+
+            GeometryArenaStatistics get_statistics() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
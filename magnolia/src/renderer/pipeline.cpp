@@ -1,22 +1,170 @@
 #include "renderer/pipeline.hpp"
 
+#include <atomic>
+#include <cstring>
 #include <vulkan/vulkan.hpp>
 
+#include "core/application.hpp"
+#include "core/buffer.hpp"
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+#include "platform/file_system.hpp"
 #include "private/renderer_type_conversions.hpp"
 #include "renderer/context.hpp"
 #include "renderer/frame.hpp"
 #include "renderer/shader.hpp"
 #include "spirv_reflect.h"
+#include "threads/job_system.hpp"
 
 namespace mag
 {
+#define PIPELINE_CACHE_FILE_MAGIC 0x4350504d  // "MPPC"
+#define PIPELINE_CACHE_FILE_VERSION 1
+
+    // PipelineCache
+    // -----------------------------------------------------------------------------------------------------------------
+    struct PipelineCacheFileHeader
+    {
+            u32 magic;
+            u32 version;
+            u32 vendor_id;
+            u32 device_id;
+            u32 driver_version;
+            u8 pipeline_cache_uuid[VK_UUID_SIZE];
+            u64 data_size;
+            u64 data_hash;
+    };
+
+    struct PipelineCache::IMPL
+    {
+            IMPL() = default;
+            ~IMPL() = default;
+
+            PipelineCacheFileHeader get_device_header() const;
+            b8 read(Buffer& data) const;
+
+            str file_path;
+            vk::PipelineCache pipeline_cache;
+    };
+
+    PipelineCache::PipelineCache(const str& file_path) : impl(new IMPL())
+    {
+        impl->file_path = file_path;
+
+        // Start empty if there is no data or it was written by another device/driver
+        Buffer initial_data;
+        if (fs::exists(file_path) && !impl->read(initial_data))
+        {
+            LOG_WARNING("Pipeline cache '{0}' is outdated, pipelines will be compiled again", file_path);
+        }
+
+        const vk::PipelineCacheCreateInfo pipeline_cache_info({}, initial_data.get_size(), initial_data.data.data());
+        impl->pipeline_cache = get_context().get_device().createPipelineCache(pipeline_cache_info);
+
+        LOG_INFO("Pipeline cache loaded: {0} bytes", initial_data.get_size());
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        save();
+
+        get_context().get_device().destroyPipelineCache(impl->pipeline_cache);
+    }
+
+    b8 PipelineCache::save()
+    {
+        const std::vector<u8> data = get_context().get_device().getPipelineCacheData(impl->pipeline_cache);
+
+        PipelineCacheFileHeader header = impl->get_device_header();
+        header.data_size = data.size();
+        header.data_hash = hash_data(data.data(), data.size());
+
+        Buffer buffer(sizeof(PipelineCacheFileHeader) + data.size());
+        memcpy(buffer.data.data(), &header, sizeof(PipelineCacheFileHeader));
+        memcpy(buffer.data.data() + sizeof(PipelineCacheFileHeader), data.data(), data.size());
+
+        if (!fs::write_binary_data(impl->file_path, buffer))
+        {
+            LOG_ERROR("Failed to write pipeline cache: '{0}'", impl->file_path);
+            return false;
+        }
+
+        return true;
+    }
+
+    const vk::PipelineCache& PipelineCache::get_handle() const { return impl->pipeline_cache; }
+
+    PipelineCacheFileHeader PipelineCache::IMPL::get_device_header() const
+    {
+        const auto properties = get_context().get_physical_device().getProperties();
+
+        PipelineCacheFileHeader header = {};
+        header.magic = PIPELINE_CACHE_FILE_MAGIC;
+        header.version = PIPELINE_CACHE_FILE_VERSION;
+        header.vendor_id = properties.vendorID;
+        header.device_id = properties.deviceID;
+        header.driver_version = properties.driverVersion;
+        memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+
+        return header;
+    }
+
+    b8 PipelineCache::IMPL::read(Buffer& data) const
+    {
+        Buffer buffer;
+        if (!fs::read_binary_data(file_path, buffer) || buffer.get_size() < sizeof(PipelineCacheFileHeader))
+        {
+            return false;
+        }
+
+        PipelineCacheFileHeader header;
+        memcpy(&header, buffer.data.data(), sizeof(PipelineCacheFileHeader));
+
+        // The driver also validates the data, but a cache from another driver version may be accepted and be useless
+        const PipelineCacheFileHeader device_header = get_device_header();
+        if (header.magic != device_header.magic || header.version != device_header.version ||
+            header.vendor_id != device_header.vendor_id || header.device_id != device_header.device_id ||
+            header.driver_version != device_header.driver_version ||
+            memcmp(header.pipeline_cache_uuid, device_header.pipeline_cache_uuid, VK_UUID_SIZE) != 0)
+        {
+            return false;
+        }
+
+        const u8* cache_data = buffer.data.data() + sizeof(PipelineCacheFileHeader);
+        if (buffer.get_size() != sizeof(PipelineCacheFileHeader) + header.data_size ||
+            hash_data(cache_data, header.data_size) != header.data_hash)
+        {
+            return false;
+        }
+
+        data.data = std::vector<u8>(cache_data, cache_data + header.data_size);
+
+        return true;
+    }
+
+    // Pipeline
+    // -----------------------------------------------------------------------------------------------------------------
     struct Pipeline::IMPL
     {
             IMPL() = default;
             ~IMPL() = default;
 
+            void create_pipeline();
+
             vk::Pipeline pipeline;
             vk::PipelineLayout pipeline_layout;
+
+            // Copied from the shader, the pipeline is created by a job
+            ShaderConfiguration shader_configuration;
+            std::vector<vk::VertexInputBindingDescription> vertex_bindings;
+            std::vector<vk::VertexInputAttributeDescription> vertex_attributes;
+            std::vector<vk::Format> color_attachment_formats;
+            vk::Format depth_format = {};
+
+            // Whoever claims the pipeline first (the job or a wait) creates it. Shared with the job so it can still
+            // check the claim after the pipeline is destroyed.
+            ref<std::atomic<b8>> claimed = create_ref<std::atomic<b8>>(false);
+            std::atomic<b8> ready = false;
     };
 
     Pipeline::Pipeline(const Shader& shader) : impl(new IMPL())
@@ -25,6 +173,79 @@ namespace mag
 
         const ShaderConfiguration& shader_configuration = shader.get_shader_configuration();
 
+        // The layout is needed right away to bind descriptors and push constants
+        vk::PipelineLayoutCreateInfo pipeline_layout_create_info({}, shader.get_descriptor_set_layouts(),
+                                                                 shader.get_push_constant_ranges());
+
+        impl->pipeline_layout = context.get_device().createPipelineLayout(pipeline_layout_create_info);
+
+        impl->shader_configuration = shader_configuration;
+        impl->vertex_bindings = shader.get_vertex_bindings();
+        impl->vertex_attributes = shader.get_vertex_attributes();
+
+        if (shader_configuration.color_write_enabled)
+        {
+            impl->color_attachment_formats.push_back(context.get_supported_color_format(ImageFormat::Float));
+        }
+
+        if (shader_configuration.depth_write_enabled)
+        {
+            impl->depth_format = context.get_supported_depth_format();
+        }
+
+        // Compiling the shader stages is the slow part of creating a pipeline, so the pipelines of every shader are
+        // compiled in parallel (on startup and when the shaders are reloaded). The pipeline is only waited for when it
+        // is bound.
+        auto execute = [impl = impl.get(), claimed = impl->claimed]
+        {
+            if (!claimed->exchange(true))
+            {
+                impl->create_pipeline();
+                impl->ready = true;
+            }
+
+            return true;
+        };
+
+        get_application().get_job_system().add_job(Job(execute, {}));
+    }
+
+    Pipeline::~Pipeline()
+    {
+        wait();
+
+        auto& context = get_context();
+        context.get_device().destroyPipeline(impl->pipeline);
+        context.get_device().destroyPipelineLayout(impl->pipeline_layout);
+    }
+
+    void Pipeline::wait()
+    {
+        // Compiles the pipeline here if the job has not started yet. Otherwise runs other jobs while the job finishes,
+        // so the waiting thread doesn't stall when every worker is busy.
+        if (!impl->claimed->exchange(true))
+        {
+            impl->create_pipeline();
+            impl->ready = true;
+        }
+
+        get_application().get_job_system().wait_until([impl = impl.get()] { return impl->ready.load(); });
+    }
+
+    void Pipeline::bind()
+    {
+        wait();
+
+        const CommandBuffer& command_buffer = get_context().get_command_buffer();
+        command_buffer.get_handle().bindPipeline(vk::PipelineBindPoint::eGraphics, impl->pipeline);
+    }
+
+    const void* Pipeline::get_layout() const { return &impl->pipeline_layout; }
+
+    void Pipeline::IMPL::create_pipeline()
+    {
+        auto& context = get_context();
+
         // Input assembly
 
         vk::PipelineInputAssemblyStateCreateInfo input_assembly_create_info =
@@ -69,11 +290,6 @@ namespace mag
             }
         }
 
-        vk::PipelineLayoutCreateInfo pipeline_layout_create_info({}, shader.get_descriptor_set_layouts(),
-                                                                 shader.get_push_constant_ranges());
-
-        impl->pipeline_layout = context.get_device().createPipelineLayout(pipeline_layout_create_info);
-
         const auto& shader_modules = shader_configuration.shader_modules;
 
         std::vector<vk::PipelineShaderStageCreateInfo> shader_stages;
@@ -87,8 +303,8 @@ namespace mag
         }
 
         // Extract vertex input info from vertex shader
-        const vk::PipelineVertexInputStateCreateInfo vertex_input_state_create_info({}, shader.get_vertex_bindings(),
-                                                                                    shader.get_vertex_attributes());
+        const vk::PipelineVertexInputStateCreateInfo vertex_input_state_create_info({}, vertex_bindings,
+                                                                                    vertex_attributes);
 
         const vk::PipelineMultisampleStateCreateInfo multisampling_state_create_info({}, vk::SampleCountFlagBits::e1,
                                                                                      false, 1.0f);
@@ -106,20 +322,6 @@ namespace mag
         const std::vector<vk::DynamicState> dynamic_states = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
         const vk::PipelineDynamicStateCreateInfo dynamic_state({}, dynamic_states);
 
-        const auto color_format = context.get_supported_color_format(ImageFormat::Float);
-
-        std::vector<vk::Format> color_attachment_formats;
-        if (shader_configuration.color_write_enabled)
-        {
-            color_attachment_formats.push_back(color_format);
-        }
-
-        vk::Format depth_format = {};
-        if (shader_configuration.depth_write_enabled)
-        {
-            depth_format = context.get_supported_depth_format();
-        }
-
         // Create pipeline
         const vk::PipelineRenderingCreateInfo pipeline_rendering_create_info({}, color_attachment_formats,
                                                                              depth_format);
@@ -127,26 +329,13 @@ namespace mag
         const vk::GraphicsPipelineCreateInfo pipeline_create_info(
             {}, shader_stages, &vertex_input_state_create_info, &input_assembly_create_info, {}, &viewport_state,
             &rasterization_create_info, &multisampling_state_create_info, &depth_stencil_create_info, &color_blending,
-            &dynamic_state, impl->pipeline_layout, {}, {}, {}, {}, &pipeline_rendering_create_info);
-
-        const auto result_value = context.get_device().createGraphicsPipeline({}, pipeline_create_info);
-        VK_CHECK(result_value.result);
+            &dynamic_state, pipeline_layout, {}, {}, {}, {}, &pipeline_rendering_create_info);
 
-        impl->pipeline = result_value.value;
-    }
+        const vk::PipelineCache& pipeline_cache = context.get_pipeline_cache().get_handle();
 
-    Pipeline::~Pipeline()
-    {
-        auto& context = get_context();
-        context.get_device().destroyPipeline(impl->pipeline);
-        context.get_device().destroyPipelineLayout(impl->pipeline_layout);
-    }
+        const auto result_value = context.get_device().createGraphicsPipeline(pipeline_cache, pipeline_create_info);
+        VK_CHECK(result_value.result);
 
-    void Pipeline::bind()
-    {
-        const CommandBuffer& command_buffer = get_context().get_curr_frame().command_buffer;
-        command_buffer.get_handle().bindPipeline(vk::PipelineBindPoint::eGraphics, impl->pipeline);
+        pipeline = result_value.value;
     }
-
-    const void* Pipeline::get_layout() const { return &impl->pipeline_layout; }
 };  // namespace mag
@@ -1,18 +1,39 @@
 #pragma once
 
 #include "core/types.hpp"
+#include "private/vulkan_fwd.hpp"
 
 namespace mag
 {
     class Shader;
 
+    // Shared by every pipeline, so the stages compiled by one pipeline are reused by the others and by the next runs.
+    // The data is saved when the cache is destroyed and only loaded if it was written by the same device and driver.
+    class PipelineCache
+    {
+        public:
+            PipelineCache(const str& file_path);
+            ~PipelineCache();
+
+            b8 save();
+
+            const vk::PipelineCache& get_handle() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+
+    // The pipeline is created in the background (see JobSystem), the layout is available right away
     class Pipeline
     {
         public:
             Pipeline(const Shader& shader);
             ~Pipeline();
 
+            // Waits for the pipeline to be created, or creates it if its job has not started
             void bind();
+            void wait();
 
             const void* get_layout() const;
 
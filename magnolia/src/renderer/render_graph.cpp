@@ -1,11 +1,16 @@
 #include "renderer/render_graph.hpp"
 
+#include <atomic>
+#include <thread>
 #include <vulkan/vulkan.hpp>
 
+#include "core/application.hpp"
 #include "core/assert.hpp"
 #include "private/renderer_type_conversions.hpp"
 #include "renderer/context.hpp"
 #include "renderer/frame.hpp"
+#include "renderer/renderer.hpp"
+#include "threads/job_system.hpp"
 #include "tools/profiler.hpp"
 
 // @TODO: reimplement missing features:
@@ -14,6 +19,17 @@
 
 namespace mag
 {
+    // Command buffers of the passes of a frame. The jobs of the parallel passes keep it alive, since a job may only run
+    // after the frame was recorded (when the pass was recorded by another thread).
+    struct RecordedPasses
+    {
+            RecordedPasses(const u64 pass_count) : claimed(pass_count), command_buffers(pass_count, nullptr) {}
+
+            std::vector<std::atomic<b8>> claimed;
+            std::vector<CommandBuffer*> command_buffers;
+            std::atomic<u32> remaining_parallel_passes = 0;
+    };
+
     RenderGraphPass::RenderGraphPass(const str& name) : name(name) {}
     RenderGraphPass::~RenderGraphPass() = default;
 
@@ -154,16 +170,77 @@ namespace mag
     void RenderGraph::execute()
     {
         auto& context = get_context();
+        auto& job_system = get_application().get_job_system();
         auto& command_buffer = context.get_curr_frame().command_buffer;
 
         const u32 curr_frame = context.get_curr_frame_number();
 
-        // Execute passes
-        for (auto* render_pass : passes)
+        // Each pass is recorded to its own secondary command buffer. The workers record the parallel passes while this
+        // thread records the other ones. Passes after the last parallel pass are only recorded once the workers are
+        // done, so they may change the scene (i.e. the editor UI).
+        auto recorded_passes = create_ref<RecordedPasses>(passes.size());
+
+        // The pass is recorded by the first thread that claims it
+        const auto record_parallel_pass = [this, recorded_passes](const u64 index)
+        {
+            if (!recorded_passes->claimed[index].exchange(true))
+            {
+                recorded_passes->command_buffers[index] = &record_render_pass(passes[index]);
+                recorded_passes->remaining_parallel_passes--;
+            }
+        };
+
+        u64 trailing_passes_begin = 0;
+        for (u64 i = 0; i < passes.size(); i++)
+        {
+            if (passes[i]->pass.record_in_parallel)
+            {
+                recorded_passes->remaining_parallel_passes++;
+                trailing_passes_begin = i + 1;
+
+                auto execute = [record_parallel_pass, i]
+                {
+                    record_parallel_pass(i);
+                    return true;
+                };
+
+                job_system.add_job(Job(execute, {}));
+            }
+        }
+
+        for (u64 i = 0; i < trailing_passes_begin; i++)
+        {
+            if (!passes[i]->pass.record_in_parallel)
+            {
+                recorded_passes->command_buffers[i] = &record_render_pass(passes[i]);
+            }
+        }
+
+        // Record the parallel passes that no worker started yet instead of running other jobs while waiting
+        for (u64 i = 0; i < trailing_passes_begin; i++)
+        {
+            if (passes[i]->pass.record_in_parallel)
+            {
+                record_parallel_pass(i);
+            }
+        }
+
+        while (recorded_passes->remaining_parallel_passes > 0)
+        {
+            std::this_thread::yield();
+        }
+
+        for (u64 i = trailing_passes_begin; i < passes.size(); i++)
+        {
+            recorded_passes->command_buffers[i] = &record_render_pass(passes[i]);
+        }
+
+        // Execute passes in order
+        for (u64 i = 0; i < passes.size(); i++)
         {
-            SCOPED_PROFILE(render_pass->get_name());
+            auto* render_pass = passes[i];
 
-            execute_render_pass(render_pass);
+            execute_render_pass(render_pass, *recorded_passes->command_buffers[i]);
 
             // Transition layout
             for (const auto& description : render_pass->attachment_descriptions)
@@ -197,7 +274,68 @@ namespace mag
         }
     }
 
-    void RenderGraph::execute_render_pass(RenderGraphPass* render_pass)
+    CommandBuffer& RenderGraph::record_render_pass(RenderGraphPass* render_pass)
+    {
+        SCOPED_PROFILE(render_pass->get_name());
+
+        auto& context = get_context();
+        auto& pass = render_pass->pass;
+
+        const u32 curr_frame = context.get_curr_frame_number();
+
+        // Formats of the attachments the pass renders to, their layouts are transitioned when the pass is executed
+        std::vector<vk::Format> color_formats;
+        vk::Format depth_format = vk::Format::eUndefined;
+
+        for (const auto& description : render_pass->attachment_descriptions)
+        {
+            if (description.stage != AttachmentStage::Output)
+            {
+                continue;
+            }
+
+            const vk::Format format = attachments.at(description.name)[curr_frame].texture->get_format();
+
+            // Same as the rendering info, only one color attachment is used
+            if (description.type == AttachmentType::Color)
+            {
+                color_formats = {format};
+            }
+
+            else
+            {
+                depth_format = format;
+            }
+        }
+
+        CommandBuffer& command_buffer = context.get_curr_frame().thread_command_pools->get_secondary_command_buffer();
+        command_buffer.begin(color_formats, depth_format);
+
+        // The viewport and scissor are not inherited. Flip the viewport along the Y axis.
+        const vk::Rect2D scissor = vk::Rect2D({}, mag_to_vk(pass.size));
+        const vk::Viewport viewport(0, scissor.extent.height, scissor.extent.width,
+                                    -static_cast<i32>(scissor.extent.height), 0.0f, 1.0f);
+
+        command_buffer.get_handle().setViewport(0, viewport);
+        command_buffer.get_handle().setScissor(0, scissor);
+
+        // Draws are recorded to the command buffer of the pass, starting without a shader. The thread may be waiting
+        // inside another pass (i.e. for a pipeline), so its state is restored afterwards.
+        auto& renderer = get_application().get_renderer();
+
+        CommandBuffer* previous_command_buffer = context.set_command_buffer(&command_buffer);
+        Shader* previous_shader = renderer.set_active_shader(nullptr);
+
+        render_pass->on_render(*this);
+
+        renderer.set_active_shader(previous_shader);
+        context.set_command_buffer(previous_command_buffer);
+        command_buffer.end();
+
+        return command_buffer;
+    }
+
+    void RenderGraph::execute_render_pass(RenderGraphPass* render_pass, const CommandBuffer& pass_command_buffer)
     {
         auto& context = get_context();
         auto& command_buffer = context.get_curr_frame().command_buffer;
@@ -272,11 +410,6 @@ namespace mag
         }
 
         const vk::Rect2D render_area = vk::Rect2D({}, mag_to_vk(pass.size));
-        const vk::Rect2D scissor = render_area;
-
-        // Flip the viewport along the Y axis
-        const vk::Viewport viewport(0, render_area.extent.height, render_area.extent.width,
-                                    -static_cast<i32>(render_area.extent.height), 0.0f, 1.0f);
 
         std::vector<vk::RenderingAttachmentInfo> color_attachments;
         if (pass.color_attachment != nullptr)
@@ -285,24 +418,21 @@ namespace mag
             color_attachments.push_back(*static_cast<vk::RenderingAttachmentInfo*>(pass.color_attachment));
         }
 
+        // The commands of the pass were recorded to a secondary command buffer
         pass.rendering_info =
-            new vk::RenderingInfo({}, render_area, 1, {}, color_attachments,
-                                  static_cast<vk::RenderingAttachmentInfo*>(pass.depth_attachment), {});
-
-        command_buffer.get_handle().setViewport(0, viewport);
-        command_buffer.get_handle().setScissor(0, scissor);
+            new vk::RenderingInfo(vk::RenderingFlagBits::eContentsSecondaryCommandBuffers, render_area, 1, {},
+                                  color_attachments, static_cast<vk::RenderingAttachmentInfo*>(pass.depth_attachment),
+                                  {});
 
         command_buffer.begin_rendering(*static_cast<vk::RenderingInfo*>(render_pass->pass.rendering_info));
-
-        render_pass->on_render(*this);
-
+        command_buffer.execute_commands(pass_command_buffer);
         command_buffer.end_rendering();
     }
 
     RendererImage& RenderGraph::get_attachment(const str& attachment_name)
     {
         const u32 curr_frame = get_context().get_curr_frame_number();
-        return *attachments[attachment_name][curr_frame].texture;
+        return *attachments.at(attachment_name)[curr_frame].texture;
     }
 
     RendererImage& RenderGraph::get_output_attachment() { return get_attachment(output_attachment_name); }
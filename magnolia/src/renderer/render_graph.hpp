@@ -48,6 +48,9 @@ namespace mag
     {
             u32 rendered_triangles = 0;
             u32 draw_calls = 0;
+            u32 draw_commands = 0;          // Commands of the indirect draws, one call submits many
+            u32 state_changes = 0;          // Material binds
+            u32 skipped_state_changes = 0;  // Draws that reused the bound material
     };
 
     struct Pass
@@ -59,8 +62,13 @@ namespace mag
             vec4 color_clear_value = vec4(0.0f, 1.0f, 1.0f, 1.0f);
             vec2 depth_stencil_clear_value = vec2(1.0f, 0.0f);
             uvec2 size = {};
+
+            // The pass is recorded by a worker, while the other passes are recorded (see RenderGraph::execute). It
+            // must not change state that the other passes use.
+            b8 record_in_parallel = false;
     };
 
+    class CommandBuffer;
     class RenderGraph;
     class RenderGraphPass
     {
@@ -113,7 +121,8 @@ namespace mag
             const std::vector<RenderGraphPass*>& get_passes() const;
 
         private:
-            void execute_render_pass(RenderGraphPass* render_pass);
+            CommandBuffer& record_render_pass(RenderGraphPass* render_pass);
+            void execute_render_pass(RenderGraphPass* render_pass, const CommandBuffer& pass_command_buffer);
 
             std::vector<RenderGraphPass*> passes;
             std::map<str, std::vector<Attachment>> attachments;  // One per frame in flight
@@ -0,0 +1,88 @@
+#include "renderer/render_queue.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace mag
+{
+#define SORT_KEY_PASS_SHIFT 60
+#define SORT_KEY_PIPELINE_SHIFT 48
+#define SORT_KEY_MATERIAL_SHIFT 32
+#define SORT_KEY_GEOMETRY_SHIFT 16
+
+#define SORT_KEY_PASS_MASK 0xF
+#define SORT_KEY_PIPELINE_MASK 0xFFF
+#define SORT_KEY_MATERIAL_MASK 0xFFFF
+#define SORT_KEY_GEOMETRY_MASK 0xFFFF
+#define SORT_KEY_DEPTH_MASK 0xFFFF
+
+    u64 RenderQueue::make_sort_key(const u32 pass, const u32 pipeline, const u32 material, const u32 geometry,
+                                   const f32 depth)
+    {
+        const u64 quantized_depth = static_cast<u64>(std::clamp(depth, 0.0f, 1.0f) * SORT_KEY_DEPTH_MASK);
+
+        return (static_cast<u64>(pass & SORT_KEY_PASS_MASK) << SORT_KEY_PASS_SHIFT) |
+               (static_cast<u64>(pipeline & SORT_KEY_PIPELINE_MASK) << SORT_KEY_PIPELINE_SHIFT) |
+               (static_cast<u64>(material & SORT_KEY_MATERIAL_MASK) << SORT_KEY_MATERIAL_SHIFT) |
+               (static_cast<u64>(geometry & SORT_KEY_GEOMETRY_MASK) << SORT_KEY_GEOMETRY_SHIFT) | quantized_depth;
+    }
+
+    u32 RenderQueue::get_pass(const u64 sort_key) { return (sort_key >> SORT_KEY_PASS_SHIFT) & SORT_KEY_PASS_MASK; }
+
+    u32 RenderQueue::get_pipeline(const u64 sort_key)
+    {
+        return (sort_key >> SORT_KEY_PIPELINE_SHIFT) & SORT_KEY_PIPELINE_MASK;
+    }
+
+    u32 RenderQueue::get_material(const u64 sort_key)
+    {
+        return (sort_key >> SORT_KEY_MATERIAL_SHIFT) & SORT_KEY_MATERIAL_MASK;
+    }
+
+    u32 RenderQueue::get_geometry(const u64 sort_key)
+    {
+        return (sort_key >> SORT_KEY_GEOMETRY_SHIFT) & SORT_KEY_GEOMETRY_MASK;
+    }
+
+    void RenderQueue::clear() { packets.clear(); }
+
+    void RenderQueue::push(const u64 sort_key, const u32 index) { packets.push_back({sort_key, index}); }
+
+    void RenderQueue::sort()
+    {
+        const u64 count = packets.size();
+        sorted_packets.resize(count);
+
+        for (u32 shift = 0; shift < 64; shift += 8)
+        {
+            std::array<u64, 256> offsets = {};
+            for (const auto& packet : packets)
+            {
+                offsets[(packet.sort_key >> shift) & 0xFF]++;
+            }
+
+            // Every key has the same byte, the order doesn't change
+            if (std::find(offsets.begin(), offsets.end(), count) != offsets.end())
+            {
+                continue;
+            }
+
+            u64 offset = 0;
+            for (auto& bucket : offsets)
+            {
+                const u64 bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+
+            for (const auto& packet : packets)
+            {
+                sorted_packets[offsets[(packet.sort_key >> shift) & 0xFF]++] = packet;
+            }
+
+            packets.swap(sorted_packets);
+        }
+    }
+
+    const std::vector<RenderPacket>& RenderQueue::get_packets() const { return packets; }
+};  // namespace mag
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    // Draw of a pass, 'index' refers to the data of the pass (i.e. a batch of instances)
+    struct RenderPacket
+    {
+            u64 sort_key;
+            u32 index;
+    };
+
+    // Flat list of draw packets sorted by a 64 bit key. From the most to the least significant bits:
+    //
+    // | pass (4) | pipeline (12) | material (16) | geometry (16) | depth (16) |
+    //
+    // Packets that share a state end up next to each other, so a pass only binds the state when it changes while
+    // replaying the queue. Depth orders the draws of the same state front to back.
+    class RenderQueue
+    {
+        public:
+            // Fields are truncated to their bits. Depth is normalized to [0, 1].
+            static u64 make_sort_key(const u32 pass, const u32 pipeline, const u32 material, const u32 geometry,
+                                     const f32 depth);
+
+            static u32 get_pass(const u64 sort_key);
+            static u32 get_pipeline(const u64 sort_key);
+            static u32 get_material(const u64 sort_key);
+            static u32 get_geometry(const u64 sort_key);
+
+            void clear();
+            void push(const u64 sort_key, const u32 index);
+
+            // Stable LSD radix sort, bytes shared by every key are skipped
+            void sort();
+
+            const std::vector<RenderPacket>& get_packets() const;
+
+        private:
+            std::vector<RenderPacket> packets;
+            std::vector<RenderPacket> sorted_packets;
+    };
+};  // namespace mag
@@ -7,30 +7,55 @@
 #include "core/logger.hpp"
 #include "core/window.hpp"
 #include "private/renderer_type_conversions.hpp"
+#include "renderer/bindless_textures.hpp"
 #include "renderer/buffers.hpp"
 #include "renderer/context.hpp"
 #include "renderer/frame.hpp"
+#include "renderer/geometry_arena.hpp"
 #include "renderer/render_graph.hpp"
 #include "renderer/renderer_image.hpp"
 #include "renderer/test_model.hpp"
+#include "renderer/upload_queue.hpp"
+#include "renderer/shader.hpp"
 #include "resources/image.hpp"
 #include "resources/model.hpp"
 
 namespace mag
 {
+// Indirect draw commands per frame, shared by every pass
+#define MAX_INDIRECT_DRAWS 32'768
+
+// Uniform and storage data per frame, shared by every shader
+#define UNIFORM_ALLOCATOR_SIZE (8ull * 1024 * 1024)
+
+    // Its uniforms are uploaded before each draw. Passes may be recorded in parallel (see RenderGraph), so each thread
+    // has its own.
+    static thread_local Shader* active_shader = nullptr;
+
     struct Renderer::IMPL
     {
             IMPL() = default;
             ~IMPL() = default;
 
+            vk::Format get_image_format(const Image* image) const;
+
             unique<Context> context;
 
-            // Model data
-            std::map<Model*, ref<VertexBuffer>> vertex_buffers;
-            std::map<Model*, ref<IndexBuffer>> index_buffers;
+            // Model data, all models share the arena buffers
+            unique<GeometryArena> geometry_arena;
+            std::map<Model*, GeometryAllocation> geometry_allocations;
+
+            unique<IndirectBuffer> indirect_buffer;
+            b8 indirect_draws = false;
+
+            unique<UniformAllocator> uniform_allocator;
 
             // Image data
             std::map<Image*, ref<RendererImage>> images;
+
+            // Every uploaded image has a slot in the bindless texture array
+            unique<BindlessTextures> bindless_textures;
+            std::map<Image*, u32> texture_indices;
     };
 
     Renderer::Renderer(Window& window) : impl(new IMPL())
@@ -39,17 +64,35 @@ namespace mag
         const ContextCreateOptions context_options = {.window = window};
         impl->context = create_unique<Context>(context_options);
         LOG_SUCCESS("Context initialized");
+
+        impl->geometry_arena = create_unique<GeometryArena>(sizeof(Vertex));
+        impl->indirect_buffer = create_unique<IndirectBuffer>(MAX_INDIRECT_DRAWS);
+        impl->uniform_allocator = create_unique<UniformAllocator>(UNIFORM_ALLOCATOR_SIZE);
+        impl->indirect_draws = impl->context->is_indirect_draw_supported();
+        impl->bindless_textures = create_unique<BindlessTextures>();
     }
 
     Renderer::~Renderer() = default;
 
     void Renderer::on_update(RenderGraph& render_graph)
     {
-        if (!impl->context->begin_frame()) return;
+        if (!impl->context->begin_frame())
+        {
+            // Uploads are normally submitted with the frame
+            impl->context->get_upload_queue().flush();
+            return;
+        }
+
         impl->context->begin_timestamp();  // Performance query
 
+        impl->indirect_buffer->begin_frame();
+        impl->uniform_allocator->begin_frame();
+        impl->bindless_textures->begin_frame();
+
         render_graph.execute();
 
+        active_shader = nullptr;
+
         impl->context->end_timestamp();
 
         // Present
@@ -64,85 +107,142 @@ namespace mag
     void Renderer::draw(const u32 vertex_count, const u32 instance_count, const u32 first_vertex,
                         const u32 first_instance)
     {
-        auto& command_buffer = impl->context->get_curr_frame().command_buffer;
+        flush_uniforms();
+
+        auto& command_buffer = impl->context->get_command_buffer();
         command_buffer.draw(vertex_count, instance_count, first_vertex, first_instance);
     }
 
     void Renderer::draw_indexed(const u32 index_count, const u32 instance_count, const u32 first_index,
                                 const i32 vertex_offset, const u32 first_instance)
     {
-        auto& command_buffer = impl->context->get_curr_frame().command_buffer;
+        flush_uniforms();
+
+        auto& command_buffer = impl->context->get_command_buffer();
         command_buffer.draw_indexed(index_count, instance_count, first_index, vertex_offset, first_instance);
     }
 
-    void Renderer::bind_buffers(Model* model)
+    u32 Renderer::draw_indexed_indirect(const DrawIndexedCommand* commands, const u32 count)
     {
-        auto vbo_it = impl->vertex_buffers.find(model);
-        auto ibo_it = impl->index_buffers.find(model);
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        flush_uniforms();
 
-        if (vbo_it == impl->vertex_buffers.end() || ibo_it == impl->index_buffers.end())
+        auto& command_buffer = impl->context->get_command_buffer();
+
+        u64 offset = 0;
+        if (impl->indirect_draws && impl->indirect_buffer->write(commands, count, offset))
         {
-            LOG_ERROR("Model '{0}' was not uploaded to the GPU", static_cast<void*>(model));
+            command_buffer.draw_indexed_indirect(impl->indirect_buffer->get_buffer(), offset, count,
+                                                 sizeof(DrawIndexedCommand));
+            return 1;
+        }
+
+        for (u32 i = 0; i < count; i++)
+        {
+            const auto& command = commands[i];
+            command_buffer.draw_indexed(command.index_count, command.instance_count, command.first_index,
+                                        command.vertex_offset, command.first_instance);
+        }
+
+        return count;
+    }
+
+    void Renderer::set_indirect_draws(const b8 enabled)
+    {
+        if (enabled && !impl->context->is_indirect_draw_supported())
+        {
+            LOG_WARNING("Indirect draws are not supported by the device, using direct draws");
+            impl->indirect_draws = false;
             return;
         }
 
-        auto& command_buffer = impl->context->get_curr_frame().command_buffer;
+        impl->indirect_draws = enabled;
+    }
+
+    b8 Renderer::is_indirect_draws_enabled() const { return impl->indirect_draws; }
+
+    Shader* Renderer::set_active_shader(Shader* shader) { return std::exchange(active_shader, shader); }
 
-        // Bind buffers
-        command_buffer.bind_vertex_buffer(vbo_it->second->get_buffer());
-        command_buffer.bind_index_buffer(ibo_it->second->get_buffer());
+    UniformAllocator& Renderer::get_uniform_allocator() { return *impl->uniform_allocator; }
+
+    void Renderer::flush_uniforms()
+    {
+        if (active_shader != nullptr)
+        {
+            active_shader->flush_uniforms();
+        }
+    }
+
+    void Renderer::bind_geometry()
+    {
+        auto& command_buffer = impl->context->get_command_buffer();
+
+        impl->geometry_arena->bind(command_buffer);
     }
 
     void Renderer::bind_buffers(Line* line)
     {
-        auto& command_buffer = impl->context->get_curr_frame().command_buffer;
+        auto& command_buffer = impl->context->get_command_buffer();
 
         command_buffer.bind_vertex_buffer(line->get_vbo().get_buffer());
     }
 
     void Renderer::update_model(Model* model)
     {
-        auto vbo_it = impl->vertex_buffers.find(model);
-        auto ibo_it = impl->index_buffers.find(model);
+        auto it = impl->geometry_allocations.find(model);
 
-        if (vbo_it == impl->vertex_buffers.end() || ibo_it == impl->index_buffers.end())
+        if (it == impl->geometry_allocations.end())
         {
             LOG_ERROR("Model '{0}' was not uploaded to the GPU", static_cast<void*>(model));
             return;
         }
 
-        impl->vertex_buffers[model]->resize(model->vertices.data(), VEC_SIZE_BYTES(model->vertices));
-        impl->index_buffers[model]->resize(model->indices.data(), VEC_SIZE_BYTES(model->indices));
+        // The old ranges are released once the frames in flight are done with them
+        impl->geometry_arena->free(it->second);
+        impl->geometry_allocations.erase(it);
+
+        upload_model(model);
     }
 
     void Renderer::upload_model(Model* model)
     {
-        auto vbo_it = impl->vertex_buffers.find(model);
-        auto ibo_it = impl->index_buffers.find(model);
-
-        if (vbo_it != impl->vertex_buffers.end() || ibo_it != impl->index_buffers.end())
+        if (impl->geometry_allocations.contains(model))
         {
             LOG_WARNING("Model '{0}' was already uploaded to the GPU", static_cast<void*>(model));
             return;
         }
 
-        impl->vertex_buffers[model] = create_ref<VertexBuffer>(model->vertices.data(), VEC_SIZE_BYTES(model->vertices));
-        impl->index_buffers[model] = create_ref<IndexBuffer>(model->indices.data(), VEC_SIZE_BYTES(model->indices));
+        const GeometryAllocation allocation = impl->geometry_arena->allocate(
+            model->vertices.data(), static_cast<u32>(model->vertices.size()), model->indices.data(),
+            static_cast<u32>(model->indices.size()));
+
+        model->base_vertex = allocation.base_vertex;
+        model->base_index = allocation.base_index;
+
+        impl->geometry_allocations[model] = allocation;
     }
 
     void Renderer::remove_model(Model* model)
     {
-        auto vbo_it = impl->vertex_buffers.find(model);
-        auto ibo_it = impl->index_buffers.find(model);
+        auto it = impl->geometry_allocations.find(model);
 
-        if (vbo_it == impl->vertex_buffers.end() || ibo_it == impl->index_buffers.end())
+        if (it == impl->geometry_allocations.end())
         {
             LOG_ERROR("Tried to remove invalid model '{0}'", static_cast<void*>(model));
             return;
         }
 
-        impl->vertex_buffers.erase(vbo_it);
-        impl->index_buffers.erase(ibo_it);
+        impl->geometry_arena->free(it->second);
+        impl->geometry_allocations.erase(it);
+    }
+
+    GeometryArenaStatistics Renderer::get_geometry_statistics() const
+    {
+        return impl->geometry_arena->get_statistics();
     }
 
     ref<RendererImage> Renderer::get_renderer_image(Image* image)
@@ -168,7 +268,22 @@ namespace mag
             return;
         }
 
-        it->second->set_pixels(image->pixels);
+        // Recreating the renderer image keeps its format, so it must match
+        if (it->second->get_format() != impl->get_image_format(image))
+        {
+            LOG_ERROR("Image '{0}' format changed after upload", static_cast<void*>(image));
+            return;
+        }
+
+        // The upload queue does not wait for the frames in flight, which may still sample the image. The image is
+        // always recreated, even with the same dimensions, so the new pixels never overwrite it.
+        const uvec3 extent(image->width, image->height, 1);
+        it->second->recreate(extent, image->mip_levels);
+
+        it->second->set_pixels(image->pixels, get_mip_offsets(*image));
+
+        // The image view may have changed
+        impl->bindless_textures->update(impl->texture_indices[image], *it->second);
     }
 
     ref<RendererImage> Renderer::upload_image(Image* image)
@@ -182,17 +297,32 @@ namespace mag
         }
 
         const uvec3 extent(image->width, image->height, 1);
-        const vk::Format format = get_context().get_supported_color_format(ImageFormat::Srgb);
+        const vk::Format format = impl->get_image_format(image);
 
         impl->images[image] =
-            create_ref<RendererImage>(extent, ImageType::Texture, image->pixels, format,
+            create_ref<RendererImage>(extent, ImageType::Texture, format,
                                       vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc |
                                           vk::ImageUsageFlagBits::eTransferDst,
                                       vk::ImageAspectFlagBits::eColor, image->mip_levels, SampleCount::_1);
 
+        impl->images[image]->set_pixels(image->pixels, get_mip_offsets(*image));
+
+        impl->texture_indices[image] = impl->bindless_textures->add(*impl->images[image]);
+
         return impl->images[image];
     }
 
+    vk::Format Renderer::IMPL::get_image_format(const Image* image) const
+    {
+        if (image->format == TextureFormat::RGBA8)
+        {
+            const b8 srgb = image->color_space == ColorSpace::Srgb;
+            return context->get_supported_color_format(srgb ? ImageFormat::Srgb : ImageFormat::Unorm);
+        }
+
+        return mag_to_vk(image->format, image->color_space);
+    }
+
     void Renderer::remove_image(Image* image)
     {
         auto it = impl->images.find(image);
@@ -204,8 +334,25 @@ namespace mag
         }
 
         impl->images.erase(it);
+
+        impl->bindless_textures->remove(impl->texture_indices[image]);
+        impl->texture_indices.erase(image);
     }
 
+    u32 Renderer::get_texture_index(Image* image) const
+    {
+        auto it = impl->texture_indices.find(image);
+
+        if (it == impl->texture_indices.end() || !impl->bindless_textures->is_valid(it->second))
+        {
+            return BINDLESS_INVALID_INDEX;
+        }
+
+        return it->second;
+    }
+
+    BindlessTextures& Renderer::get_bindless_textures() { return *impl->bindless_textures; }
+
     void Renderer::on_event(const Event& e) { dispatch_event<WindowResizeEvent>(e, BIND_FN(Renderer::on_resize)); }
 
     void Renderer::on_resize(const WindowResizeEvent& e)
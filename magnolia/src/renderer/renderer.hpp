@@ -10,11 +10,16 @@ namespace mag
     class RenderGraph;
     class Line;
     class RendererImage;
+    class BindlessTextures;
+    class Shader;
+    class UniformAllocator;
 
     struct Event;
     struct WindowResizeEvent;
     struct Model;
     struct Image;
+    struct GeometryArenaStatistics;
+    struct DrawIndexedCommand;
 
     class Renderer
     {
@@ -31,22 +36,44 @@ namespace mag
             void draw_indexed(const u32 index_count, const u32 instance_count = 1, const u32 first_index = 0,
                               const i32 vertex_offset = 0, const u32 first_instance = 0);
 
+            // Submits the commands with a single indirect draw. They are drawn one by one when indirect draws are
+            // disabled or not supported by the device. Returns the number of draw calls recorded.
+            u32 draw_indexed_indirect(const DrawIndexedCommand* commands, const u32 count);
+
+            void set_indirect_draws(const b8 enabled);
+            b8 is_indirect_draws_enabled() const;
+
+            // Set by Shader::bind (for the calling thread). The uniforms written to the shader are uploaded and bound
+            // before each draw. Returns the previous shader.
+            Shader* set_active_shader(Shader* shader);
+            UniformAllocator& get_uniform_allocator();
+
             // @TODO: temp?
-            void bind_buffers(Model* model);
+            // Binds the vertex and index buffers shared by every model, draws use the model and mesh offsets
+            void bind_geometry();
             void bind_buffers(Line* line);
             ref<RendererImage> get_renderer_image(Image* image);
             // @TODO: temp?
 
+            // Uploads are only recorded here, the data is sent to the GPU along with the next frame (see UploadQueue)
             void upload_model(Model* model);
             void remove_model(Model* model);
             void update_model(Model* model);
 
+            GeometryArenaStatistics get_geometry_statistics() const;
+
             ref<RendererImage> upload_image(Image* image);
             void remove_image(Image* image);
             void update_image(Image* image);
 
+            // Slot of the image in the bindless texture array. Images that were just uploaded are only valid in the
+            // next frame, returns BINDLESS_INVALID_INDEX until then.
+            u32 get_texture_index(Image* image) const;
+            BindlessTextures& get_bindless_textures();
+
         private:
             void on_resize(const WindowResizeEvent& e);
+            void flush_uniforms();
 
             struct IMPL;
             unique<IMPL> impl;
@@ -7,7 +7,9 @@
 #include "renderer/buffers.hpp"
 #include "renderer/command.hpp"
 #include "renderer/context.hpp"
+#include "renderer/frame.hpp"
 #include "renderer/sampler.hpp"
+#include "renderer/upload_queue.hpp"
 
 namespace mag
 {
@@ -23,7 +25,8 @@ namespace mag
                   image_aspect(image_aspect),
                   extent(extent),
                   type(image_type),
-                  sampler(Filter::Linear, SamplerAddressMode::Repeat, SamplerMipmapMode::Linear, mip_levels),
+                  sampler(create_ref<Sampler>(Filter::Linear, SamplerAddressMode::Repeat, SamplerMipmapMode::Linear,
+                                              mip_levels)),
                   msaa_samples(msaa_samples)
             {
             }
@@ -41,7 +44,7 @@ namespace mag
 
             uvec3 extent;
             ImageType type;
-            Sampler sampler;
+            ref<Sampler> sampler;
             SampleCount msaa_samples;
 
             VmaAllocation allocation;
@@ -66,13 +69,7 @@ namespace mag
         set_pixels(pixels);
     }
 
-    RendererImage::~RendererImage()
-    {
-        auto& context = get_context();
-
-        context.get_device().destroyImageView(impl->image_view);
-        vmaDestroyImage(context.get_allocator(), impl->image, impl->allocation);
-    }
+    RendererImage::~RendererImage() { destroy_image_and_view(); }
 
     void RendererImage::create_image_and_view()
     {
@@ -104,100 +101,146 @@ namespace mag
         VK_CHECK(VK_CAST(vmaCreateImage(context.get_allocator(), &image_create_info, &vma_alloc_info,
                                         reinterpret_cast<VkImage*>(&impl->image), &impl->allocation, 0)));
 
+        // Replicate single channel textures so shaders can sample them the same way as RGBA textures
+        vk::ComponentMapping components = {};
+        const b8 is_texture = impl->type == ImageType::Texture;
+        if (is_texture && (impl->format == vk::Format::eR8Srgb || impl->format == vk::Format::eR8Unorm))
+        {
+            components = vk::ComponentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR,
+                                              vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eOne);
+        }
+
+        else if (is_texture && (impl->format == vk::Format::eR8G8Srgb || impl->format == vk::Format::eR8G8Unorm))
+        {
+            components = vk::ComponentMapping(vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eR,
+                                              vk::ComponentSwizzle::eR, vk::ComponentSwizzle::eG);
+        }
+
         const vk::ImageSubresourceRange range(impl->image_aspect, 0, impl->mip_levels, 0, 1);
-        const vk::ImageViewCreateInfo view_create_info({}, impl->image, vk::ImageViewType::e2D, impl->format, {},
-                                                       range);
+        const vk::ImageViewCreateInfo view_create_info({}, impl->image, vk::ImageViewType::e2D, impl->format,
+                                                       components, range);
 
         impl->image_view = context.get_device().createImageView(view_create_info);
     }
 
-    void RendererImage::set_pixels(const std::vector<u8>& pixels)
+    void RendererImage::destroy_image_and_view()
     {
-        auto& context = get_context();
+        // Frames in flight and pending uploads may still be using the image (the sampler is released with the lambda)
+        const vk::Image image = impl->image;
+        const vk::ImageView image_view = impl->image_view;
+        const VmaAllocation allocation = impl->allocation;
+        const ref<Sampler> sampler = impl->sampler;
+
+        get_context().defer_deletion(
+            [image, image_view, allocation, sampler]
+            {
+                auto& context = get_context();
 
-        const u64 texture_size = pixels.size();
+                context.get_device().destroyImageView(image_view);
+                vmaDestroyImage(context.get_allocator(), image, allocation);
+            });
+    }
 
-        VulkanBuffer staging_buffer;
-        staging_buffer.initialize(texture_size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_AUTO,
-                                  VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-        staging_buffer.copy(pixels.data(), texture_size);
+    void RendererImage::recreate(const uvec3& extent, const u32 mip_levels)
+    {
+        destroy_image_and_view();
 
-        context.submit_commands_immediate(
-            [&](CommandBuffer& cmd)
-            {
-                cmd.copy_buffer_to_image(staging_buffer, *this);
-
-                cmd.transfer_layout(*this, vk::ImageLayout::eShaderReadOnlyOptimal,
-                                    vk::ImageLayout::eTransferDstOptimal);
-
-                vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, {}, 1, 0, 1);
-                vk::ImageMemoryBarrier barrier({}, {}, {}, {}, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored,
-                                               impl->image, range);
-
-                i32 mip_width = impl->extent.x;
-                i32 mip_height = impl->extent.y;
-
-                // @TODO: use KTX to generate mip maps: https://www.khronos.org/ktx/
-                for (u32 i = 1; i < impl->mip_levels; i++)
-                {
-                    barrier.subresourceRange.baseMipLevel = i - 1;
-                    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-                    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-                    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-                    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-                    cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                                     vk::PipelineStageFlagBits::eTransfer,
-                                                     vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
-
-                    vk::ImageSubresourceLayers src_subresource(vk::ImageAspectFlagBits::eColor, i - 1, 0, 1);
-                    vk::ImageSubresourceLayers dst_subresource(vk::ImageAspectFlagBits::eColor, i, 0, 1);
-
-                    std::array<vk::Offset3D, 2> src_offsets = {};
-                    src_offsets.at(1).setX(mip_width).setY(mip_height).setZ(1);
-
-                    std::array<vk::Offset3D, 2> dst_offsets = {};
-                    dst_offsets.at(1)
-                        .setX(mip_width > 1 ? mip_width / 2 : 1)
-                        .setY(mip_height > 1 ? mip_height / 2 : 1)
-                        .setZ(1);
-
-                    vk::ImageBlit blit(src_subresource, src_offsets, dst_subresource, dst_offsets);
-                    cmd.get_handle().blitImage(impl->image, vk::ImageLayout::eTransferSrcOptimal, impl->image,
-                                               vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
-
-                    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-                    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-                    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-                    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-                    cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                                     vk::PipelineStageFlagBits::eFragmentShader,
-                                                     vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
-
-                    if (mip_width > 1) mip_width /= 2;
-                    if (mip_height > 1) mip_height /= 2;
-                }
-
-                barrier.subresourceRange.baseMipLevel = impl->mip_levels - 1;
-                barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-                barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-                barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-                barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-                cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                                 vk::PipelineStageFlagBits::eFragmentShader,
-                                                 vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
-            });
+        impl->extent = extent;
+        impl->mip_levels = mip_levels;
+        impl->sampler = create_ref<Sampler>(Filter::Linear, SamplerAddressMode::Repeat, SamplerMipmapMode::Linear,
+                                            mip_levels);
+
+        create_image_and_view();
+    }
+
+    void RendererImage::set_pixels(const std::vector<u8>& pixels, const std::vector<u64>& mip_offsets)
+    {
+        auto& upload_queue = get_context().get_upload_queue();
+
+        // The copy is recorded in the current upload batch, frames submitted after it wait for the upload
+        const StagingAllocation staging = upload_queue.stage(pixels.data(), pixels.size());
+        auto& cmd = upload_queue.get_command_buffer();
+
+        // Mips are precomputed, just copy them
+        if (!mip_offsets.empty())
+        {
+            std::vector<u64> staging_offsets = mip_offsets;
+            for (auto& offset : staging_offsets) offset += staging.offset;
+
+            cmd.copy_buffer_to_image(*staging.buffer, *this, staging_offsets);
+            return;
+        }
+
+        // Copy only the base level
+        cmd.copy_buffer_to_image(*staging.buffer, *this, {staging.offset});
+
+        cmd.transfer_layout(*this, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal);
+
+        vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, {}, 1, 0, 1);
+        vk::ImageMemoryBarrier barrier({}, {}, {}, {}, vk::QueueFamilyIgnored, vk::QueueFamilyIgnored, impl->image,
+                                       range);
+
+        i32 mip_width = impl->extent.x;
+        i32 mip_height = impl->extent.y;
+
+        // Generate the mips (cooked textures already contain them, see TextureImporter, and so do source images when
+        // their mips are generated on the CPU, see mip::generate)
+        for (u32 i = 1; i < impl->mip_levels; i++)
+        {
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+            barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+            cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                                             vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
+
+            vk::ImageSubresourceLayers src_subresource(vk::ImageAspectFlagBits::eColor, i - 1, 0, 1);
+            vk::ImageSubresourceLayers dst_subresource(vk::ImageAspectFlagBits::eColor, i, 0, 1);
+
+            std::array<vk::Offset3D, 2> src_offsets = {};
+            src_offsets.at(1).setX(mip_width).setY(mip_height).setZ(1);
+
+            std::array<vk::Offset3D, 2> dst_offsets = {};
+            dst_offsets.at(1)
+                .setX(mip_width > 1 ? mip_width / 2 : 1)
+                .setY(mip_height > 1 ? mip_height / 2 : 1)
+                .setZ(1);
+
+            vk::ImageBlit blit(src_subresource, src_offsets, dst_subresource, dst_offsets);
+            cmd.get_handle().blitImage(impl->image, vk::ImageLayout::eTransferSrcOptimal, impl->image,
+                                       vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+            barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+            cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                             vk::PipelineStageFlagBits::eFragmentShader,
+                                             vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
+
+            if (mip_width > 1) mip_width /= 2;
+            if (mip_height > 1) mip_height /= 2;
+        }
+
+        barrier.subresourceRange.baseMipLevel = impl->mip_levels - 1;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
 
-        staging_buffer.shutdown();
+        cmd.get_handle().pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                         vk::PipelineStageFlagBits::eFragmentShader,
+                                         vk::DependencyFlagBits::eByRegion, {}, {}, barrier);
     }
 
     const vk::Image& RendererImage::get_image() const { return impl->image; }
     const vk::ImageView& RendererImage::get_image_view() const { return impl->image_view; }
     const vk::Format& RendererImage::get_format() const { return impl->format; }
     const uvec3& RendererImage::get_extent() const { return impl->extent; }
-    const Sampler& RendererImage::get_sampler() const { return impl->sampler; }
+    const Sampler& RendererImage::get_sampler() const { return *impl->sampler; }
     const str& RendererImage::get_name() const { return impl->name; }
     u32 RendererImage::get_mip_levels() const { return impl->mip_levels; }
 };  // namespace mag
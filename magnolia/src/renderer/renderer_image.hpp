@@ -43,12 +43,16 @@ namespace mag
 
             ~RendererImage();
 
-            // The dimensions, mip levels, channels, etc are not changed, only the image pixels
-            void set_pixels(const std::vector<u8>& pixels);
+            // The dimensions, mip levels, channels, etc are not changed, only the image pixels. If the mip offsets are
+            // provided the pixels contain the whole mip chain and no mips are generated. The pixels are copied to the
+            // upload queue and sent to the GPU with the next frame. The upload does not wait for the frames in flight,
+            // so images that may be in use must be recreated first.
+            void set_pixels(const std::vector<u8>& pixels, const std::vector<u64>& mip_offsets = {});
 
-            // @TODO: ugly fix
-            // Indicates if the corresponding descriptor sets should be updated.
-            b8 dirty = true;
+            // Recreates the image with new dimensions/mip levels (i.e. when mips are streamed in or out). The previous
+            // image is destroyed once the frames in flight are done with it. Contents are undefined until the pixels
+            // are set again and descriptors that use the image must be updated (see Renderer::update_image).
+            void recreate(const uvec3& extent, const u32 mip_levels);
 
             const vk::Image& get_image() const;
             const vk::ImageView& get_image_view() const;
@@ -60,6 +64,7 @@ namespace mag
 
         private:
             void create_image_and_view();
+            void destroy_image_and_view();
 
             struct IMPL;
             unique<IMPL> impl;
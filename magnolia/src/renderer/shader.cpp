@@ -1,11 +1,17 @@
 #include "renderer/shader.hpp"
 
+#include <cstring>
+#include <set>
+#include <sstream>
 #include <vulkan/vulkan.hpp>
 
 #include "core/application.hpp"
 #include "core/assert.hpp"
+#include "core/buffer.hpp"
 #include "core/logger.hpp"
 #include "math/generic.hpp"
+#include "platform/file_system.hpp"
+#include "renderer/bindless_textures.hpp"
 #include "renderer/buffers.hpp"
 #include "renderer/context.hpp"
 #include "renderer/descriptors.hpp"
@@ -13,6 +19,7 @@
 #include "renderer/pipeline.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/renderer_image.hpp"
+#include "resources/asset_graph.hpp"
 #include "resources/image.hpp"
 #include "resources/material.hpp"
 #include "resources/resource_loader.hpp"
@@ -36,22 +43,103 @@ namespace mag
         }
 
         shaders[file_path] = create_ref<Shader>(shader_configuration);
+        add_dependencies(shader_configuration);
+
         return shaders[file_path];
     }
 
+    void ShaderManager::reload(const str& file_path)
+    {
+        auto it = shaders.find(file_path);
+        if (it == shaders.end())
+        {
+            return;
+        }
+
+        ShaderConfiguration shader_configuration;
+
+        if (!resource::load(file_path, &shader_configuration))
+        {
+            LOG_ERROR("Failed to load shader: '{0}'", file_path);
+            return;
+        }
+
+        it->second->rebuild(shader_configuration);
+
+        // The includes may have changed
+        add_dependencies(shader_configuration);
+    }
+
     void ShaderManager::recompile_all_shaders()
     {
-        for (const auto& [file_path, shader] : shaders)
+        for (const auto& shader_p : shaders)
         {
-            ShaderConfiguration shader_configuration;
+            reload(shader_p.first);
+        }
+    }
 
-            if (!resource::load(file_path, &shader_configuration))
+    // Adds the files included by a GLSL file (and the ones they include) as its dependencies
+    static void add_include_dependencies(AssetGraph& asset_graph, const AssetNode& node,
+                                         const std::filesystem::path& include_directory, std::set<str>& visited)
+    {
+        if (!visited.insert(node.path).second)
+        {
+            return;
+        }
+
+        // Missing includes are reported by the compiler
+        Buffer buffer;
+        if (!fs::exists(node.path) || !fs::read_binary_data(node.path, buffer))
+        {
+            return;
+        }
+
+        std::istringstream file(str(buffer.cast<c8>(), buffer.get_size()));
+
+        str line;
+        while (std::getline(file, line))
+        {
+            const u64 name_begin = line.find('"') + 1;
+            const u64 name_end = line.find('"', name_begin);
+            if (!line.starts_with("#include") || name_begin == 0 || name_end == str::npos)
             {
-                LOG_ERROR("Failed to load shader: '{0}'", file_path);
                 continue;
             }
 
-            shaders[file_path]->rebuild(shader_configuration);
+            const str include_name = line.substr(name_begin, name_end - name_begin);
+
+            // Same lookup as the compiler: next to the file first, then the include directory
+            auto include_path = fs::get_fixed_path(node.path).parent_path() / include_name;
+            if (!fs::exists(include_path))
+            {
+                include_path = include_directory / include_name;
+            }
+
+            const AssetNode include_node = {AssetType::ShaderInclude, include_path.lexically_normal().string()};
+
+            asset_graph.add_dependency(include_node, node);
+            add_include_dependencies(asset_graph, include_node, include_directory, visited);
+        }
+    }
+
+    void ShaderManager::add_dependencies(const ShaderConfiguration& shader_configuration)
+    {
+        auto& asset_graph = get_application().get_asset_graph();
+
+        // The GLSL sources are next to the shader file and compiled to the modules in the build folder
+        const auto source_directory = fs::get_fixed_path(shader_configuration.file_path).parent_path();
+        const AssetNode shader_node = {AssetType::Shader, shader_configuration.file_path};
+
+        std::set<str> visited;
+        for (const auto& module : shader_configuration.shader_modules)
+        {
+            const auto module_path = fs::get_fixed_path(module.file_path);
+            const AssetNode module_node = {AssetType::ShaderModule, module_path.string()};
+            const AssetNode source_node = {AssetType::ShaderSource, (source_directory / module_path.stem()).string()};
+
+            asset_graph.add_dependency(module_node, shader_node);
+            asset_graph.add_dependency(source_node, module_node);
+            add_include_dependencies(asset_graph, source_node, source_directory, visited);
         }
     }
 
@@ -146,6 +234,17 @@ namespace mag
                 // Already initialized
                 if (uniforms_map.contains(descriptor_binding.name)) continue;
 
+                // Runtime arrays of textures use the bindless texture array of the renderer
+                if (descriptor_binding.descriptor_type == SPV_REFLECT_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER &&
+                    descriptor_binding.count == 0)
+                {
+                    const auto& bindless_textures = get_application().get_renderer().get_bindless_textures();
+
+                    descriptor_set_layouts[descriptor_binding.set] = bindless_textures.get_descriptor_set_layout();
+                    bindless_set = descriptor_binding.set;
+                    continue;
+                }
+
                 const str scope = descriptor_binding.name;
                 const u32 size = descriptor_binding.block.size;
                 const vk::DescriptorType type = static_cast<vk::DescriptorType>(descriptor_binding.descriptor_type);
@@ -161,47 +260,43 @@ namespace mag
                     uniforms_map[scope].members_cache[member->name] = member;
                 }
 
-                // Create buffer for ubos
+                // Ubos point to the uniform allocator of each frame, the block is bound with a dynamic offset
                 if (type == vk::DescriptorType::eUniformBuffer)
                 {
-                    uniforms_map[scope].buffers.resize(frame_count);
+                    auto& uniform_allocator = get_application().get_renderer().get_uniform_allocator();
+
+                    uniforms_map[scope].data.resize(size);
+                    uniforms_map[scope].upload_size = size;
 
                     for (u32 f = 0; f < frame_count; f++)
                     {
-                        uniforms_map[scope].buffers[f].initialize(
-                            size, vk::BufferUsageFlagBits::eUniformBuffer, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-                            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
                         auto& descriptor_set = uniforms_map[scope].descriptor_sets[f];
                         auto& descriptor_set_layout = uniforms_map[scope].descriptor_set_layouts[f];
-                        auto& buffer = uniforms_map[scope].buffers[f];
 
                         DescriptorBuilder::create_descriptor_for_buffer(
                             descriptor_binding.binding, descriptor_set, descriptor_set_layout,
-                            vk::DescriptorType::eUniformBuffer, buffer, size, 0);
+                            vk::DescriptorType::eUniformBufferDynamic, uniform_allocator.get_buffer(f), size, 0);
                     }
                 }
 
-                // Create buffer for ssbos
+                // Same for ssbos. The range of dynamic descriptors is fixed when they are written, so it is the size of
+                // the host copy and the allocations leave room for it (see UniformAllocator::allocate).
                 // @TODO: hardcoded size
                 else if (type == vk::DescriptorType::eStorageBuffer)
                 {
-                    uniforms_map[scope].buffers.resize(frame_count);
+                    auto& uniform_allocator = get_application().get_renderer().get_uniform_allocator();
+
+                    const u64 BUFFER_SIZE = sizeof(mat4) * MAX_STORAGE_BUFFER_ELEMENTS;
+                    uniforms_map[scope].data.resize(BUFFER_SIZE);
 
-                    const u64 BUFFER_SIZE = sizeof(mat4) * 10'000;
                     for (u32 f = 0; f < frame_count; f++)
                     {
-                        uniforms_map[scope].buffers[f].initialize(
-                            BUFFER_SIZE, vk::BufferUsageFlagBits::eStorageBuffer, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
-                            VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-
                         auto& descriptor_set = uniforms_map[scope].descriptor_sets[f];
                         auto& descriptor_set_layout = uniforms_map[scope].descriptor_set_layouts[f];
-                        auto& buffer = uniforms_map[scope].buffers[f];
 
                         DescriptorBuilder::create_descriptor_for_buffer(
                             descriptor_binding.binding, descriptor_set, descriptor_set_layout,
-                            vk::DescriptorType::eStorageBuffer, buffer, BUFFER_SIZE, 0);
+                            vk::DescriptorType::eStorageBufferDynamic, uniform_allocator.get_buffer(f), BUFFER_SIZE, 0);
                     }
                 }
 
@@ -240,6 +335,12 @@ namespace mag
             }
         }
 
+        // The members may have moved
+        for (auto& entry : handles)
+        {
+            resolve_handle(entry);
+        }
+
         pipeline = create_unique<Pipeline>(*this);
     }
 
@@ -248,13 +349,17 @@ namespace mag
         auto& context = get_context();
         context.get_device().waitIdle();
 
+        // The pipeline may still be compiling the shader modules
+        pipeline.reset();
+
+        // Frames in flight may still be using the descriptor sets
+        std::vector<vk::DescriptorSet> descriptor_sets;
+
         for (auto& uniform_p : uniforms_map)
         {
             auto& ubo = uniform_p.second;
-            for (auto& buffer : ubo.buffers)
-            {
-                buffer.shutdown();
-            }
+
+            descriptor_sets.insert(descriptor_sets.end(), ubo.descriptor_sets.begin(), ubo.descriptor_sets.end());
 
             delete ubo.descriptor_binding;
             delete ubo.push_constant_block;
@@ -263,6 +368,17 @@ namespace mag
             ubo.push_constant_block = nullptr;
         }
 
+        context.defer_deletion(
+            [descriptor_sets]
+            {
+                auto& descriptor_allocator = get_context().get_descriptor_allocator();
+
+                for (const auto& descriptor_set : descriptor_sets)
+                {
+                    if (descriptor_set) descriptor_allocator.free(descriptor_set);
+                }
+            });
+
         for (auto& shader_module : configuration.shader_modules)
         {
             context.get_device().destroyShaderModule(*shader_module.module);
@@ -281,17 +397,39 @@ namespace mag
         descriptor_set_layouts.clear();
         push_constant_ranges.clear();
         uniforms_map.clear();
-        texture_descriptor_sets.clear();
 
-        pipeline.reset();
+        // Handles are kept, they are resolved again when the shader is built
+        for (auto& entry : handles)
+        {
+            entry.ubo = nullptr;
+        }
 
         location = 0;
         stride = 0;
+        bindless_set = Max_U32;
     }
 
     Shader::~Shader() { destroy(); }
 
-    void Shader::bind() { pipeline->bind(); }
+    void Shader::bind()
+    {
+        pipeline->bind();
+
+        // Blocks are bound again with the next draw
+        for (auto& uniform_p : uniforms_map)
+        {
+            uniform_p.second.bound = false;
+        }
+
+        get_application().get_renderer().set_active_shader(this);
+
+        // The texture array is shared by every draw, so it is bound only once
+        if (bindless_set != Max_U32)
+        {
+            const auto& bindless_textures = get_application().get_renderer().get_bindless_textures();
+            bind_descriptor(bindless_set, bindless_textures.get_descriptor_set());
+        }
+    }
 
     void Shader::rebuild(const ShaderConfiguration& shader_configuration)
     {
@@ -322,38 +460,13 @@ namespace mag
             return;
         }
 
-        auto& context = get_context();
-        const u32 curr_frame_number = context.get_curr_frame_number();
-        const auto& cmd = context.get_curr_frame().command_buffer;
-
         auto& ubo = uniform_it->second;
         auto& members_cache = ubo.members_cache;
 
         auto it = members_cache.find(name);
         if (it != members_cache.end())
         {
-            const u64 offset = it->second->offset;
-            const u64 size = it->second->size;
-
-            // Check if uniform is a push constant or ubo
-            if (ubo.push_constant_block != nullptr)
-            {
-                vk::PipelineLayout pipeline_layout =
-                    *reinterpret_cast<const vk::PipelineLayout*>(pipeline->get_layout());
-
-                // @TODO: hardcoded shader stage
-                cmd.get_handle().pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eFragment,
-                                               offset + data_offset, size, data);
-            }
-
-            else
-            {
-                auto& buffer = ubo.buffers[curr_frame_number];
-                buffer.copy(data, size, offset + data_offset);
-
-                bind_descriptor(ubo.descriptor_binding->set, ubo.descriptor_sets[curr_frame_number]);
-            }
-
+            write_uniform(ubo, it->second->offset + data_offset, it->second->size, data);
             return;
         }
 
@@ -361,137 +474,220 @@ namespace mag
         LOG_ERROR("Uniform '{0}' not found in scope '{1}'", name, scope);
     }
 
-    void Shader::set_texture(const str& name, Image* texture)
+    UniformHandle Shader::get_handle(const str& scope, const str& name)
     {
-        auto it = uniforms_map.find(name);
-        if (it == uniforms_map.end())
+        for (u32 i = 0; i < handles.size(); i++)
         {
-            // Uniform not found
-            LOG_ERROR("Uniform texture '{0}' not found", name);
-            return;
+            if (handles[i].scope == scope && handles[i].name == name)
+            {
+                return {i};
+            }
         }
 
-        auto& app = get_application();
-        auto& renderer = app.get_renderer();
-        auto& context = get_context();
-
-        const u32 curr_frame_number = context.get_curr_frame_number();
-
-        auto& ubo = it->second;
+        HandleEntry entry = {.scope = scope, .name = name};
+        resolve_handle(entry);
 
-        // Create descriptor for this texture
-        if (texture_descriptor_sets.count(texture) == 0)
+        if (entry.ubo == nullptr)
         {
-            vk::DescriptorSet descriptor_set;
-            vk::DescriptorSetLayout descriptor_set_layout;
-
-            auto renderer_texture = renderer.get_renderer_image(texture);
-
-            DescriptorBuilder::create_descriptor_for_textures(ubo.descriptor_binding->binding, {renderer_texture},
-                                                              descriptor_set, descriptor_set_layout);
-
-            texture_descriptor_sets[texture] = descriptor_set;
+            return {};
         }
 
-        ubo.descriptor_sets[curr_frame_number] = texture_descriptor_sets[texture];
+        handles.push_back(entry);
 
-        bind_descriptor(ubo.descriptor_binding->set, ubo.descriptor_sets[curr_frame_number]);
+        return {static_cast<u32>(handles.size() - 1)};
     }
 
-    void Shader::set_texture(const str& name, RendererImage* texture)
+    void Shader::set_uniform_data(const UniformHandle handle, const void* data, const u64 size, const u64 data_offset)
     {
-        auto it = uniforms_map.find(name);
-        if (it == uniforms_map.end())
+        // Invalid handles were already reported
+        if (!handle.is_valid() || handles[handle.index].ubo == nullptr)
         {
-            // Uniform not found
-            LOG_ERROR("Uniform texture '{0}' not found", name);
             return;
         }
 
-        auto& context = get_context();
+        const auto& entry = handles[handle.index];
+        write_uniform(*entry.ubo, entry.offset + data_offset, size, data);
+    }
 
-        const u32 curr_frame_number = context.get_curr_frame_number();
+    void Shader::resolve_handle(HandleEntry& entry)
+    {
+        entry.ubo = nullptr;
 
-        auto& ubo = it->second;
+        auto uniform_it = uniforms_map.find(entry.scope);
+        if (uniform_it == uniforms_map.end())
+        {
+            LOG_ERROR("Uniform scope '{0}' not found", entry.scope);
+            return;
+        }
+
+        auto& members_cache = uniform_it->second.members_cache;
 
-        // Create descriptor for this texture
-        if (texture_descriptor_sets.count(static_cast<void*>(texture)) == 0 || texture->dirty)
+        auto it = members_cache.find(entry.name);
+        if (it == members_cache.end())
         {
-            vk::DescriptorSet descriptor_set;
-            vk::DescriptorSetLayout descriptor_set_layout;
+            LOG_ERROR("Uniform '{0}' not found in scope '{1}'", entry.name, entry.scope);
+            return;
+        }
 
-            DescriptorBuilder::create_descriptor_for_textures(ubo.descriptor_binding->binding, {texture},
-                                                              descriptor_set, descriptor_set_layout);
+        entry.ubo = &uniform_it->second;
+        entry.offset = it->second->offset;
+        entry.size = it->second->size;
+    }
 
-            texture_descriptor_sets[static_cast<void*>(texture)] = descriptor_set;
-            texture->dirty = false;
+    b8 Shader::check_uniform_size(const UniformHandle handle, const u64 size) const
+    {
+        if (!handle.is_valid() || handles[handle.index].ubo == nullptr)
+        {
+            return false;
         }
 
-        ubo.descriptor_sets[curr_frame_number] = texture_descriptor_sets[static_cast<void*>(texture)];
+        const auto& entry = handles[handle.index];
+        if (size > entry.size)
+        {
+            LOG_ERROR("Uniform '{0}' in scope '{1}' has {2} bytes, tried to write {3}", entry.name, entry.scope,
+                      entry.size, size);
+            return false;
+        }
 
-        bind_descriptor(ubo.descriptor_binding->set, ubo.descriptor_sets[curr_frame_number]);
+        return true;
     }
 
-    void Shader::set_material(const str& name, Material* material)
+    void Shader::write_uniform(UBO& ubo, const u64 offset, const u64 size, const void* data)
     {
-        auto it = uniforms_map.find(name);
-        if (it == uniforms_map.end())
+        const auto& cmd = get_context().get_command_buffer();
+
+        // Refuse writes past the end of the block, the member size is only checked by the typed setters
+        const u64 block_size = ubo.push_constant_block != nullptr
+                                   ? ubo.push_constant_block->offset + ubo.push_constant_block->size
+                                   : ubo.data.size();
+
+        if (offset + size > block_size)
         {
-            // Uniform not found
-            LOG_ERROR("Uniform material '{0}' not found", name);
+            LOG_ERROR("Uniform write of {0} bytes at offset {1} exceeds the block size ({2} bytes)", size, offset,
+                      block_size);
             return;
         }
 
-        auto& app = get_application();
-        auto& renderer = app.get_renderer();
-        auto& texture_manager = app.get_texture_manager();
+        // Check if uniform is a push constant or ubo
+        if (ubo.push_constant_block != nullptr)
+        {
+            vk::PipelineLayout pipeline_layout = *reinterpret_cast<const vk::PipelineLayout*>(pipeline->get_layout());
+
+            // @TODO: hardcoded shader stage
+            cmd.get_handle().pushConstants(pipeline_layout, vk::ShaderStageFlagBits::eFragment, offset, size, data);
+        }
+
+        // Only the host copy is written, it is uploaded before the next draw (see flush_uniforms)
+        else
+        {
+            memcpy(ubo.data.data() + offset, data, size);
+
+            ubo.upload_size = max(ubo.upload_size, offset + size);
+            ubo.dirty = true;
+        }
+    }
+
+    void Shader::flush_uniforms()
+    {
         auto& context = get_context();
+        auto& uniform_allocator = get_application().get_renderer().get_uniform_allocator();
 
         const u32 curr_frame_number = context.get_curr_frame_number();
+        const u64 frame_index = uniform_allocator.get_frame_index();
 
-        auto& ubo = it->second;
-
-        // @TODO: this blocks the main thread and should be paralelized when the renderer supports it.
-        // Create/Update descriptor for this material
-        if (texture_descriptor_sets.count(material) == 0 ||
-            material->loading_state == MaterialLoadingState::LoadingFinished)
+        for (auto& uniform_p : uniforms_map)
         {
-            vk::DescriptorSet descriptor_set;
-            vk::DescriptorSetLayout descriptor_set_layout;
+            auto& ubo = uniform_p.second;
+
+            // Push constants and textures
+            if (ubo.data.empty())
+            {
+                continue;
+            }
 
-            std::vector<ref<RendererImage>> renderer_textures;
-            for (const auto& texture_p : material->textures)
+            // Uploads of previous frames were rewound
+            if (ubo.dirty || ubo.upload_frame != frame_index)
             {
-                const auto& texture_name = texture_p.second;
-                const auto& texture = texture_manager.get(texture_name);
-                const auto& renderer_texture = renderer.get_renderer_image(texture.get());
+                u64 offset = 0;
+                void* memory = uniform_allocator.allocate(ubo.upload_size, offset, ubo.data.size());
+                if (memory == nullptr)
+                {
+                    LOG_ERROR("Uniform allocator is full ({0} bytes), '{1}' was not uploaded",
+                              uniform_allocator.get_size(), uniform_p.first);
+                    continue;
+                }
+
+                memcpy(memory, ubo.data.data(), ubo.upload_size);
 
-                renderer_textures.push_back(renderer_texture);
+                ubo.dynamic_offset = static_cast<u32>(offset);
+                ubo.upload_frame = frame_index;
+                ubo.dirty = false;
+                ubo.bound = false;
             }
 
-            DescriptorBuilder::create_descriptor_for_textures(ubo.descriptor_binding->binding, renderer_textures,
-                                                              descriptor_set, descriptor_set_layout);
+            if (!ubo.bound)
+            {
+                bind_descriptor(ubo.descriptor_binding->set, ubo.descriptor_sets[curr_frame_number],
+                                ubo.dynamic_offset);
+                ubo.bound = true;
+            }
+        }
+    }
 
-            texture_descriptor_sets[material] = descriptor_set;
+    void Shader::set_texture(const str& name, Image* texture)
+    {
+        auto& app = get_application();
+        auto& texture_manager = app.get_texture_manager();
+
+        set_texture(name, app.get_renderer().get_renderer_image(texture).get());
 
-            material->loading_state = MaterialLoadingState::UploadedToGPU;
+        texture_manager.mark_as_used(texture);
+    }
+
+    void Shader::set_texture(const str& name, RendererImage* texture)
+    {
+        auto it = uniforms_map.find(name);
+        if (it == uniforms_map.end())
+        {
+            // Uniform not found
+            LOG_ERROR("Uniform texture '{0}' not found", name);
+            return;
         }
 
-        ubo.descriptor_sets[curr_frame_number] = texture_descriptor_sets[material];
+        auto& ubo = it->second;
+
+        // The set only lives for this frame, so it always points to the current image view (images are recreated when
+        // they are streamed or resized)
+        vk::DescriptorSet descriptor_set;
+        vk::DescriptorSetLayout descriptor_set_layout;
 
-        bind_descriptor(ubo.descriptor_binding->set, ubo.descriptor_sets[curr_frame_number]);
+        DescriptorBuilder::create_descriptor_for_textures(ubo.descriptor_binding->binding, {texture}, descriptor_set,
+                                                          descriptor_set_layout,
+                                                          &get_context().get_frame_descriptor_allocator());
+
+        bind_descriptor(ubo.descriptor_binding->set, descriptor_set);
     }
 
     void Shader::bind_descriptor(const u32 set, const vk::DescriptorSet& descriptor_set)
     {
         auto& context = get_context();
-        auto& command_buffer = context.get_curr_frame().command_buffer;
+        auto& command_buffer = context.get_command_buffer();
 
         command_buffer.bind_descriptor_set(vk::PipelineBindPoint::eGraphics,
                                            *static_cast<const vk::PipelineLayout*>(pipeline->get_layout()), set,
                                            descriptor_set);
     }
 
+    void Shader::bind_descriptor(const u32 set, const vk::DescriptorSet& descriptor_set, const u32 dynamic_offset)
+    {
+        auto& context = get_context();
+        auto& command_buffer = context.get_command_buffer();
+
+        command_buffer.bind_descriptor_set(vk::PipelineBindPoint::eGraphics,
+                                           *static_cast<const vk::PipelineLayout*>(pipeline->get_layout()), set,
+                                           descriptor_set, dynamic_offset);
+    }
+
     const ShaderConfiguration& Shader::get_shader_configuration() const { return configuration; }
 
     const std::vector<vk::VertexInputBindingDescription>& Shader::get_vertex_bindings() const
@@ -8,12 +8,13 @@
 
 namespace mag
 {
+// Elements of the storage buffers, one mat4 each (i.e. the transforms of the instances)
+#define MAX_STORAGE_BUFFER_ELEMENTS 10'000
+
     class Pipeline;
-    class VulkanBuffer;
     class RendererImage;
 
     struct Image;
-    struct Material;
 
     struct ShaderModule
     {
@@ -46,6 +47,15 @@ namespace mag
             b8 depth_write_enabled;
     };
 
+    // Uniform member resolved once from the reflection data (see Shader::get_handle). Handles index the handle table of
+    // the shader, so they stay valid when the shader is rebuilt.
+    struct UniformHandle
+    {
+            u32 index = Max_U32;
+
+            b8 is_valid() const { return index != Max_U32; }
+    };
+
     class Shader
     {
         public:
@@ -56,16 +66,48 @@ namespace mag
             void rebuild(const ShaderConfiguration& shader_configuration);
             void destroy();
 
+            // Also makes the shader the active one, its uniforms are flushed before each draw (see Renderer)
             void bind();
 
+            // Uploads the uniform blocks written since the last upload to the uniform allocator of the frame and binds
+            // them with their offsets. Blocks already bound are skipped.
+            void flush_uniforms();
+
             void set_uniform(const str& scope, const str& name, const void* data, const u64 data_offset = 0);
 
-            // @TODO: there is a huge issue with this system. Because we map descriptors to a resource pointer, a
-            // resource might be recreated (i.e. deleted and then instanciated) but the mapped descriptor wont be
-            // deleted and the new one wont be mapped correclty either.
+            // Handles skip the name lookups of the uniform and its member. Returns an invalid handle if the uniform is
+            // not found.
+            UniformHandle get_handle(const str& scope, const str& name);
+
+            // Writes 'size' bytes at the offset of the member (plus 'data_offset'). Writes past the end of the
+            // block are refused.
+            void set_uniform_data(const UniformHandle handle, const void* data, const u64 size,
+                                  const u64 data_offset = 0);
+
+            // The type must not be larger than the member. Runtime array members have the size of one element.
+            template <typename T>
+            void set_uniform(const UniformHandle handle, const T& data, const u64 data_offset = 0)
+            {
+                if (check_uniform_size(handle, sizeof(T)))
+                {
+                    set_uniform_data(handle, &data, sizeof(T), data_offset);
+                }
+            }
+
+            // Writes 'count' elements of an array member starting at 'first' with a single copy
+            template <typename T>
+            void set_uniform_array(const UniformHandle handle, const T* data, const u32 count, const u32 first = 0)
+            {
+                if (count > 0 && check_uniform_size(handle, sizeof(T)))
+                {
+                    set_uniform_data(handle, data, sizeof(T) * count, sizeof(T) * first);
+                }
+            }
+
+            // The descriptor set is allocated from the frame allocator and bound right away. Materials don't need
+            // descriptors, their textures are indexed in the bindless texture array (see BindlessTextures).
             void set_texture(const str& name, Image* texture);
             void set_texture(const str& name, RendererImage* texture);
-            void set_material(const str& name, Material* material);
 
             const ShaderConfiguration& get_shader_configuration() const;
             const std::vector<vk::VertexInputBindingDescription>& get_vertex_bindings() const;
@@ -85,11 +127,34 @@ namespace mag
                     // One per frame in flight
                     std::vector<vk::DescriptorSetLayout> descriptor_set_layouts;
                     std::vector<vk::DescriptorSet> descriptor_sets;
-                    std::vector<VulkanBuffer> buffers;
+
+                    // Host copy of ubos/ssbos. The bytes written so far are copied to the uniform allocator when the
+                    // block changes and a draw uses it.
+                    std::vector<u8> data;
+                    u64 upload_size = 0;
+                    u64 upload_frame = Max_U64;
+                    u32 dynamic_offset = 0;
+                    b8 dirty = true;
+                    b8 bound = false;
+            };
+
+            // Member of a uniform, resolved again when the shader is built
+            struct HandleEntry
+            {
+                    str scope;
+                    str name;
+
+                    UBO* ubo = nullptr;
+                    u64 offset = 0;
+                    u64 size = 0;
             };
 
             void add_attribute(const vk::Format format, const u32 size, const u32 offset);
+            void resolve_handle(HandleEntry& entry);
+            b8 check_uniform_size(const UniformHandle handle, const u64 size) const;
+            void write_uniform(UBO& ubo, const u64 offset, const u64 size, const void* data);
             void bind_descriptor(const u32 set, const vk::DescriptorSet& descriptor_set);
+            void bind_descriptor(const u32 set, const vk::DescriptorSet& descriptor_set, const u32 dynamic_offset);
 
             ShaderConfiguration configuration;
             std::vector<vk::VertexInputBindingDescription> vertex_bindings;
@@ -103,8 +168,10 @@ namespace mag
             u32 stride = 0;
             std::map<str, UBO> uniforms_map;
 
-            // Keep track of the descriptors for each texture/material
-            std::map<void*, vk::DescriptorSet> texture_descriptor_sets;
+            // Set of the bindless texture array, if the shader uses it
+            u32 bindless_set = Max_U32;
+
+            std::vector<HandleEntry> handles;
     };
 
     class ShaderManager
@@ -113,7 +180,13 @@ namespace mag
             ref<Shader> get(const str& file_path);
             void recompile_all_shaders();
 
+            // Loads the shader file and its modules again and rebuilds the pipeline
+            void reload(const str& file_path);
+
         private:
+            // Shader include -> shader source -> shader module -> shader (see AssetGraph)
+            void add_dependencies(const ShaderConfiguration& shader_configuration);
+
             std::map<str, ref<Shader>> shaders;
     };
 };  // namespace mag
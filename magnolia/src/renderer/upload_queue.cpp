@@ -0,0 +1,248 @@
+#include "renderer/upload_queue.hpp"
+
+#include <deque>
+#include <vulkan/vulkan.hpp>
+
+#include "core/assert.hpp"
+#include "core/logger.hpp"
+#include "renderer/buffers.hpp"
+#include "renderer/command.hpp"
+#include "renderer/context.hpp"
+
+namespace mag
+{
+    struct UploadBatch
+    {
+            vk::CommandPool command_pool;
+            CommandBuffer command_buffer;
+
+            u64 timeline_value = 0;  // Signaled when the batch is done
+            u64 staging_end = 0;     // Ring position after the last allocation of the batch
+
+            // Uploads that don't fit in the ring get their own staging buffer
+            std::vector<unique<VulkanBuffer>> dedicated_buffers;
+    };
+
+    struct UploadQueue::IMPL
+    {
+            void begin_batch();
+            void reclaim();
+            u64 allocate(const u64 size_bytes);
+            u64 flush();
+            void wait(const u64 value);
+
+            vk::Semaphore semaphore;
+            VulkanBuffer staging_buffer;
+
+            std::array<UploadBatch, UPLOAD_BATCH_COUNT> batches;
+            std::deque<u32> pending_batches;
+            u32 batch_index = 0;
+            b8 recording = false;
+
+            // Total bytes allocated/released from the ring, the position in the buffer is the value modulo its size
+            u64 head = 0;
+            u64 tail = 0;
+
+            u64 submitted_value = 0;
+    };
+
+    UploadQueue::UploadQueue(const u64 staging_size) : impl(new IMPL())
+    {
+        auto& context = get_context();
+        auto& device = context.get_device();
+
+        vk::SemaphoreTypeCreateInfo semaphore_type_info(vk::SemaphoreType::eTimeline, 0);
+        impl->semaphore = device.createSemaphore(vk::SemaphoreCreateInfo({}, &semaphore_type_info));
+
+        impl->staging_buffer.initialize(staging_size, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_AUTO,
+                                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+
+        for (auto& batch : impl->batches)
+        {
+            const vk::CommandPoolCreateInfo command_pool_info(vk::CommandPoolCreateFlagBits::eTransient,
+                                                              context.get_queue_family_index());
+
+            batch.command_pool = device.createCommandPool(command_pool_info);
+            batch.command_buffer.initialize(batch.command_pool, vk::CommandBufferLevel::ePrimary);
+        }
+    }
+
+    UploadQueue::~UploadQueue()
+    {
+        auto& device = get_context().get_device();
+
+        if (impl->recording)
+        {
+            impl->batches[impl->batch_index].command_buffer.end();
+        }
+
+        impl->wait(impl->submitted_value);
+
+        for (auto& batch : impl->batches)
+        {
+            for (auto& buffer : batch.dedicated_buffers) buffer->shutdown();
+            device.destroyCommandPool(batch.command_pool);
+        }
+
+        impl->staging_buffer.shutdown();
+        device.destroySemaphore(impl->semaphore);
+    }
+
+    StagingAllocation UploadQueue::stage(const void* data, const u64 size_bytes)
+    {
+        if (!impl->recording) impl->begin_batch();
+
+        // Too big for the ring, use a dedicated buffer released with the batch
+        if (size_bytes > impl->staging_buffer.get_size())
+        {
+            auto buffer = create_unique<VulkanBuffer>();
+            buffer->initialize(size_bytes, vk::BufferUsageFlagBits::eTransferSrc, VMA_MEMORY_USAGE_AUTO,
+                               VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+            buffer->copy(data, size_bytes);
+
+            auto& dedicated_buffers = impl->batches[impl->batch_index].dedicated_buffers;
+            dedicated_buffers.push_back(std::move(buffer));
+
+            return {dedicated_buffers.back().get(), 0};
+        }
+
+        // Allocating may submit the current batch and start a new one
+        const u64 offset = impl->allocate(size_bytes);
+        impl->staging_buffer.copy(data, size_bytes, offset);
+
+        return {&impl->staging_buffer, offset};
+    }
+
+    CommandBuffer& UploadQueue::get_command_buffer()
+    {
+        if (!impl->recording) impl->begin_batch();
+
+        return impl->batches[impl->batch_index].command_buffer;
+    }
+
+    u64 UploadQueue::flush() { return impl->flush(); }
+
+    void UploadQueue::wait(const u64 value) { impl->wait(value); }
+
+    const vk::Semaphore& UploadQueue::get_semaphore() const { return impl->semaphore; }
+
+    u64 UploadQueue::get_submitted_value() const { return impl->submitted_value; }
+
+    u64 UploadQueue::get_recorded_value() const
+    {
+        return impl->recording ? impl->submitted_value + 1 : impl->submitted_value;
+    }
+
+    void UploadQueue::IMPL::begin_batch()
+    {
+        auto& device = get_context().get_device();
+        auto& batch = batches[batch_index];
+
+        // Every batch is in flight, wait for the oldest one
+        if (!pending_batches.empty() && pending_batches.front() == batch_index)
+        {
+            wait(batch.timeline_value);
+        }
+
+        reclaim();
+
+        device.resetCommandPool(batch.command_pool);
+        batch.command_buffer.begin();
+
+        recording = true;
+    }
+
+    void UploadQueue::IMPL::reclaim()
+    {
+        const u64 completed_value = get_context().get_device().getSemaphoreCounterValue(semaphore);
+
+        while (!pending_batches.empty())
+        {
+            auto& batch = batches[pending_batches.front()];
+            if (batch.timeline_value > completed_value) break;
+
+            for (auto& buffer : batch.dedicated_buffers) buffer->shutdown();
+            batch.dedicated_buffers.clear();
+
+            tail = batch.staging_end;
+            pending_batches.pop_front();
+        }
+    }
+
+    u64 UploadQueue::IMPL::allocate(const u64 size_bytes)
+    {
+        const u64 capacity = staging_buffer.get_size();
+
+        u64 start = (head + UPLOAD_STAGING_ALIGNMENT - 1) & ~static_cast<u64>(UPLOAD_STAGING_ALIGNMENT - 1);
+
+        // Allocations are contiguous, wrap around if it doesn't fit before the end of the buffer
+        if (start % capacity + size_bytes > capacity)
+        {
+            start = (start / capacity + 1) * capacity;
+        }
+
+        while (start + size_bytes > tail + capacity)
+        {
+            // Nothing is using the ring, skip the padding
+            if (tail == head)
+            {
+                tail = start;
+                break;
+            }
+
+            // Only the batch being recorded is using the ring, submit it so its space can be reclaimed
+            if (pending_batches.empty())
+            {
+                LOG_WARNING("Upload staging buffer is full, submitting uploads early");
+                flush();
+                begin_batch();
+                continue;
+            }
+
+            wait(batches[pending_batches.front()].timeline_value);
+            reclaim();
+        }
+
+        head = start + size_bytes;
+
+        return start % capacity;
+    }
+
+    u64 UploadQueue::IMPL::flush()
+    {
+        if (!recording) return submitted_value;
+
+        auto& context = get_context();
+        auto& batch = batches[batch_index];
+
+        batch.command_buffer.end();
+
+        submitted_value++;
+
+        const vk::TimelineSemaphoreSubmitInfo timeline_submit_info({}, submitted_value);
+
+        vk::SubmitInfo submit;
+        submit.setCommandBuffers(batch.command_buffer.get_handle())
+            .setSignalSemaphores(semaphore)
+            .setPNext(&timeline_submit_info);
+
+        context.get_transfer_queue().submit(submit);
+
+        batch.timeline_value = submitted_value;
+        batch.staging_end = head;
+        pending_batches.push_back(batch_index);
+
+        batch_index = (batch_index + 1) % batches.size();
+        recording = false;
+
+        return submitted_value;
+    }
+
+    void UploadQueue::IMPL::wait(const u64 value)
+    {
+        if (value > submitted_value) flush();
+
+        const vk::SemaphoreWaitInfo wait_info({}, semaphore, value);
+        VK_CHECK(get_context().get_device().waitSemaphores(wait_info, Timeout));
+    }
+};  // namespace mag
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/types.hpp"
+#include "private/vulkan_fwd.hpp"
+
+namespace mag
+{
+#define UPLOAD_STAGING_BUFFER_SIZE (64 * 1024 * 1024)  // 64 MiB ring shared by all uploads
+#define UPLOAD_STAGING_ALIGNMENT 256                   // Satisfies the copy alignment of every texture format
+#define UPLOAD_BATCH_COUNT 4                           // Max batches in flight before recording blocks
+
+    class CommandBuffer;
+    class VulkanBuffer;
+
+    struct StagingAllocation
+    {
+            VulkanBuffer* buffer = nullptr;
+            u64 offset = 0;
+    };
+
+    // Batches GPU uploads into a single submission. The data is copied into a persistent ring staging buffer and
+    // the copy commands are recorded into the current batch, which is submitted once per frame (see
+    // FrameProvider::end_frame). Each batch signals a timeline semaphore that the frame submission waits on, so the
+    // CPU only blocks when the ring runs out of space.
+    class UploadQueue
+    {
+        public:
+            UploadQueue(const u64 staging_size = UPLOAD_STAGING_BUFFER_SIZE);
+            ~UploadQueue();
+
+            // Copies the data to the staging buffer. The allocation belongs to the batch being recorded, so the copy
+            // commands must be recorded right after (see get_command_buffer).
+            StagingAllocation stage(const void* data, const u64 size_bytes);
+
+            // Command buffer of the batch being recorded
+            CommandBuffer& get_command_buffer();
+
+            // Submits the recorded uploads (if any) and returns the timeline value signaled once they are done
+            u64 flush();
+
+            // Blocks until the timeline semaphore reaches the value (the current batch is submitted if needed)
+            void wait(const u64 value);
+
+            const vk::Semaphore& get_semaphore() const;
+            u64 get_submitted_value() const;
+
+            // Timeline value signaled once everything recorded so far is done
+            u64 get_recorded_value() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
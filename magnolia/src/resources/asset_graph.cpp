@@ -0,0 +1,305 @@
+#include "resources/asset_graph.hpp"
+
+#include <algorithm>
+
+#include "core/application.hpp"
+#include "core/logger.hpp"
+#include "platform/file_system.hpp"
+#include "renderer/shader.hpp"
+#include "resources/image.hpp"
+#include "resources/material.hpp"
+#include "resources/model.hpp"
+#include "resources/resource_loader.hpp"
+#include "threads/job_system.hpp"
+#include "tools/model_importer.hpp"
+#include "tools/texture_importer.hpp"
+
+namespace mag
+{
+    // Texture resources are named after their source file, which has its own node
+    static b8 is_file(const AssetType type) { return type != AssetType::Texture; }
+
+    // Format the packed textures of a cooked model were cooked with (i.e. BC1 with --fast). Models without packed
+    // textures get the format of the default cook options.
+    static TextureFormat get_packed_texture_format(const str& model_file_path)
+    {
+        json model_data;
+        if (!fs::exists(model_file_path) || !fs::read_json_data(model_file_path, model_data))
+        {
+            return TextureFormat::BC7;
+        }
+
+        const std::vector<str> materials = model_data.value("Materials", std::vector<str>());
+        for (const auto& material : materials)
+        {
+            json material_data;
+            if (!fs::exists(material) || !fs::read_json_data(material, material_data) ||
+                !material_data.contains("Textures"))
+            {
+                continue;
+            }
+
+            const str packed_texture_path =
+                material_data["Textures"].value("RoughnessMetalness", DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME);
+
+            u32 width = 0, height = 0, channels = 0, mip_levels = 0;
+            TextureFormat format = TextureFormat::BC7;
+            if (packed_texture_path != DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME && fs::exists(packed_texture_path) &&
+                resource::get_image_info(packed_texture_path, &width, &height, &channels, &mip_levels, &format))
+            {
+                return format;
+            }
+        }
+
+        return TextureFormat::BC7;
+    }
+
+    void AssetGraph::add_dependency(const AssetNode& dependency, const AssetNode& dependent)
+    {
+        add_node(dependency);
+        add_node(dependent);
+
+        dependencies[dependent].insert(dependency);
+        dependents[dependency].insert(dependent);
+    }
+
+    void AssetGraph::add_node(const AssetNode& node)
+    {
+        if (!nodes.insert(node).second)
+        {
+            return;
+        }
+
+        // The file watcher skips files that don't exist yet (i.e. outputs that were not cooked, see
+        // FileWatcher::watch_file). Their dependents are still processed when the sources change.
+        if (is_file(node.type))
+        {
+            file_paths.insert(node.path);
+            get_application().get_file_watcher().watch_file(node.path);
+        }
+    }
+
+    void AssetGraph::update()
+    {
+        auto& file_watcher = get_application().get_file_watcher();
+
+        for (const auto& file_path : file_watcher.get_modified_files())
+        {
+            if (file_paths.contains(file_path))
+            {
+                pending_files.insert(file_path);
+                file_watcher.reset_file_status(file_path);
+            }
+        }
+
+        if (processing || pending_files.empty())
+        {
+            return;
+        }
+
+        const std::vector<AssetNode> affected_nodes = get_affected_nodes(pending_files);
+        pending_files.clear();
+
+        if (!affected_nodes.empty())
+        {
+            process(affected_nodes);
+        }
+    }
+
+    std::vector<AssetNode> AssetGraph::get_affected_nodes(const std::set<str>& file_paths) const
+    {
+        std::set<AssetNode> visited;
+        std::vector<AssetNode> affected_nodes;
+
+        for (const auto& node : nodes)
+        {
+            if (is_file(node.type) && file_paths.contains(node.path))
+            {
+                visit(node, visited, affected_nodes);
+            }
+        }
+
+        // Nodes were added after all of their dependents
+        std::reverse(affected_nodes.begin(), affected_nodes.end());
+
+        return affected_nodes;
+    }
+
+    void AssetGraph::visit(const AssetNode& node, std::set<AssetNode>& visited,
+                           std::vector<AssetNode>& sorted_nodes) const
+    {
+        if (!visited.insert(node).second)
+        {
+            return;
+        }
+
+        auto it = dependents.find(node);
+        if (it != dependents.end())
+        {
+            for (const auto& dependent : it->second)
+            {
+                visit(dependent, visited, sorted_nodes);
+            }
+        }
+
+        sorted_nodes.push_back(node);
+    }
+
+    void AssetGraph::process(const std::vector<AssetNode>& affected_nodes)
+    {
+        auto& job_system = get_application().get_job_system();
+
+        // Outputs that need to be cooked again from a changed source. They are gathered here so that the graph is
+        // only accessed by the main thread.
+        const std::set<AssetNode> affected_set(affected_nodes.begin(), affected_nodes.end());
+        std::vector<std::pair<AssetNode, AssetNode>> cook_steps;
+
+        for (const auto& node : affected_nodes)
+        {
+            auto it = dependencies.find(node);
+            if (it == dependencies.end())
+            {
+                continue;
+            }
+
+            for (const auto& dependency : it->second)
+            {
+                const b8 is_source = dependency.type == AssetType::SourceTexture ||
+                                     dependency.type == AssetType::SourceModel ||
+                                     dependency.type == AssetType::ShaderSource;
+
+                if (is_source && affected_set.contains(dependency) && node.type != AssetType::Texture)
+                {
+                    cook_steps.push_back({node, dependency});
+                }
+            }
+        }
+
+        processing = true;
+
+        LOG_INFO("Assets changed, updating {0} assets ({1} to cook)", affected_nodes.size(), cook_steps.size());
+
+        auto execute = [this, cook_steps]
+        {
+            b8 result = true;
+            for (const auto& [node, source] : cook_steps)
+            {
+                result = cook(node, source) && result;
+            }
+
+            return result;
+        };
+
+        auto on_execute_finished = [this, affected_nodes](const b8 result)
+        {
+            if (!result)
+            {
+                LOG_ERROR("Failed to cook some of the changed assets, the previous versions are kept");
+            }
+
+            auto& file_watcher = get_application().get_file_watcher();
+
+            for (const auto& node : affected_nodes)
+            {
+                // The cooked outputs were just written, they don't need to be processed again
+                if (is_file(node.type))
+                {
+                    file_watcher.reset_file_status(node.path);
+                    file_watcher.watch_file(node.path);
+                }
+
+                reload(node);
+            }
+
+            processing = false;
+        };
+
+        Job cook_job = Job(execute, on_execute_finished);
+        job_system.add_job(cook_job);
+    }
+
+    b8 AssetGraph::cook(const AssetNode& node, const AssetNode& source) const
+    {
+        str output_file_path = "";
+
+        switch (node.type)
+        {
+            case AssetType::NativeTexture:
+            {
+                // Keep the format and color space chosen by the cooker (i.e. BC5 for normal maps)
+                u32 width = 0, height = 0, channels = 0, mip_levels = 0;
+                TextureFormat format = TextureFormat::RGBA8;
+                ColorSpace color_space = ColorSpace::Srgb;
+                resource::get_image_info(node.path, &width, &height, &channels, &mip_levels, &format, &color_space);
+
+                TextureImporter importer(&get_application().get_job_system());
+                if (!importer.import(source.path, output_file_path, format, color_space))
+                {
+                    return false;
+                }
+
+                break;
+            }
+
+            case AssetType::Model:
+            {
+                // Keep the packed texture format chosen by the cooker
+                const TextureFormat format = get_packed_texture_format(node.path);
+
+                ModelImporter importer(get_application().get_job_system(), format);
+                if (!importer.import(source.path, output_file_path))
+                {
+                    return false;
+                }
+
+                break;
+            }
+
+            case AssetType::ShaderModule:
+            {
+                const str include_directory = fs::get_fixed_path(source.path).parent_path().string();
+                if (!resource::compile_shader_module(source.path, node.path, include_directory))
+                {
+                    return false;
+                }
+
+                output_file_path = node.path;
+                break;
+            }
+
+            default:
+                return true;
+        }
+
+        LOG_SUCCESS("Cooked '{0}' into '{1}'", source.path, output_file_path);
+        return true;
+    }
+
+    void AssetGraph::reload(const AssetNode& node)
+    {
+        auto& app = get_application();
+
+        switch (node.type)
+        {
+            case AssetType::Texture:
+                app.get_texture_manager().reload(node.path);
+                break;
+
+            case AssetType::Model:
+                app.get_model_manager().reload(node.path);
+                break;
+
+            case AssetType::Material:
+                app.get_material_manager().reload(node.path);
+                break;
+
+            case AssetType::Shader:
+                app.get_shader_manager().reload(node.path);
+                break;
+
+            // Intermediate files, the resources built from them are reloaded instead
+            default:
+                break;
+        }
+    }
+};  // namespace mag
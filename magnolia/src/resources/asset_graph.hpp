@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    enum class AssetType
+    {
+        SourceTexture,  // Image file, cooked into a native texture
+        SourceModel,    // Model file (i.e. glTF), imported into a native model and its materials
+        NativeTexture,
+        Texture,  // Texture resource, named after the source file (see TextureManager)
+        Model,    // Native model file and resource
+        Material,
+        ShaderInclude,
+        ShaderSource,  // GLSL stage, compiled into a shader module
+        ShaderModule,  // SPIR-V file
+        Shader         // Shader file and its pipeline
+    };
+
+    struct AssetNode
+    {
+            AssetType type;
+            str path = "";
+
+            auto operator<=>(const AssetNode& other) const = default;
+    };
+
+    // Tracks what each asset is built from (source asset -> native asset -> material -> texture and shader include ->
+    // shader module -> pipeline). The files of the graph are watched and, when they change, only the assets that
+    // depend on them are cooked and reloaded again. Cooking happens in another thread and the resources are reloaded
+    // in place, so the handles held by the application stay valid.
+    class AssetGraph
+    {
+        public:
+            // 'dependent' is built from (or uses) 'dependency' and must be updated when it changes
+            void add_dependency(const AssetNode& dependency, const AssetNode& dependent);
+
+            // Checks the watched files and updates the assets affected by the changes. Called once per frame.
+            void update();
+
+            // Nodes affected by changes to the files, dependencies come before their dependents
+            std::vector<AssetNode> get_affected_nodes(const std::set<str>& file_paths) const;
+
+        private:
+            void add_node(const AssetNode& node);
+            void visit(const AssetNode& node, std::set<AssetNode>& visited, std::vector<AssetNode>& sorted_nodes) const;
+
+            void process(const std::vector<AssetNode>& affected_nodes);
+
+            // Builds the node again from a source that changed (runs in another thread)
+            b8 cook(const AssetNode& node, const AssetNode& source) const;
+            void reload(const AssetNode& node);
+
+            std::set<AssetNode> nodes;
+            std::map<AssetNode, std::set<AssetNode>> dependencies;
+            std::map<AssetNode, std::set<AssetNode>> dependents;
+
+            // Paths of the file nodes, the others are ignored when files change
+            std::set<str> file_paths;
+
+            // Only one batch of changes is processed at a time, the others wait here
+            std::set<str> pending_files;
+            b8 processing = false;
+    };
+};  // namespace mag
@@ -1,22 +1,42 @@
 #include "resources/image.hpp"
 
+#include <algorithm>
+
 #include "core/application.hpp"
+#include "core/hash.hpp"
 #include "core/logger.hpp"
+#include "platform/file_system.hpp"
 #include "renderer/renderer.hpp"
+#include "resources/asset_graph.hpp"
+#include "resources/mip_generator.hpp"
 #include "resources/resource_loader.hpp"
 #include "threads/job_system.hpp"
+#include "tools/block_compression.hpp"
 
 namespace mag
 {
+// Mips up to this size (in pixels) are loaded first
+#define STREAMING_MIP_TAIL_SIZE 64
+
+#define MAX_PENDING_STREAMING_LOADS 8
+
+    void create_placeholder_pixels(Image& image);
+    str get_texture_file_path(const str& name);
+    b8 load_texture(const str& file_path, Image* image, const b8 generate_mips);
+
     TextureManager::TextureManager()
     {
+        statistics.budget = DEFAULT_TEXTURE_STREAMING_BUDGET;
+
         auto& app = get_application();
         auto& renderer = app.get_renderer();
 
         textures[DEFAULT_ALBEDO_TEXTURE_NAME] = create_ref<Image>();
         textures[DEFAULT_NORMAL_TEXTURE_NAME] = create_ref<Image>();
-        textures[DEFAULT_ROUGHNESS_TEXTURE_NAME] = create_ref<Image>();
-        textures[DEFAULT_METALNESS_TEXTURE_NAME] = create_ref<Image>();
+        textures[DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME] = create_ref<Image>();
+
+        textures[DEFAULT_NORMAL_TEXTURE_NAME]->color_space = ColorSpace::Linear;
+        textures[DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME]->color_space = ColorSpace::Linear;
 
         for (u64 i = 0; i < textures[DEFAULT_ALBEDO_TEXTURE_NAME]->pixels.size(); i += 4)
         {
@@ -27,29 +47,30 @@ namespace mag
             pixels_normal[i + 2] = 255;
             pixels_normal[i + 3] = 255;
 
-            auto& pixels_roughness = textures[DEFAULT_ROUGHNESS_TEXTURE_NAME]->pixels;
-
-            pixels_roughness[i + 0] = 128;
-            pixels_roughness[i + 1] = 128;
-            pixels_roughness[i + 2] = 128;
-            pixels_roughness[i + 3] = 128;
-
-            auto& pixels_metalness = textures[DEFAULT_METALNESS_TEXTURE_NAME]->pixels;
+            // R - ambient occlusion | G - roughness | B - metalness
+            auto& pixels_roughness_metalness = textures[DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME]->pixels;
 
-            pixels_metalness[i + 0] = 0;
-            pixels_metalness[i + 1] = 0;
-            pixels_metalness[i + 2] = 0;
-            pixels_metalness[i + 3] = 0;
+            pixels_roughness_metalness[i + 0] = 255;
+            pixels_roughness_metalness[i + 1] = 128;
+            pixels_roughness_metalness[i + 2] = 0;
+            pixels_roughness_metalness[i + 3] = 255;
         }
 
         renderer.upload_image(textures[DEFAULT_ALBEDO_TEXTURE_NAME].get());
         renderer.upload_image(textures[DEFAULT_NORMAL_TEXTURE_NAME].get());
-        renderer.upload_image(textures[DEFAULT_ROUGHNESS_TEXTURE_NAME].get());
-        renderer.upload_image(textures[DEFAULT_METALNESS_TEXTURE_NAME].get());
+        renderer.upload_image(textures[DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME].get());
+
+        for (const auto& texture_p : textures)
+        {
+            last_used_frames[texture_p.second.get()] = frame;
+        }
     }
 
-    ref<Image> TextureManager::get(const str& name)
+    ref<Image> TextureManager::get(const str& raw_name, const b8 allow_streaming, const ColorSpace color_space)
     {
+        // Different paths to the same file (or to a file with the same contents) map to the same texture
+        const str name = aliases.resolve(raw_name);
+
         // Texture found
         auto it = textures.find(name);
         if (it != textures.end())
@@ -57,25 +78,71 @@ namespace mag
             return it->second;
         }
 
+        const str file_path = get_texture_file_path(name);
+
+        // Cooked textures store the hash of their contents, so duplicates are found before loading anything.
+        // Otherwise the contents are hashed once loaded.
+        u64 content_hash = 0;
+        const b8 has_content_hash = resource::read_texture_hash(file_path, &content_hash);
+        if (has_content_hash)
+        {
+            const str resource_name = aliases.find_contents(content_hash);
+            if (!resource_name.empty())
+            {
+                aliases.add_alias(name, resource_name);
+                return textures[resource_name];
+            }
+
+            aliases.add_contents(name, content_hash);
+        }
+
+        // Source -> native -> texture, so the texture is cooked and reloaded when the source changes
+        auto& asset_graph = get_application().get_asset_graph();
+        const AssetNode texture_node = {AssetType::Texture, name};
+
+        if (!file_path.ends_with(TEXTURE_FILE_EXTENSION))
+        {
+            asset_graph.add_dependency({AssetType::SourceTexture, name}, texture_node);
+        }
+
+        else
+        {
+            asset_graph.add_dependency({AssetType::NativeTexture, file_path}, texture_node);
+            if (file_path != name)
+            {
+                asset_graph.add_dependency({AssetType::SourceTexture, name}, {AssetType::NativeTexture, file_path});
+            }
+        }
+
+        // Native textures have all mips precomputed, so they can be loaded starting from the smallest ones
+        if (allow_streaming && file_path.ends_with(TEXTURE_FILE_EXTENSION))
+        {
+            return get_streaming(name, file_path);
+        }
+
         auto& app = get_application();
         auto& job_system = app.get_job_system();
         auto& renderer = app.get_renderer();
 
         // Create a new texture
         Image* image = new Image();
+        image->color_space = color_space;
 
         textures[name] = ref<Image>(image);
+        last_used_frames[image] = frame;
 
         // Try to create placeholder texture with the texture dimensions (otherwise use default settings)
-        if (resource::get_image_info(name, &image->width, &image->height, reinterpret_cast<u32*>(&image->channels),
-                                     &image->mip_levels))
+        u32 channels = 0;
+        if (resource::get_image_info(file_path, &image->width, &image->height, &channels, &image->mip_levels,
+                                     &image->format, &image->color_space))
         {
-            image->pixels.resize(image->width * image->height * image->channels, image->pixels[0]);
+            image->channels = channels;
+            create_placeholder_pixels(*image);
         }
 
         else
         {
-            LOG_ERROR("Failed to retrieve image dimensions for '{0}'", name);
+            LOG_ERROR("Failed to retrieve image dimensions for '{0}'", file_path);
         }
 
         // Send image data to the GPU
@@ -83,26 +150,63 @@ namespace mag
 
         // Temporary image to load data into
         Image* transfer_image = new Image(*image);
+        u64* loaded_content_hash = new u64(content_hash);
 
         // Load in another thread
-        auto execute = [name, transfer_image]
+        auto execute = [file_path, transfer_image, loaded_content_hash, has_content_hash,
+                        generate_mips = cpu_mip_generation]
         {
             // If the load fails we still have valid data
-            return resource::load(name, transfer_image);
+            const b8 result = load_texture(file_path, transfer_image, generate_mips);
+            if (result && !has_content_hash)
+            {
+                *loaded_content_hash = get_image_hash(*transfer_image);
+            }
+
+            return result;
         };
 
-        // Callback when finished loading
-        auto load_finished_callback = [image, transfer_image, &renderer](const b8 result)
+        // Callback when finished loading (the pending load keeps the texture from being released while loading)
+        pending_loads.add(image);
+        auto load_finished_callback = [this, name, image, transfer_image, loaded_content_hash, has_content_hash,
+                                       &renderer](const b8 result)
         {
+            pending_loads.remove(image);
+
+            // Replaced in the meantime (i.e. shared with a texture with the same contents)
+            auto texture_it = textures.find(name);
+            if (texture_it == textures.end() || texture_it->second.get() != image)
+            {
+                delete transfer_image;
+                delete loaded_content_hash;
+                return;
+            }
+
+            const str resource_name = aliases.find_contents(*loaded_content_hash);
+
+            // Same contents as a texture loaded through another path. Share it unless this one is already referenced
+            // outside the manager.
+            if (result == true && !has_content_hash && !resource_name.empty() && !is_referenced(texture_it->second))
+            {
+                release(name);
+                aliases.add_alias(name, resource_name);
+            }
+
             // Update the image and the renderer image data
-            if (result == true)
+            else if (result == true)
             {
+                if (!has_content_hash && resource_name.empty())
+                {
+                    aliases.add_contents(name, *loaded_content_hash);
+                }
+
                 *image = *transfer_image;
                 renderer.update_image(image);
             }
 
             // We can dispose of the temporary image now
             delete transfer_image;
+            delete loaded_content_hash;
         };
 
         Job load_job = Job(execute, load_finished_callback);
@@ -111,5 +215,544 @@ namespace mag
         return textures[name];
     }
 
+    ref<Image> TextureManager::get_streaming(const str& name, const str& file_path)
+    {
+        auto& renderer = get_application().get_renderer();
+
+        Image* image = new Image();
+        textures[name] = ref<Image>(image);
+        last_used_frames[image] = frame;
+
+        // Dimensions of the whole texture
+        Image info;
+        u32 channels = 0;
+        if (!resource::get_image_info(file_path, &info.width, &info.height, &channels, &info.mip_levels,
+                                      &info.format, &info.color_space))
+        {
+            LOG_ERROR("Failed to retrieve image dimensions for '{0}'", file_path);
+            renderer.upload_image(image);
+            return textures[name];
+        }
+
+        info.channels = channels;
+
+        StreamingTexture texture;
+        texture.file_path = file_path;
+        initialize_streaming_texture(texture, info);
+
+        // Nothing is resident until the tail finishes loading
+        texture.resident_mip_level = info.mip_levels;
+
+        // Placeholder with the dimensions of the tail
+        image->format = info.format;
+        image->color_space = info.color_space;
+        image->channels = info.channels;
+        image->width = std::max(info.width >> texture.tail_mip_level, 1u);
+        image->height = std::max(info.height >> texture.tail_mip_level, 1u);
+        image->mip_levels = info.mip_levels - texture.tail_mip_level;
+        create_placeholder_pixels(*image);
+
+        renderer.upload_image(image);
+
+        streaming_textures[image] = texture;
+        request_mips(image, texture.tail_mip_level);
+
+        return textures[name];
+    }
+
+    void TextureManager::request_mips(Image* image, const u32 mip_level)
+    {
+        auto& app = get_application();
+        auto& job_system = app.get_job_system();
+        auto& renderer = app.get_renderer();
+
+        auto& texture = streaming_textures[image];
+        texture.loading = true;
+
+        // Temporary image to load data into
+        Image* transfer_image = new Image();
+
+        // Load in another thread
+        auto execute = [file_path = texture.file_path, transfer_image, mip_level]
+        { return resource::load_mips(file_path, transfer_image, mip_level); };
+
+        // Callback when finished loading
+        auto load_finished_callback =
+            [this, image, transfer_image, mip_level, version = texture.version, &renderer](const b8 result)
+        {
+            // The texture was reloaded in the meantime, these mips are from the previous version
+            auto it = streaming_textures.find(image);
+            if (it == streaming_textures.end() || it->second.version != version)
+            {
+                delete transfer_image;
+                return;
+            }
+
+            auto& texture = it->second;
+            texture.loading = false;
+
+            // Stop streaming the texture if it can't be read
+            if (result == false)
+            {
+                LOG_ERROR("Failed to stream mips of texture '{0}'", texture.file_path);
+                streaming_textures.erase(image);
+            }
+
+            // Only apply if it is still an improvement
+            else if (mip_level < texture.resident_mip_level)
+            {
+                *image = std::move(*transfer_image);
+                texture.resident_mip_level = mip_level;
+
+                renderer.update_image(image);
+            }
+
+            // We can dispose of the temporary image now
+            delete transfer_image;
+        };
+
+        Job load_job = Job(execute, load_finished_callback);
+        job_system.add_job(load_job);
+    }
+
+    void TextureManager::reload(const str& name)
+    {
+        auto it = textures.find(name);
+        if (it == textures.end())
+        {
+            return;
+        }
+
+        auto& job_system = get_application().get_job_system();
+
+        // The other paths with the same contents get their own texture from now on
+        aliases.remove(name);
+
+        // Temporary image to load data into. Streaming textures are loaded whole and their mips are evicted again if
+        // the budget is exceeded.
+        Image* transfer_image = new Image();
+        transfer_image->color_space = it->second->color_space;
+        const str file_path = get_texture_file_path(name);
+
+        // Load in another thread
+        auto execute = [file_path, transfer_image, generate_mips = cpu_mip_generation]
+        { return load_texture(file_path, transfer_image, generate_mips); };
+
+        // Callback when finished loading
+        Image* image = it->second.get();
+        pending_loads.add(image);
+
+        auto load_finished_callback = [this, name, file_path, image, transfer_image](const b8 result)
+        {
+            pending_loads.remove(image);
+
+            // Released in the meantime
+            auto texture_it = textures.find(name);
+            if (texture_it == textures.end() || texture_it->second.get() != image)
+            {
+                delete transfer_image;
+                return;
+            }
+
+            if (result == false)
+            {
+                LOG_ERROR("Failed to reload texture '{0}'", name);
+            }
+
+            else
+            {
+                // Mips still being streamed are from the previous version. Only native textures have all the mips, so
+                // the texture is no longer streamed if its source is newer (i.e. it failed to cook).
+                auto streaming_it = streaming_textures.find(image);
+                if (streaming_it != streaming_textures.end() && !file_path.ends_with(TEXTURE_FILE_EXTENSION))
+                {
+                    streaming_textures.erase(streaming_it);
+                }
+
+                else if (streaming_it != streaming_textures.end())
+                {
+                    auto& streaming_texture = streaming_it->second;
+                    streaming_texture.version++;
+                    streaming_texture.loading = false;
+                    initialize_streaming_texture(streaming_texture, *transfer_image);
+                    streaming_texture.resident_mip_level = 0;
+                }
+
+                replace_image(image, *transfer_image);
+            }
+
+            // We can dispose of the temporary image now
+            delete transfer_image;
+        };
+
+        Job load_job = Job(execute, load_finished_callback);
+        job_system.add_job(load_job);
+    }
+
+    void TextureManager::replace_image(Image* image, Image& new_image)
+    {
+        auto& app = get_application();
+        auto& renderer = app.get_renderer();
+
+        const b8 format_changed = image->format != new_image.format || image->color_space != new_image.color_space;
+        *image = std::move(new_image);
+
+        // The renderer image keeps its format, so it has to be created again
+        if (format_changed)
+        {
+            renderer.remove_image(image);
+            renderer.upload_image(image);
+        }
+
+        else
+        {
+            renderer.update_image(image);
+        }
+    }
+
+    void TextureManager::initialize_streaming_texture(StreamingTexture& texture, const Image& info) const
+    {
+        texture.width = info.width;
+        texture.height = info.height;
+        texture.mip_levels = info.mip_levels;
+
+        texture.mip_sizes.clear();
+        for (u32 i = 0; i < info.mip_levels; i++)
+        {
+            texture.mip_sizes.push_back(get_mip_size(info, i));
+        }
+
+        // The tail holds the mips up to STREAMING_MIP_TAIL_SIZE pixels
+        texture.tail_mip_level = 0;
+        while (texture.tail_mip_level < info.mip_levels - 1 &&
+               std::max(info.width >> texture.tail_mip_level, info.height >> texture.tail_mip_level) >
+                   STREAMING_MIP_TAIL_SIZE)
+        {
+            texture.tail_mip_level++;
+        }
+    }
+
+    void TextureManager::evict_mips(Image* image, StreamingTexture& texture, const u32 mip_level)
+    {
+        auto& renderer = get_application().get_renderer();
+
+        // The smaller mips are already in memory, just drop the bigger ones
+        u64 evicted_size = 0;
+        for (u32 i = texture.resident_mip_level; i < mip_level; i++)
+        {
+            evicted_size += texture.mip_sizes[i];
+        }
+
+        image->pixels.erase(image->pixels.begin(), image->pixels.begin() + evicted_size);
+        image->width = std::max(texture.width >> mip_level, 1u);
+        image->height = std::max(texture.height >> mip_level, 1u);
+        image->mip_levels = texture.mip_levels - mip_level;
+
+        texture.resident_mip_level = mip_level;
+
+        renderer.update_image(image);
+    }
+
+    void TextureManager::update()
+    {
+        frame++;
+
+        // Everything on the GPU counts towards the budget, but only streamed textures can be evicted
+        u64 resident_size = 0;
+        for (const auto& texture_p : textures)
+        {
+            // Textures referenced outside the manager (i.e. by sprites) are always in use
+            if (is_referenced(texture_p.second))
+            {
+                last_used_frames[texture_p.second.get()] = frame;
+            }
+
+            resident_size += get_mip_chain_size(*texture_p.second);
+        }
+
+        // Release the textures that are no longer used before evicting mips
+        if (resident_size > statistics.budget)
+        {
+            const std::vector<str> pinned_names = {DEFAULT_ALBEDO_TEXTURE_NAME, DEFAULT_NORMAL_TEXTURE_NAME,
+                                                   DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME};
+
+            for (const auto& name :
+                 get_eviction_candidates(textures, last_used_frames, pending_loads, frame, pinned_names))
+            {
+                if (resident_size <= statistics.budget)
+                {
+                    break;
+                }
+
+                Image* image = textures[name].get();
+
+                // Wait for the streamed mips to finish loading
+                auto it = streaming_textures.find(image);
+                if (it != streaming_textures.end() && it->second.loading)
+                {
+                    continue;
+                }
+
+                resident_size -= get_mip_chain_size(*image);
+                release(name);
+
+                statistics.evicted_textures++;
+            }
+        }
+
+        // Evict the biggest mip of the least recently used textures until the budget is respected. Only one mip per
+        // texture per frame, so the uploads are spread over multiple frames.
+        if (resident_size > statistics.budget)
+        {
+            std::vector<std::pair<Image*, StreamingTexture*>> candidates;
+            for (auto& texture_p : streaming_textures)
+            {
+                auto& texture = texture_p.second;
+                if (!texture.loading && texture.resident_mip_level < texture.tail_mip_level &&
+                    frame - last_used_frames[texture_p.first] > RESOURCE_EVICTION_FRAMES)
+                {
+                    candidates.push_back({texture_p.first, &texture});
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end(), [this](const auto& a, const auto& b)
+                      { return last_used_frames[a.first] < last_used_frames[b.first]; });
+
+            for (auto& candidate : candidates)
+            {
+                if (resident_size <= statistics.budget)
+                {
+                    break;
+                }
+
+                auto& texture = *candidate.second;
+
+                resident_size -= texture.mip_sizes[texture.resident_mip_level];
+                evict_mips(candidate.first, texture, texture.resident_mip_level + 1);
+            }
+        }
+
+        // Then stream in the next mip of the textures in use, while they fit in the budget
+        u32 pending_loads = 0;
+        for (const auto& texture_p : streaming_textures)
+        {
+            pending_loads += texture_p.second.loading;
+        }
+
+        for (auto& texture_p : streaming_textures)
+        {
+            auto& texture = texture_p.second;
+            if (pending_loads >= MAX_PENDING_STREAMING_LOADS)
+            {
+                break;
+            }
+
+            // Still loading the tail or already complete
+            if (texture.loading || texture.resident_mip_level == 0 ||
+                texture.resident_mip_level == texture.mip_levels)
+            {
+                continue;
+            }
+
+            if (frame - last_used_frames[texture_p.first] > RESOURCE_EVICTION_FRAMES)
+            {
+                continue;
+            }
+
+            const u64 mip_size = texture.mip_sizes[texture.resident_mip_level - 1];
+            if (resident_size + mip_size > statistics.budget)
+            {
+                continue;
+            }
+
+            request_mips(texture_p.first, texture.resident_mip_level - 1);
+
+            resident_size += mip_size;
+            pending_loads++;
+        }
+
+        statistics.resident_size = resident_size;
+        statistics.deduplicated_textures = aliases.get_aliases().size();
+        statistics.deduplicated_size = get_deduplicated_size(textures, aliases, get_mip_chain_size);
+        statistics.streamed_textures = streaming_textures.size();
+        statistics.pending_loads = pending_loads;
+    }
+
+    void TextureManager::release(const str& name)
+    {
+        auto& app = get_application();
+        Image* image = textures[name].get();
+
+        // GPU resources are destroyed once the frames in flight are done with them
+        app.get_renderer().remove_image(image);
+
+        streaming_textures.erase(image);
+        last_used_frames.erase(image);
+        textures.erase(name);
+        aliases.remove(name);
+    }
+
+    void TextureManager::mark_as_used(Image* image)
+    {
+        auto it = last_used_frames.find(image);
+        if (it != last_used_frames.end())
+        {
+            it->second = frame;
+        }
+    }
+
+    void TextureManager::set_streaming_budget(const u64 budget) { statistics.budget = budget; }
+
+    void TextureManager::set_cpu_mip_generation(const b8 enabled) { cpu_mip_generation = enabled; }
+
+    const TextureStreamingStatistics& TextureManager::get_streaming_statistics() const { return statistics; }
+
     ref<Image> TextureManager::get_default() { return textures[DEFAULT_ALBEDO_TEXTURE_NAME]; }
+
+    b8 load_texture(const str& file_path, Image* image, const b8 generate_mips)
+    {
+        if (!resource::load(file_path, image))
+        {
+            return false;
+        }
+
+        // Source images only have the base level. Mips of sRGB textures are filtered in linear space like the GPU blit.
+        if (generate_mips && !is_block_compressed(image->format))
+        {
+            mip::generate(*image, image->color_space == ColorSpace::Srgb, &get_application().get_job_system());
+        }
+
+        return true;
+    }
+
+    str get_texture_file_path(const str& name)
+    {
+        // Prefer the cooked texture if it is up to date, no decoding or mip generation needed. Shipped packs only
+        // have the cooked one.
+        const str native_file_path = resource::get_native_texture_path(name);
+        if (fs::exists(native_file_path) &&
+            (!fs::exists(name) || fs::get_last_write_time(native_file_path) >= fs::get_last_write_time(name)))
+        {
+            return native_file_path;
+        }
+
+        return name;
+    }
+
+    void create_placeholder_pixels(Image& image)
+    {
+        // Compressed images can't generate mips on the GPU, so the placeholder needs the whole chain in the final
+        // format. Just repeat a single flat block.
+        if (is_block_compressed(image.format))
+        {
+            const std::vector<u8> flat_pixels(16 * 4, image.pixels[0]);
+            const u32 block_size = get_block_size(image.format);
+
+            std::vector<u8> block(block_size);
+            bc::encode_block(image.format, flat_pixels.data(), block.data());
+
+            image.pixels.resize(get_mip_chain_size(image));
+            for (u64 i = 0; i < image.pixels.size(); i += block_size)
+            {
+                memcpy(image.pixels.data() + i, block.data(), block_size);
+            }
+        }
+
+        else
+        {
+            image.pixels.resize(image.width * image.height * image.channels, image.pixels[0]);
+        }
+    }
+
+    b8 is_block_compressed(const TextureFormat format)
+    {
+        return format != TextureFormat::RGBA8 && format != TextureFormat::R8 && format != TextureFormat::RG8;
+    }
+
+    TextureFormat get_uncompressed_format(const u32 channels)
+    {
+        switch (channels)
+        {
+            case 1:
+                return TextureFormat::R8;
+
+            case 2:
+                return TextureFormat::RG8;
+
+            // There is no widely supported 3 channel format, so RGB is expanded to RGBA
+            default:
+                return TextureFormat::RGBA8;
+        }
+    }
+
+    u32 get_block_size(const TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::BC1:
+                return 8;
+
+            case TextureFormat::BC3:
+            case TextureFormat::BC5:
+            case TextureFormat::BC7:
+                return 16;
+
+            default:
+                return 0;
+        }
+    }
+
+    u64 get_mip_size(const Image& image, const u32 mip_level)
+    {
+        const u64 width = std::max(image.width >> mip_level, 1u);
+        const u64 height = std::max(image.height >> mip_level, 1u);
+
+        if (is_block_compressed(image.format))
+        {
+            const u64 blocks_x = (width + 3) / 4;
+            const u64 blocks_y = (height + 3) / 4;
+
+            return blocks_x * blocks_y * get_block_size(image.format);
+        }
+
+        return width * height * image.channels;
+    }
+
+    u64 get_mip_chain_size(const Image& image)
+    {
+        u64 size = 0;
+        for (u32 i = 0; i < image.mip_levels; i++)
+        {
+            size += get_mip_size(image, i);
+        }
+
+        return size;
+    }
+
+    std::vector<u64> get_mip_offsets(const Image& image)
+    {
+        if (image.pixels.size() < get_mip_chain_size(image))
+        {
+            return {};
+        }
+
+        std::vector<u64> offsets(image.mip_levels);
+
+        u64 offset = 0;
+        for (u32 i = 0; i < image.mip_levels; i++)
+        {
+            offsets[i] = offset;
+            offset += get_mip_size(image, i);
+        }
+
+        return offsets;
+    }
+
+    u64 get_image_hash(const Image& image)
+    {
+        const u32 description[] = {static_cast<u32>(image.format), static_cast<u32>(image.color_space), image.channels,
+                                   image.width, image.height, image.mip_levels};
+
+        return hash_data(image.pixels.data(), image.pixels.size(), hash_data(description, sizeof(description)));
+    }
 };  // namespace mag
@@ -4,32 +4,146 @@
 #include <vector>
 
 #include "core/types.hpp"
+#include "resources/resource_cache.hpp"
 
 namespace mag
 {
 #define DEFAULT_ALBEDO_TEXTURE_NAME "__mag_default_albedo_texture__"
 #define DEFAULT_NORMAL_TEXTURE_NAME "__mag_default_normal_texture__"
+#define DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME "__mag_default_roughness_metalness_texture__"
+
+// Only used to mark missing sources of the packed roughness/metalness texture (see TextureImporter)
 #define DEFAULT_ROUGHNESS_TEXTURE_NAME "__mag_default_roughness_texture__"
 #define DEFAULT_METALNESS_TEXTURE_NAME "__mag_default_metalness_texture__"
 
+#define TEXTURE_FILE_EXTENSION ".tex.bin"
+#define PACKED_TEXTURE_FILE_EXTENSION ".roughness_metalness" TEXTURE_FILE_EXTENSION
+
+    enum class TextureFormat
+    {
+        RGBA8 = 0,
+        R8,   // Single channel data (i.e. roughness maps). Sampled as (R, R, R, 1).
+        RG8,  // Grayscale + alpha. Sampled as (R, R, R, G).
+
+        // Block compressed formats (4x4 pixel blocks)
+        BC1,  // RGB(A), 8 bytes per block
+        BC3,  // RGBA, 16 bytes per block
+        BC5,  // RG, 16 bytes per block. Used for normal maps.
+        BC7   // RGBA, 16 bytes per block
+    };
+
+    // Color textures are sampled as sRGB. Data textures (normal maps, roughness/metalness) are sampled as UNORM, so
+    // the shaders read the stored values.
+    enum class ColorSpace
+    {
+        Srgb = 0,
+        Linear
+    };
+
     struct Image
     {
+            TextureFormat format = TextureFormat::RGBA8;
+            ColorSpace color_space = ColorSpace::Srgb;
             u8 channels = 4;
             u32 width = 64;
             u32 height = 64;
             u32 mip_levels = 1;
+
+            // Either only the base level (mips are then generated on the GPU) or the whole mip chain, starting from
+            // the base level, for cooked images and images with CPU generated mips (see mip::generate)
             std::vector<u8> pixels = std::vector<u8>(64 * 64 * 4, 153);
     };
 
+    b8 is_block_compressed(const TextureFormat format);
+    TextureFormat get_uncompressed_format(const u32 channels);
+    u32 get_block_size(const TextureFormat format);
+
+    u64 get_mip_size(const Image& image, const u32 mip_level);
+    u64 get_mip_chain_size(const Image& image);
+
+    // Offset of each mip level in the pixels. Empty if the image does not have the whole mip chain.
+    std::vector<u64> get_mip_offsets(const Image& image);
+
+    // Hash of the format, color space, dimensions and pixels
+    u64 get_image_hash(const Image& image);
+
+#define DEFAULT_TEXTURE_STREAMING_BUDGET (512ull * 1024 * 1024)
+
+    struct TextureStreamingStatistics
+    {
+            u64 budget = 0;
+            u64 resident_size = 0;  // Of all textures, not only the streamed ones
+            u32 streamed_textures = 0;
+            u32 pending_loads = 0;
+            u32 evicted_textures = 0;  // Since startup
+
+            // Paths that share the texture of another path with the same contents and the size they would take
+            u32 deduplicated_textures = 0;
+            u64 deduplicated_size = 0;
+    };
+
+    // Cooked textures are streamed: the smallest mips are loaded first and the bigger ones are loaded progressively
+    // while the textures are being used. When the memory used by the textures exceeds the budget, the textures that are
+    // no longer referenced are released first and then the biggest mips of the textures that were not used recently
+    // are evicted.
     class TextureManager
     {
         public:
             TextureManager();
 
-            ref<Image> get(const str& name);
+            // Textures that are not streamed keep their dimensions, so views of them can be cached. Source images are
+            // sampled with the given color space, cooked textures keep the one they were cooked with.
+            ref<Image> get(const str& name, const b8 allow_streaming = true,
+                           const ColorSpace color_space = ColorSpace::Srgb);
             ref<Image> get_default();
 
+            // Streams mips in and out and releases unused textures. Called once per frame.
+            void update();
+
+            // Loads the texture again in place, the references to it stay valid (see AssetGraph)
+            void reload(const str& name);
+
+            // Marks the texture as visible in the current frame
+            void mark_as_used(Image* image);
+
+            void set_streaming_budget(const u64 budget);
+
+            // Generate the mips of source images in the load jobs instead of with blits on the GPU
+            void set_cpu_mip_generation(const b8 enabled);
+
+            const TextureStreamingStatistics& get_streaming_statistics() const;
+
         private:
+            struct StreamingTexture
+            {
+                    str file_path;
+                    u32 width = 0;
+                    u32 height = 0;
+                    u32 mip_levels = 0;
+                    std::vector<u64> mip_sizes;  // Of the whole texture
+
+                    u32 tail_mip_level = 0;      // Smallest mips are always resident
+                    u32 resident_mip_level = 0;  // Biggest mip on the GPU
+                    b8 loading = false;
+                    u32 version = 0;  // Incremented when the texture is reloaded
+            };
+
+            void initialize_streaming_texture(StreamingTexture& texture, const Image& info) const;
+            void replace_image(Image* image, Image& new_image);
+
+            ref<Image> get_streaming(const str& name, const str& file_path);
+            void request_mips(Image* image, const u32 mip_level);
+            void evict_mips(Image* image, StreamingTexture& texture, const u32 mip_level);
+            void release(const str& name);
+
             std::map<str, ref<Image>> textures;
+            std::map<Image*, StreamingTexture> streaming_textures;
+            std::map<Image*, u64> last_used_frames;
+            PendingLoads<Image> pending_loads;
+            ResourceAliases aliases;
+
+            TextureStreamingStatistics statistics;
+            u64 frame = 0;
+            b8 cpu_mip_generation = true;
     };
 };  // namespace mag
@@ -14,8 +14,28 @@
 
 namespace mag
 {
+#define TEXTURE_FILE_MAGIC 0x5845544d  // "MTEX"
+#define TEXTURE_FILE_VERSION 5
+
+    struct TextureFileHeader
+    {
+            u32 magic;
+            u32 version;
+            u32 format;
+            u32 color_space;
+            u32 width;
+            u32 height;
+            u32 channels;
+            u32 mip_levels;
+            u64 pixels_size;
+            u64 content_hash;  // See get_image_hash
+    };
+
     namespace resource
     {
+        b8 load_native(const str& file_path, Image* image);
+        b8 read_native_header(const str& file_path, TextureFileHeader& header);
+
         b8 load(const str& file_path, Image* image)
         {
             if (!image)
@@ -24,12 +44,23 @@ namespace mag
                 return false;
             }
 
+            if (file_path.ends_with(TEXTURE_FILE_EXTENSION))
+            {
+                return load_native(file_path, image);
+            }
+
             Buffer buffer;
             fs::read_binary_data(file_path, buffer);
 
+            // Keep the channels of the file so single channel maps are not expanded to RGBA
             i32 tex_width = 0, tex_height = 0, tex_channels = 0;
+            stbi_info_from_memory(buffer.data.data(), buffer.get_size(), &tex_width, &tex_height, &tex_channels);
+
+            const TextureFormat format = get_uncompressed_format(tex_channels);
+            const i32 desired_channels = format == TextureFormat::RGBA8 ? STBI_rgb_alpha : tex_channels;
+
             stbi_uc* pixels = stbi_load_from_memory(buffer.data.data(), buffer.get_size(), &tex_width, &tex_height,
-                                                    &tex_channels, STBI_rgb_alpha);
+                                                    &tex_channels, desired_channels);
 
             if (pixels == NULL)
             {
@@ -39,12 +70,12 @@ namespace mag
                 return false;
             }
 
-            // @TODO: hardcoded channels
-            tex_channels = 4;
+            tex_channels = desired_channels;
 
             const u64 image_size = tex_width * tex_height * tex_channels;
 
             // Update image data
+            image->format = format;
             image->width = tex_width;
             image->height = tex_height;
             image->channels = tex_channels;
@@ -56,15 +87,199 @@ namespace mag
             return true;
         }
 
-        b8 get_image_info(const str& raw_file_path, u32* width, u32* height, u32* channels, u32* mip_levels)
+        b8 load_native(const str& file_path, Image* image)
+        {
+            Buffer buffer;
+            if (!fs::read_binary_data(file_path, buffer))
+            {
+                return false;
+            }
+
+            if (buffer.get_size() < sizeof(TextureFileHeader))
+            {
+                LOG_ERROR("Invalid native texture file: '{0}'", file_path);
+                return false;
+            }
+
+            TextureFileHeader header;
+            memcpy(&header, buffer.data.data(), sizeof(TextureFileHeader));
+
+            if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION ||
+                buffer.get_size() != sizeof(TextureFileHeader) + header.pixels_size)
+            {
+                LOG_ERROR("Invalid native texture file: '{0}'", file_path);
+                return false;
+            }
+
+            // Pixels are already in the final layout, just copy them
+            image->format = static_cast<TextureFormat>(header.format);
+            image->color_space = static_cast<ColorSpace>(header.color_space);
+            image->width = header.width;
+            image->height = header.height;
+            image->channels = header.channels;
+            image->mip_levels = header.mip_levels;
+            image->pixels = std::vector<u8>(buffer.data.begin() + sizeof(TextureFileHeader), buffer.data.end());
+
+            return true;
+        }
+
+        b8 load_mips(const str& raw_file_path, Image* image, const u32 first_mip_level)
         {
+            if (!image)
+            {
+                LOG_ERROR("Invalid image ptr");
+                return false;
+            }
+
             const str file_path = fs::get_fixed_path(raw_file_path);
 
+            TextureFileHeader header;
+            if (!read_native_header(file_path, header))
+            {
+                return false;
+            }
+
+            if (first_mip_level >= header.mip_levels)
+            {
+                LOG_ERROR("Invalid mip level {0} for texture '{1}'", first_mip_level, file_path);
+                return false;
+            }
+
+            Image full_image;
+            full_image.format = static_cast<TextureFormat>(header.format);
+            full_image.width = header.width;
+            full_image.height = header.height;
+            full_image.channels = header.channels;
+            full_image.mip_levels = header.mip_levels;
+
+            if (header.pixels_size != get_mip_chain_size(full_image))
+            {
+                LOG_ERROR("Native texture '{0}' does not contain all mip levels", file_path);
+                return false;
+            }
+
+            // Mips are stored from the biggest to the smallest, so the requested ones are at the end of the file
+            u64 offset = 0;
+            for (u32 i = 0; i < first_mip_level; i++)
+            {
+                offset += get_mip_size(full_image, i);
+            }
+
+            Buffer buffer;
+            if (!fs::read_binary_data(file_path, sizeof(TextureFileHeader) + offset, header.pixels_size - offset,
+                                      buffer))
+            {
+                LOG_ERROR("Failed to read mips of texture '{0}'", file_path);
+                return false;
+            }
+
+            image->format = full_image.format;
+            image->color_space = static_cast<ColorSpace>(header.color_space);
+            image->width = std::max(header.width >> first_mip_level, 1u);
+            image->height = std::max(header.height >> first_mip_level, 1u);
+            image->channels = header.channels;
+            image->mip_levels = header.mip_levels - first_mip_level;
+            image->pixels = std::move(buffer.data);
+
+            return true;
+        }
+
+        b8 save(const str& file_path, const Image* image)
+        {
+            if (!image)
+            {
+                LOG_ERROR("Invalid image ptr");
+                return false;
+            }
+
+            TextureFileHeader header;
+            header.magic = TEXTURE_FILE_MAGIC;
+            header.version = TEXTURE_FILE_VERSION;
+            header.format = static_cast<u32>(image->format);
+            header.color_space = static_cast<u32>(image->color_space);
+            header.width = image->width;
+            header.height = image->height;
+            header.channels = image->channels;
+            header.mip_levels = image->mip_levels;
+            header.pixels_size = image->pixels.size();
+            header.content_hash = get_image_hash(*image);
+
+            Buffer buffer(sizeof(TextureFileHeader) + image->pixels.size());
+            memcpy(buffer.data.data(), &header, sizeof(TextureFileHeader));
+            memcpy(buffer.data.data() + sizeof(TextureFileHeader), image->pixels.data(), image->pixels.size());
+
+            if (!fs::write_binary_data(file_path, buffer))
+            {
+                LOG_ERROR("Failed to write native texture file: '{0}'", file_path);
+                return false;
+            }
+
+            return true;
+        }
+
+        b8 read_native_header(const str& file_path, TextureFileHeader& header)
+        {
+            // Only the header is needed, don't read the whole file
+            Buffer buffer;
+            if (!fs::read_binary_data(file_path, 0, sizeof(TextureFileHeader), buffer))
+            {
+                return false;
+            }
+
+            memcpy(&header, buffer.data.data(), sizeof(TextureFileHeader));
+            if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION)
+            {
+                LOG_ERROR("Invalid native texture file: '{0}'", file_path);
+                return false;
+            }
+
+            return true;
+        }
+
+        b8 read_texture_hash(const str& file_path, u64* hash)
+        {
+            TextureFileHeader header;
+            if (!file_path.ends_with(TEXTURE_FILE_EXTENSION) || !read_native_header(file_path, header))
+            {
+                return false;
+            }
+
+            *hash = header.content_hash;
+            return true;
+        }
+
+        b8 get_image_info(const str& raw_file_path, u32* width, u32* height, u32* channels, u32* mip_levels,
+                          TextureFormat* format, ColorSpace* color_space)
+        {
+            const str file_path = fs::get_fixed_path(raw_file_path);
+
+            if (file_path.ends_with(TEXTURE_FILE_EXTENSION))
+            {
+                TextureFileHeader header;
+                if (!read_native_header(file_path, header))
+                {
+                    return false;
+                }
+
+                *width = header.width;
+                *height = header.height;
+                *channels = header.channels;
+                *mip_levels = header.mip_levels;
+                *format = static_cast<TextureFormat>(header.format);
+
+                if (color_space)
+                {
+                    *color_space = static_cast<ColorSpace>(header.color_space);
+                }
+
+                return true;
+            }
+
             const b8 result = stbi_info(file_path.c_str(), reinterpret_cast<i32*>(width),
                                         reinterpret_cast<i32*>(height), reinterpret_cast<i32*>(channels));
 
-            // @TODO: hardcoded channels
-            *channels = 4;
+            *format = get_uncompressed_format(*channels);
+            *channels = *format == TextureFormat::RGBA8 ? 4 : *channels;
 
             *mip_levels = static_cast<u32>(std::floor(std::log2(std::max(*width, *height)))) + 1;
 
@@ -79,5 +294,13 @@ namespace mag
 
             return supported_formats.contains(extension_with_dot);
         }
+
+        str get_native_texture_path(const str& raw_file_path)
+        {
+            const auto file_path = fs::get_fixed_path(raw_file_path);
+            const auto directory = file_path.parent_path();
+
+            return (directory / "native" / file_path.filename()).string() + TEXTURE_FILE_EXTENSION;
+        }
     };  // namespace resource
 };      // namespace mag
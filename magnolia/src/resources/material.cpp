@@ -1,6 +1,9 @@
 #include "resources/material.hpp"
 
 #include "core/application.hpp"
+#include "core/hash.hpp"
+#include "platform/file_system.hpp"
+#include "resources/asset_graph.hpp"
 #include "resources/image.hpp"
 #include "resources/resource_loader.hpp"
 #include "threads/job_system.hpp"
@@ -9,16 +12,22 @@ namespace mag
 {
     MaterialManager::MaterialManager()
     {
+        statistics.budget = DEFAULT_MATERIAL_BUDGET;
+
         materials[DEFAULT_MATERIAL_NAME] = create_ref<Material>();
         materials[DEFAULT_MATERIAL_NAME]->name = "Default";
+        materials[DEFAULT_MATERIAL_NAME]->material_name = "Default";
         materials[DEFAULT_MATERIAL_NAME]->textures[TextureSlot::Albedo] = DEFAULT_ALBEDO_TEXTURE_NAME;
         materials[DEFAULT_MATERIAL_NAME]->textures[TextureSlot::Normal] = DEFAULT_NORMAL_TEXTURE_NAME;
-        materials[DEFAULT_MATERIAL_NAME]->textures[TextureSlot::Roughness] = DEFAULT_ROUGHNESS_TEXTURE_NAME;
-        materials[DEFAULT_MATERIAL_NAME]->textures[TextureSlot::Metalness] = DEFAULT_METALNESS_TEXTURE_NAME;
+        materials[DEFAULT_MATERIAL_NAME]->textures[TextureSlot::RoughnessMetalness] =
+            DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME;
     }
 
-    ref<Material> MaterialManager::get(const str& name)
+    ref<Material> MaterialManager::get(const str& raw_name)
     {
+        // Different paths to the same file (or to a material with the same contents) map to the same material
+        const str name = aliases.resolve(raw_name);
+
         auto it = materials.find(name);
         if (it != materials.end())
         {
@@ -31,6 +40,7 @@ namespace mag
         // Create a new material
         Material* material = new Material(*materials[DEFAULT_MATERIAL_NAME]);
         materials[name] = ref<Material>(material);
+        last_used_frames[material] = frame;
 
         // Temporary material to load data into
         Material* transfer_material = new Material(*material);
@@ -43,14 +53,43 @@ namespace mag
             return resource::load(name, transfer_material);
         };
 
-        // Callback when finished loading
-        auto load_finished_callback = [material, transfer_material](const b8 result)
+        // Callback when finished loading (the pending load keeps the material from being released while loading)
+        pending_loads.add(material);
+        auto load_finished_callback = [this, name, material, transfer_material](const b8 result)
         {
+            pending_loads.remove(material);
+
+            // Replaced in the meantime (i.e. shared with a material with the same contents)
+            auto material_it = materials.find(name);
+            if (material_it == materials.end() || material_it->second.get() != material)
+            {
+                delete transfer_material;
+                return;
+            }
+
+            const u64 content_hash = result ? get_material_hash(*transfer_material) : 0;
+            const str resource_name = result ? aliases.find_contents(content_hash) : "";
+
+            // Same contents as a material loaded from another file. Share it unless this one is already referenced
+            // outside the manager.
+            if (!resource_name.empty() && !is_referenced(material_it->second))
+            {
+                release(name);
+                aliases.add_alias(name, resource_name);
+            }
+
             // Update the material and the renderer material data
-            if (result == true)
+            else if (result == true)
             {
+                if (resource_name.empty())
+                {
+                    aliases.add_contents(name, content_hash);
+                }
+
                 transfer_material->loading_state = MaterialLoadingState::LoadingFinished;
                 *material = *transfer_material;
+
+                add_dependencies(name, *material);
             }
 
             // We can dispose of the temporary material now
@@ -63,5 +102,151 @@ namespace mag
         return materials[name];
     }
 
+    void MaterialManager::reload(const str& name)
+    {
+        auto it = materials.find(name);
+        if (it == materials.end())
+        {
+            return;
+        }
+
+        auto& job_system = get_application().get_job_system();
+
+        // The other paths with the same contents get their own material from now on
+        aliases.remove(name);
+
+        // Temporary material to load data into
+        Material* transfer_material = new Material(*it->second);
+
+        // Load in another thread
+        auto execute = [name, transfer_material] { return resource::load(name, transfer_material); };
+
+        // Callback when finished loading
+        Material* material = it->second.get();
+        pending_loads.add(material);
+
+        auto load_finished_callback = [this, name, material, transfer_material](const b8 result)
+        {
+            pending_loads.remove(material);
+
+            // Released in the meantime
+            auto material_it = materials.find(name);
+            if (material_it == materials.end() || material_it->second.get() != material)
+            {
+                delete transfer_material;
+                return;
+            }
+
+            if (result == true)
+            {
+                transfer_material->loading_state = MaterialLoadingState::LoadingFinished;
+                *material = *transfer_material;
+
+                add_dependencies(name, *material);
+            }
+
+            // We can dispose of the temporary material now
+            delete transfer_material;
+        };
+
+        Job load_job = Job(execute, load_finished_callback);
+        job_system.add_job(load_job);
+    }
+
+    void MaterialManager::add_dependencies(const str& name, const Material& material)
+    {
+        auto& asset_graph = get_application().get_asset_graph();
+
+        // Texture -> material, the descriptors of the material are updated when one of its textures is reloaded
+        for (const auto& texture_p : material.textures)
+        {
+            asset_graph.add_dependency({AssetType::Texture, fs::get_normalized_path(texture_p.second).string()},
+                                       {AssetType::Material, name});
+        }
+    }
+
     ref<Material> MaterialManager::get_default() { return materials[DEFAULT_MATERIAL_NAME]; }
+
+    void MaterialManager::update()
+    {
+        frame++;
+
+        u64 size = 0;
+        for (const auto& material_p : materials)
+        {
+            if (is_referenced(material_p.second))
+            {
+                last_used_frames[material_p.second.get()] = frame;
+            }
+
+            size += get_material_size(*material_p.second);
+        }
+
+        if (size > statistics.budget)
+        {
+            for (const auto& name :
+                 get_eviction_candidates(materials, last_used_frames, pending_loads, frame, {DEFAULT_MATERIAL_NAME}))
+            {
+                if (size <= statistics.budget)
+                {
+                    break;
+                }
+
+                size -= get_material_size(*materials[name]);
+                release(name);
+
+                statistics.evicted_resources++;
+            }
+        }
+
+        statistics.size = size;
+        statistics.resources = materials.size();
+        statistics.deduplicated_resources = aliases.get_aliases().size();
+        statistics.deduplicated_size = get_deduplicated_size(materials, aliases, get_material_size);
+    }
+
+    void MaterialManager::mark_as_used(Material* material)
+    {
+        auto it = last_used_frames.find(material);
+        if (it != last_used_frames.end())
+        {
+            it->second = frame;
+        }
+    }
+
+    void MaterialManager::release(const str& name)
+    {
+        Material* material = materials[name].get();
+
+        last_used_frames.erase(material);
+        materials.erase(name);
+        aliases.remove(name);
+    }
+
+    void MaterialManager::set_budget(const u64 budget) { statistics.budget = budget; }
+
+    const ResourceStatistics& MaterialManager::get_statistics() const { return statistics; }
+
+    u64 get_material_size(const Material& material)
+    {
+        u64 size = sizeof(Material) + material.name.size() + material.material_name.size();
+        for (const auto& texture_p : material.textures)
+        {
+            size += sizeof(texture_p) + texture_p.second.size();
+        }
+
+        return size;
+    }
+
+    u64 get_material_hash(const Material& material)
+    {
+        str contents = material.material_name + "\n";
+        for (const auto& texture_p : material.textures)
+        {
+            contents += std::to_string(static_cast<u32>(texture_p.first)) + ":" +
+                        fs::get_normalized_path(texture_p.second).string() + "\n";
+        }
+
+        return hash_string(contents);
+    }
 };  // namespace mag
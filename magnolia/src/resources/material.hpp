@@ -3,17 +3,18 @@
 #include <map>
 
 #include "core/types.hpp"
+#include "resources/resource_cache.hpp"
 
 namespace mag
 {
 #define DEFAULT_MATERIAL_NAME "__mag_default_material__"
+#define DEFAULT_MATERIAL_BUDGET (4ull * 1024 * 1024)
 
     enum class TextureSlot
     {
         Albedo = 0,
         Normal,
-        Roughness,
-        Metalness,
+        RoughnessMetalness,  // R - ambient occlusion | G - roughness | B - metalness
 
         TextureCount
     };
@@ -33,11 +34,20 @@ namespace mag
     struct Material
     {
             std::map<TextureSlot, str> textures;
-            str name = "";
+            str name = "";           // File path of the material
+            str material_name = "";  // Name in the material file
 
             MaterialLoadingState loading_state = MaterialLoadingState::NotLoaded;
     };
 
+    // Approximate size of the material data
+    u64 get_material_size(const Material& material);
+
+    // Hash of the material name and the textures, everything loaded from the file but its path. The texture names are
+    // normalized, so the same texture reached through different paths matches.
+    u64 get_material_hash(const Material& material);
+
+    // Materials are referenced by name, so they are considered in use while they are being rendered (see mark_as_used)
     class MaterialManager
     {
         public:
@@ -46,7 +56,28 @@ namespace mag
             ref<Material> get(const str& name);
             ref<Material> get_default();
 
+            // Loads the material again in place, the references to it stay valid (see AssetGraph)
+            void reload(const str& name);
+
+            // Releases the least recently used materials over the budget. Called once per frame.
+            void update();
+
+            // Marks the material as visible in the current frame
+            void mark_as_used(Material* material);
+
+            void set_budget(const u64 budget);
+            const ResourceStatistics& get_statistics() const;
+
         private:
+            void add_dependencies(const str& name, const Material& material);
+            void release(const str& name);
+
             std::map<str, ref<Material>> materials;
+            std::map<Material*, u64> last_used_frames;
+            PendingLoads<Material> pending_loads;
+            ResourceAliases aliases;
+
+            ResourceStatistics statistics;
+            u64 frame = 0;
     };
 };  // namespace mag
@@ -4,12 +4,15 @@
 
 #include "core/logger.hpp"
 #include "platform/file_system.hpp"
+#include "resources/image.hpp"
 #include "resources/material.hpp"
 
 namespace mag
 {
     namespace resource
     {
+        str get_roughness_metalness_texture(const str& file_path, const str& material_name, const json& textures);
+
         b8 load(const str& file_path, Material* material)
         {
             json data;
@@ -44,13 +47,38 @@ namespace mag
 
             // Set material data
             material->name = file_path;
+            material->material_name = material_name;
             material->textures[TextureSlot::Albedo] = textures["Albedo"];
             material->textures[TextureSlot::Normal] = textures["Normal"];
-            material->textures[TextureSlot::Roughness] = textures["Roughness"];
-            material->textures[TextureSlot::Metalness] = textures["Metalness"];
+            material->textures[TextureSlot::RoughnessMetalness] =
+                get_roughness_metalness_texture(file_path, material_name, textures);
 
             LOG_SUCCESS("Loaded material: {0}", file_path);
             return true;
         }
+
+        str get_roughness_metalness_texture(const str& file_path, const str& material_name, const json& textures)
+        {
+            // Packed when the model is cooked (see ModelImporter). Materials written before the textures were packed
+            // don't have the path, the cooker writes the texture next to the material.
+            const str default_packed_texture_path =
+                (fs::get_fixed_path(file_path).parent_path() / material_name).string() + PACKED_TEXTURE_FILE_EXTENSION;
+
+            const str packed_texture_path = textures.value("RoughnessMetalness", default_packed_texture_path);
+            if (packed_texture_path == DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME)
+            {
+                return DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME;
+            }
+
+            // The separate maps can't be sampled as one, so the default is used until the model is cooked
+            if (!fs::exists(packed_texture_path))
+            {
+                LOG_WARNING("Material '{0}' has no packed roughness/metalness texture, cook its model first",
+                            file_path);
+                return DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME;
+            }
+
+            return packed_texture_path;
+        }
     };  // namespace resource
 };      // namespace mag
@@ -0,0 +1,320 @@
+#include "resources/mip_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "core/logger.hpp"
+#include "resources/image.hpp"
+#include "threads/job_system.hpp"
+
+// SSE2 is part of x86-64. AVX2 is not enabled by the build, so the wider path would never be compiled.
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define MAG_MIP_SIMD_ENABLED 1
+#endif
+
+namespace mag
+{
+// Linear values are stored with 14 bits, so the sum of a 2x2 block still fits in 16 bits
+#define MIP_LINEAR_MAX ((1 << 14) - 1)
+
+// Levels with fewer pixels are not split across the job system
+#define MIP_PARALLEL_MIN_PIXELS (256 * 256)
+#define MIP_ROWS_PER_JOB 32
+
+    namespace mip
+    {
+        // Helpers
+        // -------------------------------------------------------------------------------------------------------------
+
+        struct SrgbTables
+        {
+                SrgbTables()
+                {
+                    for (u32 i = 0; i < to_linear.size(); i++)
+                    {
+                        const f32 c = i / 255.0f;
+                        const f32 linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+                        to_linear[i] = static_cast<u16>(std::round(linear * MIP_LINEAR_MAX));
+                    }
+
+                    for (u32 i = 0; i < to_srgb.size(); i++)
+                    {
+                        const f32 c = i / static_cast<f32>(MIP_LINEAR_MAX);
+                        const f32 srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                        to_srgb[i] = static_cast<u8>(std::round(std::clamp(srgb, 0.0f, 1.0f) * 255.0f));
+                    }
+                }
+
+                std::array<u16, 256> to_linear;
+                std::array<u8, MIP_LINEAR_MAX + 1> to_srgb;
+        };
+
+        const SrgbTables& get_srgb_tables()
+        {
+            static const SrgbTables tables;
+            return tables;
+        }
+
+        // Alpha is the last channel of grayscale + alpha and RGBA images
+        b8 is_alpha(const u32 channel, const u32 channels)
+        {
+            return (channels == 2 || channels == 4) && channel == channels - 1;
+        }
+
+        // The color channels of sRGB rows are filtered as linear values
+        void widen_row(const u8* src, u16* dst, const u32 width, const u32 channels)
+        {
+            const auto& to_linear = get_srgb_tables().to_linear;
+
+            for (u64 i = 0; i < static_cast<u64>(width) * channels; i += channels)
+            {
+                for (u32 c = 0; c < channels; c++)
+                {
+                    dst[i + c] = is_alpha(c, channels) ? src[i + c] : to_linear[src[i + c]];
+                }
+            }
+        }
+
+        void narrow_row(const u16* src, u8* dst, const u32 width, const u32 channels)
+        {
+            const auto& to_srgb = get_srgb_tables().to_srgb;
+
+            for (u64 i = 0; i < static_cast<u64>(width) * channels; i += channels)
+            {
+                for (u32 c = 0; c < channels; c++)
+                {
+                    dst[i + c] = is_alpha(c, channels) ? static_cast<u8>(src[i + c]) : to_srgb[src[i + c]];
+                }
+            }
+        }
+
+        // Rounded average of each 2x2 block, starting from 'first_pixel'. Odd dimensions clamp to the last
+        // row/column.
+        template <typename T>
+        void reduce_row(const T* row0, const T* row1, const u32 src_width, T* dst, const u32 first_pixel,
+                        const u32 dst_width, const u32 channels)
+        {
+            for (u32 x = first_pixel; x < dst_width; x++)
+            {
+                const u32 x0 = std::min(x * 2, src_width - 1) * channels;
+                const u32 x1 = std::min(x * 2 + 1, src_width - 1) * channels;
+
+                for (u32 c = 0; c < channels; c++)
+                {
+                    dst[x * channels + c] =
+                        static_cast<T>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+
+#if MAG_MIP_SIMD_ENABLED
+        // Takes the vertical sums of 16 source values and returns the 8 averages. Pairs of neighbouring pixels are
+        // 'Channels' lanes apart.
+        template <u32 Channels>
+        __m128i reduce_block(const __m128i lo, const __m128i hi)
+        {
+            const __m128i rounding = _mm_set1_epi16(2);
+
+            // Add the horizontal neighbour, only the lanes of the even pixels are kept
+            __m128i sum_lo = _mm_add_epi16(lo, _mm_srli_si128(lo, Channels * 2));
+            __m128i sum_hi = _mm_add_epi16(hi, _mm_srli_si128(hi, Channels * 2));
+
+            sum_lo = _mm_srli_epi16(_mm_add_epi16(sum_lo, rounding), 2);
+            sum_hi = _mm_srli_epi16(_mm_add_epi16(sum_hi, rounding), 2);
+
+            if constexpr (Channels == 4)
+            {
+                return _mm_unpacklo_epi64(sum_lo, sum_hi);
+            }
+
+            else if constexpr (Channels == 2)
+            {
+                return _mm_unpacklo_epi64(_mm_shuffle_epi32(sum_lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                                          _mm_shuffle_epi32(sum_hi, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+
+            else
+            {
+                // Averages are at most 14 bits, so the signed saturation never kicks in
+                const __m128i mask = _mm_set1_epi32(0xffff);
+                return _mm_packs_epi32(_mm_and_si128(sum_lo, mask), _mm_and_si128(sum_hi, mask));
+            }
+        }
+
+        // Both return how many pixels were written, the rest is left to reduce_row
+        template <u32 Channels>
+        u32 reduce_row_simd(const u8* row0, const u8* row1, u8* dst, const u32 dst_width)
+        {
+            const u32 dst_values = dst_width * Channels;
+            const __m128i zero = _mm_setzero_si128();
+
+            u32 i = 0;
+            for (; i + 8 <= dst_values; i += 8)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 2));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 2));
+
+                const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+                const __m128i result = reduce_block<Channels>(lo, hi);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(result, result));
+            }
+
+            return i / Channels;
+        }
+
+        template <u32 Channels>
+        u32 reduce_row_simd(const u16* row0, const u16* row1, u16* dst, const u32 dst_width)
+        {
+            const u32 dst_values = dst_width * Channels;
+
+            u32 i = 0;
+            for (; i + 8 <= dst_values; i += 8)
+            {
+                const __m128i lo = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 2)),
+                                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 2)));
+                const __m128i hi = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + i * 2 + 8)),
+                                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i * 2 + 8)));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), reduce_block<Channels>(lo, hi));
+            }
+
+            return i / Channels;
+        }
+#endif
+
+        // The vectorized path never reads past the source rows: the destination is at most half as wide
+        template <typename T>
+        void reduce(const T* row0, const T* row1, const u32 src_width, T* dst, const u32 dst_width,
+                    const u32 channels, const b8 use_simd)
+        {
+            u32 first_pixel = 0;
+
+#if MAG_MIP_SIMD_ENABLED
+            if (use_simd && src_width > 1)
+            {
+                switch (channels)
+                {
+                    case 1:
+                        first_pixel = reduce_row_simd<1>(row0, row1, dst, dst_width);
+                        break;
+
+                    case 2:
+                        first_pixel = reduce_row_simd<2>(row0, row1, dst, dst_width);
+                        break;
+
+                    case 4:
+                        first_pixel = reduce_row_simd<4>(row0, row1, dst, dst_width);
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+#else
+            (void)use_simd;
+#endif
+
+            reduce_row(row0, row1, src_width, dst, first_pixel, dst_width, channels);
+        }
+
+        // Mip generation
+        // -------------------------------------------------------------------------------------------------------------
+
+        void downsample(const u8* src, const u32 src_width, const u32 src_height, u8* dst, const u32 first_row,
+                        const u32 last_row, const u32 channels, const b8 srgb, const b8 use_simd)
+        {
+            const u32 dst_width = std::max(src_width / 2, 1u);
+            const u64 src_row_size = static_cast<u64>(src_width) * channels;
+            const u64 dst_row_size = static_cast<u64>(dst_width) * channels;
+
+            // Linear values don't fit in 8 bits, sRGB rows are converted first
+            std::vector<u16> rows(srgb ? src_row_size * 2 + dst_row_size : 0);
+            u16* row0 = rows.data();
+            u16* row1 = row0 + src_row_size;
+            u16* sums = row1 + src_row_size;
+
+            for (u32 y = first_row; y < last_row; y++)
+            {
+                const u8* src_row0 = src + std::min(y * 2, src_height - 1) * src_row_size;
+                const u8* src_row1 = src + std::min(y * 2 + 1, src_height - 1) * src_row_size;
+                u8* dst_row = dst + y * dst_row_size;
+
+                if (!srgb)
+                {
+                    reduce(src_row0, src_row1, src_width, dst_row, dst_width, channels, use_simd);
+                    continue;
+                }
+
+                widen_row(src_row0, row0, src_width, channels);
+                widen_row(src_row1, row1, src_width, channels);
+                reduce(row0, row1, src_width, sums, dst_width, channels, use_simd);
+                narrow_row(sums, dst_row, dst_width, channels);
+            }
+        }
+
+        void generate(Image& image, const b8 srgb, JobSystem* job_system, const b8 use_simd)
+        {
+            if (is_block_compressed(image.format))
+            {
+                LOG_ERROR("Can't generate the mips of a block compressed image");
+                return;
+            }
+
+            // Already has the whole chain
+            if (image.pixels.size() >= get_mip_chain_size(image))
+            {
+                return;
+            }
+
+            image.pixels.resize(get_mip_chain_size(image));
+
+            u64 src_offset = 0;
+            u64 dst_offset = get_mip_size(image, 0);
+
+            // Each level is built from the previous one, so only the rows of a level are processed in parallel
+            for (u32 i = 1; i < image.mip_levels; i++)
+            {
+                const u32 src_width = std::max(image.width >> (i - 1), 1u);
+                const u32 src_height = std::max(image.height >> (i - 1), 1u);
+                const u32 dst_width = std::max(image.width >> i, 1u);
+                const u32 dst_height = std::max(image.height >> i, 1u);
+
+                const u8* src = image.pixels.data() + src_offset;
+                u8* dst = image.pixels.data() + dst_offset;
+                const u32 channels = image.channels;
+
+                if (job_system == nullptr || dst_width * dst_height < MIP_PARALLEL_MIN_PIXELS)
+                {
+                    downsample(src, src_width, src_height, dst, 0, dst_height, channels, srgb, use_simd);
+                }
+
+                else
+                {
+                    std::vector<JobExecuteFn> jobs;
+                    for (u32 first_row = 0; first_row < dst_height; first_row += MIP_ROWS_PER_JOB)
+                    {
+                        const u32 last_row = std::min(first_row + MIP_ROWS_PER_JOB, dst_height);
+
+                        jobs.push_back(
+                            [=]
+                            {
+                                downsample(src, src_width, src_height, dst, first_row, last_row, channels, srgb,
+                                           use_simd);
+                                return true;
+                            });
+                    }
+
+                    job_system->execute_and_wait(jobs);
+                }
+
+                src_offset = dst_offset;
+                dst_offset += get_mip_size(image, i);
+            }
+        }
+    };  // namespace mip
+};      // namespace mag
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    class JobSystem;
+
+    struct Image;
+
+    // CPU mip generation for uncompressed images, shared by the texture loader and the cooker. Each mip is a 2x2 box
+    // filter of the previous one (odd dimensions are rounded down, like the GPU blit). Color channels of sRGB images
+    // are filtered in linear space, alpha is always filtered as is.
+    namespace mip
+    {
+        // Fills the mip chain from the base level. The rows of each level are split across the job system (when
+        // provided), so this is safe to call from inside a job. 'use_simd' is only meant for comparisons.
+        void generate(Image& image, const b8 srgb, JobSystem* job_system = nullptr, const b8 use_simd = true);
+
+        // Writes the rows [first_row, last_row) of the next mip level
+        void downsample(const u8* src, const u32 src_width, const u32 src_height, u8* dst, const u32 first_row,
+                        const u32 last_row, const u32 channels, const b8 srgb, const b8 use_simd = true);
+    };  // namespace mip
+};      // namespace mag
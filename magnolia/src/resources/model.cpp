@@ -1,15 +1,28 @@
 #include "resources/model.hpp"
 
 #include "core/application.hpp"
+#include "core/hash.hpp"
+#include "platform/file_system.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/test_model.hpp"
+#include "resources/asset_graph.hpp"
 #include "resources/resource_loader.hpp"
 #include "threads/job_system.hpp"
 
 namespace mag
 {
+    // Loaded by the job and handed to the main thread in the callback
+    struct ModelLoadData
+    {
+            Model model;
+            u64 content_hash = 0;
+            str source_file_path = "";
+    };
+
     ModelManager::ModelManager()
     {
+        statistics.budget = DEFAULT_MODEL_BUDGET;
+
         auto& app = get_application();
         auto& renderer = app.get_renderer();
 
@@ -24,54 +37,201 @@ namespace mag
         renderer.upload_model(models[DEFAULT_MODEL_NAME].get());
     }
 
-    ref<Model> ModelManager::get(const str& name)
+    ref<Model> ModelManager::get(const str& raw_name)
     {
+        // Different paths to the same file (or to a model with the same contents) map to the same model
+        const str name = aliases.resolve(raw_name);
+
         auto it = models.find(name);
         if (it != models.end())
         {
             return it->second;
         }
 
-        auto& app = get_application();
-        auto& job_system = app.get_job_system();
-        auto& renderer = app.get_renderer();
+        auto& renderer = get_application().get_renderer();
 
         // Create a new model
         Model* model = new Model(*models[DEFAULT_MODEL_NAME]);
         models[name] = ref<Model>(model);
+        last_used_frames[model] = frame;
 
         // Send model data to the GPU
         renderer.upload_model(model);
 
-        // Temporary model to load data into
-        Model* transfer_model = new Model(*model);
+        load(name);
+
+        return models[name];
+    }
 
-        // Load in another thread
-        auto execute = [name, transfer_model]
+    void ModelManager::reload(const str& name)
+    {
+        if (!models.contains(name))
         {
+            return;
+        }
+
+        // The other paths with the same contents get their own model from now on
+        aliases.remove(name);
+
+        load(name);
+    }
+
+    void ModelManager::load(const str& name)
+    {
+        auto& app = get_application();
+        auto& job_system = app.get_job_system();
+        auto& renderer = app.get_renderer();
+
+        // Temporary data to load into
+        ModelLoadData* transfer_data = new ModelLoadData{.model = *models[name]};
+
+        // Load in another thread. Native models store the hash of their contents and their source file, they are read
+        // here too so the model file is never parsed on the main thread.
+        auto execute = [name, transfer_data]
+        {
+            resource::read_model_info(name, &transfer_data->content_hash, &transfer_data->source_file_path);
+
             // If the load fails we still have valid data
-            return resource::load(name, transfer_model);
+            return resource::load(name, &transfer_data->model);
         };
 
-        // Callback when finished loading
-        auto load_finished_callback = [&renderer, model, transfer_model](const b8 result)
+        // Callback when finished loading (the pending load keeps the model from being released while loading)
+        Model* model = models[name].get();
+        pending_loads.add(model);
+
+        auto load_finished_callback = [this, &app, &renderer, name, model, transfer_data](const b8 result)
         {
+            pending_loads.remove(model);
+
+            // Replaced in the meantime (i.e. shared with a model with the same contents)
+            auto model_it = models.find(name);
+            if (model_it == models.end() || model_it->second.get() != model)
+            {
+                delete transfer_data;
+                return;
+            }
+
+            const u64 content_hash = transfer_data->content_hash;
+            const str resource_name = content_hash != 0 ? aliases.find_contents(content_hash) : "";
+
+            // Same contents as a model loaded from another file. Share it unless this one is already referenced
+            // outside the manager.
+            if (!resource_name.empty() && !is_referenced(model_it->second))
+            {
+                release(name);
+                aliases.add_alias(name, resource_name);
+            }
+
             // Update the model and renderer model data
-            if (result == true)
+            else if (result == true)
             {
-                *model = *transfer_model;
+                if (content_hash != 0 && resource_name.empty())
+                {
+                    aliases.add_contents(name, content_hash);
+                }
+
+                *model = transfer_data->model;
                 renderer.update_model(model);
+
+                auto& asset_graph = app.get_asset_graph();
+
+                // Source -> native model, so the model is imported and reloaded when the source changes
+                if (!transfer_data->source_file_path.empty())
+                {
+                    asset_graph.add_dependency(
+                        {AssetType::SourceModel, fs::get_normalized_path(transfer_data->source_file_path).string()},
+                        {AssetType::Model, name});
+                }
+
+                // Native model -> materials, so the materials are reloaded when the model is imported again
+                for (const auto& material : model->materials)
+                {
+                    asset_graph.add_dependency({AssetType::Model, name},
+                                               {AssetType::Material, fs::get_normalized_path(material).string()});
+                }
             }
 
-            // We can dispose of the temporary model now
-            delete transfer_model;
+            // We can dispose of the temporary data now
+            delete transfer_data;
         };
 
         Job load_job = Job(execute, load_finished_callback);
         job_system.add_job(load_job);
-
-        return models[name];
     }
 
     ref<Model> ModelManager::get_default() { return models[DEFAULT_MODEL_NAME]; }
+
+    void ModelManager::update()
+    {
+        frame++;
+
+        u64 size = 0;
+        for (const auto& model_p : models)
+        {
+            // Referenced outside the manager (i.e. by a model component)
+            if (is_referenced(model_p.second))
+            {
+                last_used_frames[model_p.second.get()] = frame;
+            }
+
+            size += get_model_size(*model_p.second);
+        }
+
+        if (size > statistics.budget)
+        {
+            for (const auto& name :
+                 get_eviction_candidates(models, last_used_frames, pending_loads, frame, {DEFAULT_MODEL_NAME}))
+            {
+                if (size <= statistics.budget)
+                {
+                    break;
+                }
+
+                size -= get_model_size(*models[name]);
+                release(name);
+
+                statistics.evicted_resources++;
+            }
+        }
+
+        statistics.size = size;
+        statistics.resources = models.size();
+        statistics.deduplicated_resources = aliases.get_aliases().size();
+        statistics.deduplicated_size = get_deduplicated_size(models, aliases, get_model_size);
+    }
+
+    void ModelManager::release(const str& name)
+    {
+        Model* model = models[name].get();
+
+        // The vertex and index buffers are destroyed once the frames in flight are done with them
+        get_application().get_renderer().remove_model(model);
+
+        last_used_frames.erase(model);
+        models.erase(name);
+        aliases.remove(name);
+    }
+
+    void ModelManager::set_budget(const u64 budget) { statistics.budget = budget; }
+
+    const ResourceStatistics& ModelManager::get_statistics() const { return statistics; }
+
+    u64 get_model_size(const Model& model)
+    {
+        return VEC_SIZE_BYTES(model.vertices) + VEC_SIZE_BYTES(model.indices);
+    }
+
+    u64 get_model_hash(const Model& model)
+    {
+        u64 hash = hash_data(model.vertices.data(), VEC_SIZE_BYTES(model.vertices));
+        hash = hash_data(model.indices.data(), VEC_SIZE_BYTES(model.indices), hash);
+        hash = hash_data(model.meshes.data(), VEC_SIZE_BYTES(model.meshes), hash);
+
+        for (const auto& material : model.materials)
+        {
+            hash = hash_data(material.data(), material.size() + 1, hash);
+        }
+
+        return hash;
+    }
 };  // namespace mag
@@ -6,10 +6,12 @@
 #include "core/types.hpp"
 #include "math/types.hpp"
 #include "math/vec.hpp"
+#include "resources/resource_cache.hpp"
 
 namespace mag
 {
 #define DEFAULT_MODEL_NAME "__mag_default_model__"
+#define DEFAULT_MODEL_BUDGET (256ull * 1024 * 1024)
 
     using namespace mag::math;
 
@@ -41,8 +43,20 @@ namespace mag
             std::vector<Vertex> vertices;
             std::vector<u32> indices;
             std::vector<str> materials;
+
+            // Offsets of the model in the renderer geometry arena, set when the model is uploaded. Meshes are
+            // relative to these.
+            u32 base_vertex = 0;
+            u32 base_index = 0;
     };
 
+    // Size of the vertex and index data
+    u64 get_model_size(const Model& model);
+
+    // Hash of the geometry and the materials (the name and file path are not part of the contents)
+    u64 get_model_hash(const Model& model);
+
+    // Models stay cached after they are no longer referenced and are only released when the budget is exceeded
     class ModelManager
     {
         public:
@@ -51,7 +65,25 @@ namespace mag
             ref<Model> get(const str& name);
             ref<Model> get_default();
 
+            // Loads the model again in place, the references to it stay valid (see AssetGraph)
+            void reload(const str& name);
+
+            // Releases the least recently used models over the budget. Called once per frame.
+            void update();
+
+            void set_budget(const u64 budget);
+            const ResourceStatistics& get_statistics() const;
+
         private:
+            void load(const str& name);
+            void release(const str& name);
+
             std::map<str, ref<Model>> models;
+            std::map<Model*, u64> last_used_frames;
+            PendingLoads<Model> pending_loads;
+            ResourceAliases aliases;
+
+            ResourceStatistics statistics;
+            u64 frame = 0;
     };
 };  // namespace mag
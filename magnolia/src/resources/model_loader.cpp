@@ -81,5 +81,19 @@ namespace mag
             LOG_SUCCESS("Loaded model: {0}", file_path);
             return true;
         }
+
+        b8 read_model_info(const str& file_path, u64* hash, str* source_file_path)
+        {
+            json data;
+            if (!fs::read_json_data(file_path, data))
+            {
+                return false;
+            }
+
+            *hash = data.value("Hash", static_cast<u64>(0));
+            *source_file_path = data.value("Source", "");
+
+            return true;
+        }
     };  // namespace resource
 };      // namespace mag
@@ -0,0 +1,46 @@
+#include "resources/resource_cache.hpp"
+
+#include "platform/file_system.hpp"
+
+namespace mag
+{
+    str ResourceAliases::resolve(const str& file_path)
+    {
+        auto path_it = normalized_paths.find(file_path);
+        if (path_it == normalized_paths.end())
+        {
+            path_it = normalized_paths.emplace(file_path, fs::get_normalized_path(file_path).string()).first;
+        }
+
+        auto it = aliases.find(path_it->second);
+        return it != aliases.end() ? it->second : path_it->second;
+    }
+
+    str ResourceAliases::find_contents(const u64 hash) const
+    {
+        auto it = resource_names.find(hash);
+        return it != resource_names.end() ? it->second : "";
+    }
+
+    void ResourceAliases::add_contents(const str& name, const u64 hash)
+    {
+        resource_names[hash] = name;
+        resource_hashes[name] = hash;
+    }
+
+    void ResourceAliases::add_alias(const str& name, const str& resource_name) { aliases[name] = resource_name; }
+
+    void ResourceAliases::remove(const str& name)
+    {
+        auto it = resource_hashes.find(name);
+        if (it != resource_hashes.end())
+        {
+            resource_names.erase(it->second);
+            resource_hashes.erase(it);
+        }
+
+        std::erase_if(aliases, [&name](const auto& alias_p) { return alias_p.second == name; });
+    }
+
+    const std::map<str, str>& ResourceAliases::get_aliases() const { return aliases; }
+};  // namespace mag
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "core/types.hpp"
+
+namespace mag
+{
+// Resources not used for this many frames may be evicted
+#define RESOURCE_EVICTION_FRAMES 120
+
+    // The managers keep the resources cached after they stop being referenced. When the memory used by a manager
+    // exceeds its budget, the least recently used resources only referenced by the manager are released.
+    struct ResourceStatistics
+    {
+            u64 budget = 0;
+            u64 size = 0;  // The CPU and GPU copies of a resource have the same size
+            u32 resources = 0;
+            u32 evicted_resources = 0;  // Since startup
+
+            // Names that share the copy of a resource with the same contents and the size they would take otherwise
+            u32 deduplicated_resources = 0;
+            u64 deduplicated_size = 0;
+    };
+
+    // Identical contents reached through different names (i.e. the same material written by two imports) are only
+    // loaded once. The other names become aliases of the resource that registered the contents first.
+    class ResourceAliases
+    {
+        public:
+            // Name of the resource that holds the contents of the file. Resources are named after the normalized file
+            // path (see fs::get_normalized_path), which is cached since resources are looked up every frame.
+            str resolve(const str& file_path);
+
+            // Name of the resource with the same contents, empty if there is none
+            str find_contents(const u64 hash) const;
+
+            void add_contents(const str& name, const u64 hash);
+            void add_alias(const str& name, const str& resource_name);
+
+            // Called when a resource is released, its aliases are removed as well
+            void remove(const str& name);
+
+            // Alias -> resource name
+            const std::map<str, str>& get_aliases() const;
+
+        private:
+            std::map<str, str> normalized_paths;
+            std::map<str, str> aliases;
+            std::map<u64, str> resource_names;
+            std::map<str, u64> resource_hashes;
+    };
+
+    // Resources with loads in flight. Load jobs only keep a pointer to their resource, which is not evicted until the
+    // loads finish.
+    template <typename T>
+    class PendingLoads
+    {
+        public:
+            void add(const T* resource) { loads[resource]++; }
+
+            void remove(const T* resource)
+            {
+                auto it = loads.find(resource);
+                if (it != loads.end() && --it->second == 0)
+                {
+                    loads.erase(it);
+                }
+            }
+
+            b8 contains(const T* resource) const { return loads.contains(resource); }
+
+        private:
+            std::map<const T*, u32> loads;
+    };
+
+    // The resource handles are the refs. The managers only hold them in their maps and the load jobs don't hold them
+    // at all, so any other reference comes from a user of the resource.
+    template <typename T>
+    b8 is_referenced(const ref<T>& resource)
+    {
+        return resource.use_count() > 1;
+    }
+
+    // Names of the resources that can be evicted, least recently used first
+    template <typename T>
+    std::vector<str> get_eviction_candidates(const std::map<str, ref<T>>& resources,
+                                             const std::map<T*, u64>& last_used_frames,
+                                             const PendingLoads<T>& pending_loads, const u64 frame,
+                                             const std::vector<str>& pinned_names)
+    {
+        std::vector<std::pair<u64, str>> candidates;
+        for (const auto& resource_p : resources)
+        {
+            if (is_referenced(resource_p.second) || pending_loads.contains(resource_p.second.get()) ||
+                std::find(pinned_names.begin(), pinned_names.end(), resource_p.first) != pinned_names.end())
+            {
+                continue;
+            }
+
+            auto it = last_used_frames.find(resource_p.second.get());
+            const u64 last_used_frame = it != last_used_frames.end() ? it->second : 0;
+
+            if (frame - last_used_frame > RESOURCE_EVICTION_FRAMES)
+            {
+                candidates.push_back({last_used_frame, resource_p.first});
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<str> names;
+        for (const auto& candidate : candidates)
+        {
+            names.push_back(candidate.second);
+        }
+
+        return names;
+    }
+
+    // Size the aliases would take if they had their own copy of the resources
+    template <typename T, typename SizeFn>
+    u64 get_deduplicated_size(const std::map<str, ref<T>>& resources, const ResourceAliases& aliases,
+                              SizeFn get_size)
+    {
+        u64 size = 0;
+        for (const auto& alias_p : aliases.get_aliases())
+        {
+            auto it = resources.find(alias_p.second);
+            if (it != resources.end())
+            {
+                size += get_size(*it->second);
+            }
+        }
+
+        return size;
+    }
+};  // namespace mag
@@ -10,6 +10,9 @@ namespace mag
     struct ShaderConfiguration;
     struct ShaderModule;
 
+    enum class TextureFormat;
+    enum class ColorSpace;
+
     namespace resource
     {
         b8 load(const str& file_path, Image* image);
@@ -17,7 +20,31 @@ namespace mag
         b8 load(const str& file_path, Model* model);
         b8 load(const str& file_path, ShaderConfiguration* shader);
 
-        b8 get_image_info(const str& file_path, u32* width, u32* height, u32* channels, u32* mip_levels);
+        // Only load the mips starting from 'first_mip_level' of a native texture. The image has the dimensions of
+        // that mip.
+        b8 load_mips(const str& file_path, Image* image, const u32 first_mip_level);
+
+        // Write an image (with all its mips) to the native texture format
+        b8 save(const str& file_path, const Image* image);
+
+        // Hash of the contents stored in native textures (see get_image_hash), without loading the whole file
+        b8 read_texture_hash(const str& file_path, u64* hash);
+
+        // Hash of the contents (see get_model_hash) and the file a native model was imported from, without loading
+        // the geometry. Both are empty for models imported before they were stored.
+        b8 read_model_info(const str& file_path, u64* hash, str* source_file_path);
+
+        // Compiles a GLSL stage to SPIR-V with the shader compiler shipped in 'ext'
+        b8 compile_shader_module(const str& source_file_path, const str& output_file_path,
+                                 const str& include_directory);
+
+        // Only native textures store their color space, it is left unchanged for source images
+        b8 get_image_info(const str& file_path, u32* width, u32* height, u32* channels, u32* mip_levels,
+                          TextureFormat* format, ColorSpace* color_space = nullptr);
         b8 is_image_extension_supported(const str& extension_with_dot);
+
+        // Where the cooked version of a texture is stored. The source extension is kept (i.e. 'foo.png.tex.bin') so
+        // sources that only differ in their extension don't share the cooked texture.
+        str get_native_texture_path(const str& file_path);
     };  // namespace resource
 };      // namespace mag
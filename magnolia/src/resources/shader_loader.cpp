@@ -47,21 +47,7 @@ namespace mag
 
             const str shader_name = data["Shader"];
 
-            // @TODO: cleanup
-            str shader_folder = "shaders/";
-            {
-                // Shaders
-                const std::filesystem::path cwd = std::filesystem::current_path();
-                const str last_folder = cwd.filename().string();
-                str system = "linux";
-
-// @TODO: clean this up (maybe use a filesystem class)
-#if MAG_PLATFORM_WINDOWS
-                system = "windows";
-#endif
-                if (last_folder == "Magnolia") shader_folder = "build/" + system + "/" + shader_folder;
-            }
-            // @TODO: cleanup
+            const str shader_folder = fs::get_output_directory() + "shaders/";
 
             b8 contains_vertex_stage = false;
             b8 contains_fragment_stage = false;
@@ -149,10 +135,27 @@ namespace mag
             SpvReflectResult result = spvReflectCreateShaderModule(buffer.get_size(), buffer.cast<u32>(), spv_module);
             VK_CHECK(VK_CAST(result));
 
+            shader_module->file_path = file_path;
             shader_module->module = module;
             shader_module->spv_module = spv_module;
 
             return true;
         }
+
+        b8 compile_shader_module(const str& source_file_path, const str& output_file_path,
+                                 const str& include_directory)
+        {
+            // No optimizations, the reflection data is still needed (see build.py). The paths are quoted in case they
+            // contain spaces.
+            const str command = "\"" + fs::get_tool_path("glslc") + "\" -I\"" + include_directory + "\" \"" +
+                                source_file_path + "\" -o \"" + output_file_path + "\"";
+            if (system(command.c_str()) != 0)
+            {
+                LOG_ERROR("Failed to compile shader module: '{0}'", source_file_path);
+                return false;
+            }
+
+            return true;
+        }
     };  // namespace resource
 };      // namespace mag
@@ -15,7 +15,9 @@
 namespace mag
 {
     Scene::Scene()
-        : name("Untitled"), ecs(new ECS(10'000, BIND_FN2(Scene::on_component_added))), physics_world(new PhysicsWorld())
+        : name("Untitled"),
+          ecs(new ECS(SCENE_MAX_ENTITY_ID, BIND_FN2(Scene::on_component_added))),
+          physics_world(new PhysicsWorld())
     {
     }
 
@@ -6,6 +6,8 @@
 
 namespace mag
 {
+#define SCENE_MAX_ENTITY_ID 1'000'000
+
     class ECS;
     class Camera;
     class PhysicsWorld;
@@ -1,12 +1,17 @@
 #include "scene/scene_serializer.hpp"
 
+#include <cstring>
+
 #include "core/application.hpp"
+#include "core/buffer.hpp"
 #include "ecs/components.hpp"
 #include "ecs/ecs.hpp"
 #include "platform/file_system.hpp"
 #include "renderer/test_model.hpp"
 #include "resources/image.hpp"
+#include "resources/model.hpp"
 #include "scene/scene.hpp"
+#include "threads/job_system.hpp"
 
 namespace mag
 {
@@ -22,9 +27,211 @@ namespace mag
         return out;
     }
 
+#define SCENE_FILE_MAGIC 0x4e43534d  // "MSCN"
+#define SCENE_FILE_VERSION 1
+
+    // Sections are read in this order, so components that depend on others come last (i.e. rigid bodies are added to
+    // the physics world when the entity has a transform and a collider)
+    enum class SceneSection : u32
+    {
+        Transform = 0,
+        Model,
+        Sprite,
+        BoxCollider,
+        RigidBody,
+        Light,
+        Camera,
+        Script
+    };
+
+    // Header, scene name, entity names and then the sections
+    struct SceneFileHeader
+    {
+            u32 magic;
+            u32 version;
+            u32 entity_count;
+            u32 section_count;
+    };
+
+    // Followed by the indices of the entities that have the component and then one column per component member
+    struct SceneSectionHeader
+    {
+            u32 section;
+            u32 count;
+            u64 size;  // Bytes after the header, unknown sections are skipped
+    };
+
+    class SceneWriter
+    {
+        public:
+            template <typename T>
+            void write(const T& value)
+            {
+                write_bytes(&value, sizeof(T));
+            }
+
+            template <typename T>
+            void write_column(const std::vector<T>& column)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Columns must be trivially copyable");
+                write_bytes(column.data(), VEC_SIZE_BYTES(column));
+            }
+
+            void write_string(const str& string)
+            {
+                write(static_cast<u32>(string.size()));
+                write_bytes(string.data(), string.size());
+            }
+
+            // Repeated strings (i.e. model paths) are stored once, followed by the index of the string of each element
+            void write_string_column(const std::vector<str>& column)
+            {
+                std::map<str, u32> string_indices;
+                std::vector<str> strings;
+                std::vector<u32> indices;
+                indices.reserve(column.size());
+
+                for (const auto& string : column)
+                {
+                    auto [it, inserted] = string_indices.try_emplace(string, strings.size());
+                    if (inserted)
+                    {
+                        strings.push_back(string);
+                    }
+
+                    indices.push_back(it->second);
+                }
+
+                write(static_cast<u32>(strings.size()));
+                for (const auto& string : strings)
+                {
+                    write_string(string);
+                }
+
+                write_column(indices);
+            }
+
+            void begin_section(const SceneSection section, const std::vector<u32>& entities)
+            {
+                section_offset = buffer.get_size();
+
+                const SceneSectionHeader header = {static_cast<u32>(section), static_cast<u32>(entities.size()), 0};
+                write(header);
+                write_column(entities);
+
+                section_count++;
+            }
+
+            void end_section()
+            {
+                SceneSectionHeader* header = reinterpret_cast<SceneSectionHeader*>(buffer.data.data() + section_offset);
+                header->size = buffer.get_size() - section_offset - sizeof(SceneSectionHeader);
+            }
+
+            u32 get_section_count() const { return section_count; }
+
+            Buffer buffer;
+
+        private:
+            void write_bytes(const void* data, const u64 size)
+            {
+                const u8* bytes = static_cast<const u8*>(data);
+                buffer.data.insert(buffer.data.end(), bytes, bytes + size);
+            }
+
+            u64 section_offset = 0;
+            u32 section_count = 0;
+    };
+
+    class SceneReader
+    {
+        public:
+            SceneReader(const Buffer& buffer) : buffer(buffer) {}
+
+            template <typename T>
+            b8 read(T& value)
+            {
+                return read_bytes(&value, sizeof(T));
+            }
+
+            template <typename T>
+            b8 read_column(std::vector<T>& column, const u64 count)
+            {
+                if (count > (buffer.get_size() - offset) / sizeof(T))
+                {
+                    return false;
+                }
+
+                column.resize(count);
+                return read_bytes(column.data(), count * sizeof(T));
+            }
+
+            b8 read_string(str& string)
+            {
+                u32 size = 0;
+                if (!read(size) || size > buffer.get_size() - offset)
+                {
+                    return false;
+                }
+
+                string.assign(reinterpret_cast<const c8*>(buffer.data.data() + offset), size);
+                offset += size;
+
+                return true;
+            }
+
+            // See SceneWriter::write_string_column
+            b8 read_string_column(std::vector<str>& strings, std::vector<u32>& indices, const u64 count)
+            {
+                u32 string_count = 0;
+                if (!read(string_count))
+                {
+                    return false;
+                }
+
+                strings.resize(string_count);
+                for (auto& string : strings)
+                {
+                    if (!read_string(string))
+                    {
+                        return false;
+                    }
+                }
+
+                if (!read_column(indices, count))
+                {
+                    return false;
+                }
+
+                return std::all_of(indices.begin(), indices.end(),
+                                   [string_count](const u32 i) { return i < string_count; });
+            }
+
+            u64 get_offset() const { return offset; }
+            u64 get_size() const { return buffer.get_size(); }
+            void set_offset(const u64 new_offset) { offset = new_offset; }
+
+        private:
+            b8 read_bytes(void* data, const u64 size)
+            {
+                if (size > buffer.get_size() - offset)
+                {
+                    return false;
+                }
+
+                memcpy(data, buffer.data.data() + offset, size);
+                offset += size;
+
+                return true;
+            }
+
+            const Buffer& buffer;
+            u64 offset = 0;
+    };
+
     namespace scene
     {
-        b8 save(const str& file_path, Scene& scene)
+        static b8 save_json(const str& file_path, Scene& scene)
         {
             // Serialize scene data to file
             json data;
@@ -118,10 +325,18 @@ namespace mag
             return true;
         }
 
-        b8 load(const str& file_path, Scene& scene)
+        // The staging ECS may be filled in another thread, so the resources are only looked up when the entities are
+        // merged into the scene (see merge_entity). Until then the models only have their file path.
+        static ref<Model> create_staging_model(const str& file_path)
         {
-            auto& app = get_application();
+            auto model = create_ref<Model>();
+            model->file_path = file_path;
+
+            return model;
+        }
 
+        static b8 read_json(const str& file_path, str& scene_name, ECS& ecs)
+        {
             json data;
 
             if (!fs::read_json_data(file_path, data))
@@ -130,8 +345,7 @@ namespace mag
                 return false;
             }
 
-            const str scene_name = data["Name"];
-            scene.set_name(scene_name);
+            scene_name = data["Name"];
 
             LOG_INFO("Deserializing scene '{0}'", scene_name);
 
@@ -140,8 +354,6 @@ namespace mag
                 return true;
             }
 
-            auto& ecs = scene.get_ecs();
-
             for (auto& entity : data["Entities"])
             {
                 const u32 entity_id = ecs.create_entity();
@@ -176,9 +388,7 @@ namespace mag
                     const auto& component = entity["ModelComponent"];
                     const str file_path = component["FilePath"];
 
-                    const auto& model = app.get_model_manager().get(file_path);
-
-                    ecs.add_component(entity_id, new ModelComponent(model));
+                    ecs.add_component(entity_id, new ModelComponent(create_staging_model(file_path)));
                 }
 
                 if (entity.contains("SpriteComponent"))
@@ -188,10 +398,8 @@ namespace mag
                     const b8 constant_size = component["ConstantSize"].get<b8>();
                     const b8 always_face_camera = component["AlwaysFaceCamera"].get<b8>();
 
-                    const auto& sprite = app.get_texture_manager().get(file_path);
-
                     ecs.add_component(entity_id,
-                                      new SpriteComponent(sprite, file_path, constant_size, always_face_camera));
+                                      new SpriteComponent(nullptr, file_path, constant_size, always_face_camera));
                 }
 
                 if (entity.contains("BoxColliderComponent"))
@@ -253,5 +461,621 @@ namespace mag
 
             return true;
         }
+
+        static b8 save_binary(const str& file_path, Scene& scene)
+        {
+            auto& ecs = scene.get_ecs();
+
+            // Entities are stored by their index in the file, the ids are given again when the scene is loaded
+            const std::vector<u32> entity_ids = ecs.get_entities_ids();
+
+            auto get_indices = [&entity_ids](const std::vector<u32>& ids)
+            {
+                std::vector<u32> indices;
+                indices.reserve(ids.size());
+
+                for (const auto id : ids)
+                {
+                    const auto it = std::lower_bound(entity_ids.begin(), entity_ids.end(), id);
+                    indices.push_back(static_cast<u32>(it - entity_ids.begin()));
+                }
+
+                return indices;
+            };
+
+            SceneWriter writer;
+            writer.write(SceneFileHeader{SCENE_FILE_MAGIC, SCENE_FILE_VERSION, static_cast<u32>(entity_ids.size()), 0});
+            writer.write_string(scene.get_name());
+
+            std::vector<str> names;
+            names.reserve(entity_ids.size());
+
+            for (const auto entity_id : entity_ids)
+            {
+                auto component = ecs.get_component<NameComponent>(entity_id);
+                names.push_back(component ? component->name : "");
+            }
+
+            writer.write_string_column(names);
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<TransformComponent>();
+
+                std::vector<vec3> translations, rotations, scales;
+                for (const auto id : ids)
+                {
+                    auto component = ecs.get_component<TransformComponent>(id);
+                    translations.push_back(component->translation);
+                    rotations.push_back(component->rotation);
+                    scales.push_back(component->scale);
+                }
+
+                writer.begin_section(SceneSection::Transform, get_indices(ids));
+                writer.write_column(translations);
+                writer.write_column(rotations);
+                writer.write_column(scales);
+                writer.end_section();
+            }
+
+            {
+                std::vector<u32> ids;
+                std::vector<str> file_paths;
+                for (const auto id : ecs.get_entities_with_components_of_type<ModelComponent>())
+                {
+                    auto component = ecs.get_component<ModelComponent>(id);
+                    if (component->model->file_path.empty())
+                    {
+                        LOG_WARNING("Model {0} has no file path and will not be serialized", component->model->name);
+                        continue;
+                    }
+
+                    ids.push_back(id);
+                    file_paths.push_back(component->model->file_path);
+                }
+
+                writer.begin_section(SceneSection::Model, get_indices(ids));
+                writer.write_string_column(file_paths);
+                writer.end_section();
+            }
+
+            {
+                std::vector<u32> ids;
+                std::vector<str> file_paths;
+                std::vector<u8> constant_sizes, always_face_cameras;
+                for (const auto id : ecs.get_entities_with_components_of_type<SpriteComponent>())
+                {
+                    auto component = ecs.get_component<SpriteComponent>(id);
+                    if (component->texture_file_path.empty())
+                    {
+                        LOG_WARNING("Sprite has no file path and will not be serialized");
+                        continue;
+                    }
+
+                    ids.push_back(id);
+                    file_paths.push_back(component->texture_file_path);
+                    constant_sizes.push_back(component->constant_size);
+                    always_face_cameras.push_back(component->always_face_camera);
+                }
+
+                writer.begin_section(SceneSection::Sprite, get_indices(ids));
+                writer.write_string_column(file_paths);
+                writer.write_column(constant_sizes);
+                writer.write_column(always_face_cameras);
+                writer.end_section();
+            }
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<BoxColliderComponent>();
+
+                std::vector<vec3> dimensions;
+                for (const auto id : ids)
+                {
+                    dimensions.push_back(ecs.get_component<BoxColliderComponent>(id)->dimensions);
+                }
+
+                writer.begin_section(SceneSection::BoxCollider, get_indices(ids));
+                writer.write_column(dimensions);
+                writer.end_section();
+            }
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<RigidBodyComponent>();
+
+                std::vector<f32> masses;
+                for (const auto id : ids)
+                {
+                    masses.push_back(ecs.get_component<RigidBodyComponent>(id)->mass);
+                }
+
+                writer.begin_section(SceneSection::RigidBody, get_indices(ids));
+                writer.write_column(masses);
+                writer.end_section();
+            }
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<LightComponent>();
+
+                std::vector<vec3> colors;
+                std::vector<f32> intensities;
+                for (const auto id : ids)
+                {
+                    auto component = ecs.get_component<LightComponent>(id);
+                    colors.push_back(component->color);
+                    intensities.push_back(component->intensity);
+                }
+
+                writer.begin_section(SceneSection::Light, get_indices(ids));
+                writer.write_column(colors);
+                writer.write_column(intensities);
+                writer.end_section();
+            }
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<CameraComponent>();
+
+                std::vector<f32> fovs, nears, fars, aspect_ratios;
+                for (const auto id : ids)
+                {
+                    const auto& camera = ecs.get_component<CameraComponent>(id)->camera;
+                    fovs.push_back(camera.get_fov());
+                    nears.push_back(camera.get_near());
+                    fars.push_back(camera.get_far());
+                    aspect_ratios.push_back(camera.get_aspect_ratio());
+                }
+
+                writer.begin_section(SceneSection::Camera, get_indices(ids));
+                writer.write_column(fovs);
+                writer.write_column(nears);
+                writer.write_column(fars);
+                writer.write_column(aspect_ratios);
+                writer.end_section();
+            }
+
+            {
+                const auto ids = ecs.get_entities_with_components_of_type<ScriptComponent>();
+
+                std::vector<str> file_paths;
+                for (const auto id : ids)
+                {
+                    file_paths.push_back(ecs.get_component<ScriptComponent>(id)->file_path);
+                }
+
+                writer.begin_section(SceneSection::Script, get_indices(ids));
+                writer.write_string_column(file_paths);
+                writer.end_section();
+            }
+
+            reinterpret_cast<SceneFileHeader*>(writer.buffer.data.data())->section_count = writer.get_section_count();
+
+            if (!fs::write_binary_data(file_path, writer.buffer))
+            {
+                LOG_ERROR("Failed to save scene to file: '{0}'", file_path);
+                return false;
+            }
+
+            return true;
+        }
+
+        static b8 read_section(SceneReader& reader, const SceneSectionHeader& section,
+                               const std::vector<u32>& entity_ids, ECS& ecs)
+        {
+            std::vector<u32> entities;
+            if (!reader.read_column(entities, section.count) ||
+                !std::all_of(entities.begin(), entities.end(), [&](const u32 i) { return i < entity_ids.size(); }))
+            {
+                return false;
+            }
+
+            switch (static_cast<SceneSection>(section.section))
+            {
+                case SceneSection::Transform:
+                {
+                    std::vector<vec3> translations, rotations, scales;
+                    if (!reader.read_column(translations, section.count) ||
+                        !reader.read_column(rotations, section.count) || !reader.read_column(scales, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]],
+                                          new TransformComponent(translations[i], rotations[i], scales[i]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::Model:
+                {
+                    std::vector<str> file_paths;
+                    std::vector<u32> indices;
+                    if (!reader.read_string_column(file_paths, indices, section.count))
+                    {
+                        return false;
+                    }
+
+                    std::vector<ref<Model>> models;
+                    for (const auto& file_path : file_paths)
+                    {
+                        models.push_back(create_staging_model(file_path));
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]], new ModelComponent(models[indices[i]]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::Sprite:
+                {
+                    std::vector<str> file_paths;
+                    std::vector<u32> indices;
+                    std::vector<u8> constant_sizes, always_face_cameras;
+                    if (!reader.read_string_column(file_paths, indices, section.count) ||
+                        !reader.read_column(constant_sizes, section.count) ||
+                        !reader.read_column(always_face_cameras, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]],
+                                          new SpriteComponent(nullptr, file_paths[indices[i]], constant_sizes[i],
+                                                              always_face_cameras[i]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::BoxCollider:
+                {
+                    std::vector<vec3> dimensions;
+                    if (!reader.read_column(dimensions, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]], new BoxColliderComponent(dimensions[i]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::RigidBody:
+                {
+                    std::vector<f32> masses;
+                    if (!reader.read_column(masses, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]], new RigidBodyComponent(masses[i]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::Light:
+                {
+                    std::vector<vec3> colors;
+                    std::vector<f32> intensities;
+                    if (!reader.read_column(colors, section.count) || !reader.read_column(intensities, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]], new LightComponent(colors[i], intensities[i]));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::Camera:
+                {
+                    std::vector<f32> fovs, nears, fars, aspect_ratios;
+                    if (!reader.read_column(fovs, section.count) || !reader.read_column(nears, section.count) ||
+                        !reader.read_column(fars, section.count) || !reader.read_column(aspect_ratios, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        const Camera camera = Camera(vec3(0), vec3(0), fovs[i], aspect_ratios[i], nears[i], fars[i]);
+                        ecs.add_component(entity_ids[entities[i]], new CameraComponent(camera));
+                    }
+
+                    break;
+                }
+
+                case SceneSection::Script:
+                {
+                    std::vector<str> file_paths;
+                    std::vector<u32> indices;
+                    if (!reader.read_string_column(file_paths, indices, section.count))
+                    {
+                        return false;
+                    }
+
+                    for (u32 i = 0; i < section.count; i++)
+                    {
+                        ecs.add_component(entity_ids[entities[i]], new ScriptComponent(file_paths[indices[i]]));
+                    }
+
+                    break;
+                }
+
+                default:
+                    LOG_WARNING("Unknown scene section {0} will be skipped", section.section);
+                    break;
+            }
+
+            return true;
+        }
+
+        static b8 read_binary(const str& file_path, str& scene_name, ECS& ecs)
+        {
+            Buffer buffer;
+            if (!fs::read_binary_data(file_path, buffer))
+            {
+                LOG_ERROR("Failed to deserialize scene: '{0}'", file_path);
+                return false;
+            }
+
+            SceneReader reader(buffer);
+
+            SceneFileHeader header;
+            if (!reader.read(header) || header.magic != SCENE_FILE_MAGIC || header.version != SCENE_FILE_VERSION ||
+                !reader.read_string(scene_name))
+            {
+                LOG_ERROR("Invalid scene file: '{0}'", file_path);
+                return false;
+            }
+
+            LOG_INFO("Deserializing scene '{0}'", scene_name);
+
+            std::vector<str> names;
+            std::vector<u32> name_indices;
+            if (!reader.read_string_column(names, name_indices, header.entity_count))
+            {
+                LOG_ERROR("Invalid scene file: '{0}'", file_path);
+                return false;
+            }
+
+            std::vector<u32> entity_ids;
+            entity_ids.reserve(header.entity_count);
+
+            for (const auto name_index : name_indices)
+            {
+                entity_ids.push_back(ecs.create_entity(names[name_index]));
+            }
+
+            for (u32 i = 0; i < header.section_count; i++)
+            {
+                SceneSectionHeader section;
+                if (!reader.read(section) || section.size > reader.get_size() - reader.get_offset())
+                {
+                    LOG_ERROR("Invalid scene file: '{0}'", file_path);
+                    return false;
+                }
+
+                const u64 section_end = reader.get_offset() + section.size;
+
+                if (!read_section(reader, section, entity_ids, ecs) || reader.get_offset() > section_end)
+                {
+                    LOG_ERROR("Invalid section {0} in scene file: '{1}'", section.section, file_path);
+                    return false;
+                }
+
+                reader.set_offset(section_end);
+            }
+
+            return true;
+        }
+
+        b8 save(const str& file_path, Scene& scene)
+        {
+            if (file_path.ends_with(SCENE_FILE_EXTENSION))
+            {
+                return save_binary(file_path, scene);
+            }
+
+            return save_json(file_path, scene);
+        }
+
+        static b8 read(const str& file_path, str& scene_name, ECS& ecs)
+        {
+            if (file_path.ends_with(SCENE_FILE_EXTENSION))
+            {
+                return read_binary(file_path, scene_name, ecs);
+            }
+
+            return read_json(file_path, scene_name, ecs);
+        }
+
+        template <typename T>
+        static void merge_component(ECS& staging_ecs, const u32 staging_id, ECS& ecs, const u32 entity_id)
+        {
+            if (auto component = staging_ecs.get_component<T>(staging_id))
+            {
+                ecs.add_component(entity_id, static_cast<T*>(component->clone()));
+            }
+        }
+
+        // Same order as the sections of the binary format
+        static void merge_entity(ECS& staging_ecs, const u32 staging_id, ECS& ecs)
+        {
+            auto& app = get_application();
+
+            const u32 entity_id = ecs.create_entity(staging_ecs.get_component<NameComponent>(staging_id)->name);
+
+            merge_component<TransformComponent>(staging_ecs, staging_id, ecs, entity_id);
+
+            if (auto component = staging_ecs.get_component<ModelComponent>(staging_id))
+            {
+                const auto& model = app.get_model_manager().get(component->model->file_path);
+                ecs.add_component(entity_id, new ModelComponent(model));
+            }
+
+            if (auto component = staging_ecs.get_component<SpriteComponent>(staging_id))
+            {
+                const auto& sprite = app.get_texture_manager().get(component->texture_file_path);
+                ecs.add_component(entity_id, new SpriteComponent(sprite, component->texture_file_path,
+                                                                 component->constant_size,
+                                                                 component->always_face_camera));
+            }
+
+            merge_component<BoxColliderComponent>(staging_ecs, staging_id, ecs, entity_id);
+            merge_component<RigidBodyComponent>(staging_ecs, staging_id, ecs, entity_id);
+            merge_component<LightComponent>(staging_ecs, staging_id, ecs, entity_id);
+            merge_component<CameraComponent>(staging_ecs, staging_id, ecs, entity_id);
+            merge_component<ScriptComponent>(staging_ecs, staging_id, ecs, entity_id);
+        }
+
+        b8 load(const str& file_path, Scene& scene)
+        {
+            ECS staging_ecs(SCENE_MAX_ENTITY_ID);
+            str scene_name = "";
+
+            if (!read(file_path, scene_name, staging_ecs))
+            {
+                return false;
+            }
+
+            scene.set_name(scene_name);
+
+            for (const auto staging_id : staging_ecs.get_entities_ids())
+            {
+                merge_entity(staging_ecs, staging_id, scene.get_ecs());
+            }
+
+            return true;
+        }
     };  // namespace scene
-};      // namespace mag
+
+    // Shared with the job that reads the file, which may finish after the loader is destroyed
+    struct SceneStagingData
+    {
+            SceneStagingData() : ecs(SCENE_MAX_ENTITY_ID) {}
+
+            ECS ecs;
+            str scene_name = "";
+            b8 result = false;
+            b8 finished = false;
+    };
+
+    struct SceneLoader::IMPL
+    {
+            str file_path;
+            ref<Scene> scene;
+            ref<SceneStagingData> staging;
+
+            std::vector<u32> staging_ids;
+            u32 merged_entities = 0;
+            SceneLoadState state = SceneLoadState::Reading;
+    };
+
+    SceneLoader::SceneLoader(const str& file_path, const ref<Scene>& scene) : impl(new SceneLoader::IMPL())
+    {
+        impl->file_path = file_path;
+        impl->scene = scene;
+        impl->staging = create_ref<SceneStagingData>();
+
+        auto execute = [file_path, staging = impl->staging]
+        { return scene::read(file_path, staging->scene_name, staging->ecs); };
+
+        auto on_execute_finished = [staging = impl->staging](const b8 result)
+        {
+            staging->result = result;
+            staging->finished = true;
+        };
+
+        Job read_job = Job(execute, on_execute_finished);
+        get_application().get_job_system().add_job(read_job);
+    }
+
+    SceneLoader::~SceneLoader() = default;
+
+    void SceneLoader::update(const f64 time_budget)
+    {
+        if (impl->state == SceneLoadState::Reading)
+        {
+            if (!impl->staging->finished)
+            {
+                return;
+            }
+
+            if (!impl->staging->result)
+            {
+                LOG_ERROR("Failed to load scene: '{0}'", impl->file_path);
+                impl->state = SceneLoadState::Failed;
+                impl->staging.reset();
+                return;
+            }
+
+            impl->scene->set_name(impl->staging->scene_name);
+            impl->staging_ids = impl->staging->ecs.get_entities_ids();
+            impl->state = SceneLoadState::Merging;
+        }
+
+        if (impl->state != SceneLoadState::Merging)
+        {
+            return;
+        }
+
+        auto& ecs = impl->scene->get_ecs();
+        const auto start = std::chrono::steady_clock::now();
+
+        // At least one entity is merged every frame, so the load always finishes
+        while (impl->merged_entities < impl->staging_ids.size())
+        {
+            scene::merge_entity(impl->staging->ecs, impl->staging_ids[impl->merged_entities++], ecs);
+
+            const std::chrono::duration<f64, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= time_budget)
+            {
+                break;
+            }
+        }
+
+        if (impl->merged_entities == impl->staging_ids.size())
+        {
+            LOG_SUCCESS("Loaded scene '{0}' ({1} entities)", impl->scene->get_name(), impl->merged_entities);
+
+            impl->state = SceneLoadState::Finished;
+            impl->staging.reset();
+            impl->staging_ids.clear();
+        }
+    }
+
+    SceneLoadState SceneLoader::get_state() const { return impl->state; }
+
+    f32 SceneLoader::get_progress() const
+    {
+        switch (impl->state)
+        {
+            case SceneLoadState::Merging:
+                return static_cast<f32>(impl->merged_entities) / impl->staging_ids.size();
+
+            case SceneLoadState::Finished:
+                return 1.0f;
+
+            default:
+                return 0.0f;
+        }
+    }
+
+    const str& SceneLoader::get_file_path() const { return impl->file_path; }
+
+    const ref<Scene>& SceneLoader::get_scene() const { return impl->scene; }
+};  // namespace mag
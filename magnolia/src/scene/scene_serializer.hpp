@@ -4,11 +4,49 @@
 
 namespace mag
 {
+#define SCENE_FILE_EXTENSION ".scene.bin"
+
     class Scene;
 
     namespace scene
     {
+        // Scenes are stored in a binary format (components are stored column-wise, one section per component type)
+        // when the file has the scene extension. Any other file is read/written as json, which is kept as an export
+        // format.
         b8 load(const str& file_path, Scene& scene);
         b8 save(const str& file_path, Scene& scene);
     };  // namespace scene
+
+    enum class SceneLoadState
+    {
+        Reading,  // The file is deserialized into a staging ECS in another thread
+        Merging,  // The entities are moved into the scene a few at a time
+        Finished,
+        Failed
+    };
+
+    // Loads a scene without stalling the frame. The file is read by the job system and the entities are merged into
+    // the (live) scene within a time budget per frame, so the scene fills in progressively. The models and textures
+    // are only requested from the managers when their entity is merged.
+    class SceneLoader
+    {
+        public:
+            SceneLoader(const str& file_path, const ref<Scene>& scene);
+            ~SceneLoader();
+
+            // Called once per frame, the budget is in milliseconds (at least one entity is merged per call)
+            void update(const f64 time_budget);
+
+            SceneLoadState get_state() const;
+
+            // Fraction of the entities merged
+            f32 get_progress() const;
+
+            const str& get_file_path() const;
+            const ref<Scene>& get_scene() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
 };      // namespace mag
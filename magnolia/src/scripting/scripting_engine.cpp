@@ -6,35 +6,26 @@
 #include <filesystem>
 
 #include "core/logger.hpp"
+#include "platform/file_system.hpp"
 
 namespace mag
 {
     void* ScriptingEngine::load_script(const str& file_path)
     {
-        // @TODO: cleanup
-        str scripts_bin_folder = "scripts/";
+        const str scripts_bin_folder = fs::get_output_directory() + "scripts/";
         str extension = ".so";
         str configuration = "_debug";
-        {
-            const std::filesystem::path cwd = std::filesystem::current_path();
-            const str last_folder = cwd.filename().string();
-            str system = "linux";
 
 #if MAG_PLATFORM_WINDOWS
-            system = "windows";
-            extension = ".dll";
+        extension = ".dll";
 #endif
 
 #if MAG_CONFIG_PROFILE
-            configuration = "_profile";
+        configuration = "_profile";
 #elif MAG_CONFIG_RELEASE
-            configuration = "_release";
+        configuration = "_release";
 #endif
 
-            if (last_folder == "Magnolia") scripts_bin_folder = "build/" + system + "/" + scripts_bin_folder;
-        }
-        // @TODO: cleanup
-
         const str script_src = std::filesystem::path(file_path).stem();
         const str script_dll = scripts_bin_folder + "lib" + script_src + configuration + extension;
 
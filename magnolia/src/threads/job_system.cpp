@@ -1,5 +1,6 @@
 #include "threads/job_system.hpp"
 
+#include <atomic>
 #include <mutex>
 #include <queue>
 #include <thread>
@@ -55,17 +56,41 @@ namespace mag
     {
             IMPL() : running(true) {}
 
+            b8 execute_next_job();
+
             JobQueue job_queue;
             std::vector<std::thread> workers;
 
             std::queue<JobCallbackFn> callback_queue;
             std::queue<b8> execute_result_queue;
             std::mutex callback_mutex;
-            std::mutex execute_mutex;
 
-            b8 running;
+            std::atomic<b8> running;
     };
 
+    b8 JobSystem::IMPL::execute_next_job()
+    {
+        Job job = job_queue.pop();
+        if (!job.execute_fn && !job.callback_fn)
+        {
+            return false;
+        }
+
+        // Execute the job
+        const b8 result = job.execute_fn ? job.execute_fn() : true;
+
+        // Push the callback and its result to the callback queue. Both are pushed together so the queues stay in
+        // sync even when a job has no callback.
+        if (job.callback_fn)
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            callback_queue.push(job.callback_fn);
+            execute_result_queue.push(result);
+        }
+
+        return true;
+    }
+
     JobSystem::JobSystem(const u32 max_number_of_threads) : impl(new IMPL())
     {
         for (u32 i = 0; i < max_number_of_threads; i++)
@@ -74,22 +99,7 @@ namespace mag
             {
                 while (impl->running)
                 {
-                    Job job = impl->job_queue.pop();
-
-                    // Execute the job
-                    if (job.execute_fn)
-                    {
-                        const b8 result = job.execute_fn();
-                        std::lock_guard<std::mutex> lock(impl->execute_mutex);
-                        impl->execute_result_queue.push(result);
-                    }
-
-                    // Push the callback to the callback queue
-                    if (job.callback_fn)
-                    {
-                        std::lock_guard<std::mutex> lock(impl->callback_mutex);
-                        impl->callback_queue.push(job.callback_fn);
-                    }
+                    impl->execute_next_job();
                 }
             };
 
@@ -113,7 +123,6 @@ namespace mag
     void JobSystem::process_callbacks()
     {
         std::unique_lock<std::mutex> callback_lock(impl->callback_mutex);
-        std::unique_lock<std::mutex> execute_lock(impl->execute_mutex);
 
         while (!impl->callback_queue.empty())
         {
@@ -124,15 +133,52 @@ namespace mag
             impl->execute_result_queue.pop();
 
             callback_lock.unlock();
-            execute_lock.unlock();
 
             // Execute the callback on the main thread
             callback(result);
 
             callback_lock.lock();
-            execute_lock.lock();
         }
     }
 
     void JobSystem::add_job(Job job) { impl->job_queue.push(job); }
+
+    b8 JobSystem::execute_and_wait(const std::vector<JobExecuteFn>& jobs)
+    {
+        std::atomic<u32> remaining_jobs = jobs.size();
+        std::atomic<b8> result = true;
+
+        for (const auto& job : jobs)
+        {
+            auto execute = [&remaining_jobs, &result, job]
+            {
+                if (!job())
+                {
+                    result = false;
+                }
+
+                // This must be the last access to the captured references
+                remaining_jobs--;
+                return true;
+            };
+
+            impl->job_queue.push(Job(execute, {}));
+        }
+
+        wait_until([&remaining_jobs] { return remaining_jobs == 0; });
+
+        return result;
+    }
+
+    void JobSystem::wait_until(const std::function<b8()>& condition)
+    {
+        // Help the workers instead of blocking
+        while (!condition())
+        {
+            if (!impl->execute_next_job())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
 };  // namespace mag
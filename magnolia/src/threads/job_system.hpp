@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 
 #include "core/types.hpp"
 
@@ -43,6 +44,14 @@ namespace mag
             void add_job(Job job);
             void process_callbacks();
 
+            // Execute all jobs and block until they are finished. The calling thread also executes pending jobs while
+            // waiting, so this is safe to call from inside another job. Returns false if any of the jobs failed.
+            b8 execute_and_wait(const std::vector<JobExecuteFn>& jobs);
+
+            // Executes pending jobs on the calling thread until the condition is met (i.e. a job added with add_job
+            // finished)
+            void wait_until(const std::function<b8()>& condition);
+
         private:
             struct IMPL;
             unique<IMPL> impl;
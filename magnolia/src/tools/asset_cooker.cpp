@@ -0,0 +1,507 @@
+#include "tools/asset_cooker.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "core/buffer.hpp"
+#include "core/hash.hpp"
+#include "core/logger.hpp"
+#include "platform/file_system.hpp"
+#include "platform/pack_file.hpp"
+#include "resources/image.hpp"
+#include "resources/resource_loader.hpp"
+#include "scene/scene_serializer.hpp"
+#include "threads/job_system.hpp"
+#include "tools/model_importer.hpp"
+#include "tools/texture_importer.hpp"
+
+namespace mag
+{
+#define MANIFEST_FILE_NAME "cook_manifest.json"
+#define NATIVE_DIRECTORY_NAME "native"
+
+// Bump this whenever the output of the cooker changes so that all assets are cooked again
+#define COOKER_VERSION 7
+
+    enum class CookStatus
+    {
+        Cooked,
+        Skipped,
+        Failed
+    };
+
+    struct CookEntry
+    {
+            str file_path = "";
+            str type = "";
+            u64 hash = 0;
+            std::vector<str> dependencies;  // Files the asset was cooked from besides itself
+            std::vector<str> outputs;
+            TextureFormat texture_format = TextureFormat::RGBA8;
+            ColorSpace color_space = ColorSpace::Srgb;
+            CookStatus status = CookStatus::Failed;
+    };
+
+    struct AssetCooker::IMPL
+    {
+            IMPL(JobSystem& job_system) : job_system(job_system) {}
+
+            // Each batch is cooked in order by a single job, batches are cooked in parallel
+            void cook_entries(const std::vector<std::vector<CookEntry*>>& batches, const json& previous_assets,
+                              const b8 force);
+            b8 cook_entry(CookEntry& entry, const json& previous_entry, const b8 force);
+            b8 hash_entry(const CookEntry& entry, const std::vector<str>& dependencies, u64& hash) const;
+            b8 cook_model(CookEntry& entry);
+            b8 cook_texture(CookEntry& entry);
+
+            // Textures referenced by the materials as normal maps and as other data (roughness, metalness, etc). The
+            // paths are normalized, so they match the entries however the asset directory was given.
+            void find_data_textures(const str& asset_directory, std::set<str>& normal_maps,
+                                    std::set<str>& data_textures) const;
+            TextureFormat select_texture_format(const CookEntry& entry, const std::set<str>& normal_maps,
+                                                const CookOptions& options) const;
+
+            b8 write_pack(const str& asset_directory, const std::vector<CookEntry>& entries,
+                          const str& pack_file_path) const;
+
+            JobSystem& job_system;
+            CookStatistics statistics;
+    };
+
+    AssetCooker::AssetCooker(JobSystem& job_system) : impl(new AssetCooker::IMPL(job_system)) {}
+    AssetCooker::~AssetCooker() = default;
+
+    b8 AssetCooker::cook(const str& raw_asset_directory, const CookOptions& options)
+    {
+        const str asset_directory = fs::get_fixed_path(raw_asset_directory).string();
+        const str manifest_file_path = asset_directory + "/" + MANIFEST_FILE_NAME;
+
+        impl->statistics = {};
+
+        if (!fs::is_directory(asset_directory))
+        {
+            LOG_ERROR("Asset directory not found: '{0}'", asset_directory);
+            return false;
+        }
+
+        // Load the previous manifest, if any
+        json manifest;
+        if (fs::exists(manifest_file_path) && fs::read_json_data(manifest_file_path, manifest))
+        {
+            if (!manifest.contains("Version") || manifest["Version"] != COOKER_VERSION)
+            {
+                LOG_INFO("Cook manifest is outdated, cooking all assets");
+                manifest = {};
+            }
+        }
+
+        const json previous_assets = manifest.contains("Assets") ? manifest["Assets"] : json::object();
+
+        // Gather the assets to be cooked
+        ModelImporter importer(impl->job_system);
+        std::vector<CookEntry> entries;
+
+        for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(asset_directory))
+        {
+            if (!dir_entry.is_regular_file())
+            {
+                continue;
+            }
+
+            const auto file_path = fs::get_fixed_path(dir_entry.path());
+
+            // Skip cooked files
+            const auto& parent_path = file_path.parent_path();
+            if (parent_path.filename() == NATIVE_DIRECTORY_NAME)
+            {
+                continue;
+            }
+
+            const str extension = fs::get_file_extension(file_path);
+
+            CookEntry entry;
+            entry.file_path = file_path.string();
+
+            if (importer.is_extension_supported(extension))
+            {
+                entry.type = "Model";
+            }
+
+            else if (resource::is_image_extension_supported(extension))
+            {
+                entry.type = "Texture";
+            }
+
+            else
+            {
+                continue;
+            }
+
+            entries.push_back(entry);
+        }
+
+        // Sort the entries so the manifest is deterministic
+        std::sort(entries.begin(), entries.end(),
+                  [](const CookEntry& a, const CookEntry& b) { return a.file_path < b.file_path; });
+
+        // Models of the same directory write their materials and packed textures to the same native directory and may
+        // share material names, so they are cooked by the same job. Each output then has a single writer.
+        std::map<str, std::vector<CookEntry*>> models_by_directory;
+        std::vector<std::vector<CookEntry*>> texture_batches;
+
+        for (auto& entry : entries)
+        {
+            if (entry.type == "Model")
+            {
+                const str directory = std::filesystem::path(entry.file_path).parent_path().string();
+                models_by_directory[directory].push_back(&entry);
+            }
+
+            else
+            {
+                texture_batches.push_back({&entry});
+            }
+        }
+
+        // Models first, they write the materials that tell which textures are normal maps or other data. Their packed
+        // roughness/metalness textures are cooked with them.
+        std::vector<std::vector<CookEntry*>> model_batches;
+        for (auto& [directory, models] : models_by_directory)
+        {
+            for (auto* entry : models)
+            {
+                entry->texture_format = TextureFormat::RGBA8;
+                if (options.compress_textures)
+                {
+                    entry->texture_format = options.fast_compression ? TextureFormat::BC1 : TextureFormat::BC7;
+                }
+            }
+
+            model_batches.push_back(models);
+        }
+
+        impl->cook_entries(model_batches, previous_assets, options.force);
+
+        std::set<str> normal_maps, data_textures;
+        impl->find_data_textures(asset_directory, normal_maps, data_textures);
+
+        for (auto& batch : texture_batches)
+        {
+            auto* entry = batch.front();
+            const str file_path = fs::get_normalized_path(entry->file_path).string();
+
+            entry->texture_format = impl->select_texture_format(*entry, normal_maps, options);
+            entry->color_space = data_textures.contains(file_path) ? ColorSpace::Linear : ColorSpace::Srgb;
+        }
+
+        impl->cook_entries(texture_batches, previous_assets, options.force);
+
+        // Write the new manifest
+        json new_manifest;
+        new_manifest["Type"] = "CookManifest";
+        new_manifest["Version"] = COOKER_VERSION;
+        new_manifest["Assets"] = json::object();
+
+        for (const auto& entry : entries)
+        {
+            switch (entry.status)
+            {
+                case CookStatus::Cooked:
+                    impl->statistics.cooked++;
+                    break;
+
+                case CookStatus::Skipped:
+                    impl->statistics.skipped++;
+                    break;
+
+                case CookStatus::Failed:
+                    impl->statistics.failed++;
+                    LOG_ERROR("Failed to cook asset: '{0}'", entry.file_path);
+                    continue;
+
+                default:
+                    break;
+            }
+
+            json data;
+            data["Type"] = entry.type;
+            data["Hash"] = entry.hash;
+            data["Dependencies"] = entry.dependencies;
+            data["Outputs"] = entry.outputs;
+
+            new_manifest["Assets"][entry.file_path] = data;
+        }
+
+        if (!fs::write_json_data(manifest_file_path, new_manifest))
+        {
+            LOG_ERROR("Failed to write cook manifest: '{0}'", manifest_file_path);
+            return false;
+        }
+
+        LOG_SUCCESS("Cooked {0} assets ({1} skipped, {2} failed)", impl->statistics.cooked, impl->statistics.skipped,
+                    impl->statistics.failed);
+
+        if (!options.pack_file_path.empty() && !impl->write_pack(asset_directory, entries, options.pack_file_path))
+        {
+            LOG_ERROR("Failed to write pack file: '{0}'", options.pack_file_path);
+            return false;
+        }
+
+        return impl->statistics.failed == 0;
+    }
+
+    void AssetCooker::IMPL::cook_entries(const std::vector<std::vector<CookEntry*>>& batches,
+                                         const json& previous_assets, const b8 force)
+    {
+        std::vector<JobExecuteFn> cook_jobs;
+        cook_jobs.reserve(batches.size());
+
+        for (const auto& batch : batches)
+        {
+            std::vector<json> previous_entries;
+            for (const auto* entry : batch)
+            {
+                previous_entries.push_back(previous_assets.contains(entry->file_path)
+                                               ? previous_assets[entry->file_path]
+                                               : json::object());
+            }
+
+            auto execute = [this, batch, previous_entries, force]
+            {
+                b8 result = true;
+                for (u64 i = 0; i < batch.size(); i++)
+                {
+                    result = cook_entry(*batch[i], previous_entries[i], force) && result;
+                }
+
+                return result;
+            };
+
+            cook_jobs.push_back(execute);
+        }
+
+        job_system.execute_and_wait(cook_jobs);
+    }
+
+    b8 AssetCooker::IMPL::cook_entry(CookEntry& entry, const json& previous_entry, const b8 force)
+    {
+        // Skip the asset if neither it nor the files it was cooked from changed and all outputs still exist
+        if (!force && previous_entry.contains("Hash") && previous_entry.contains("Dependencies") &&
+            previous_entry.contains("Outputs"))
+        {
+            const std::vector<str> dependencies = previous_entry["Dependencies"];
+            const std::vector<str> outputs = previous_entry["Outputs"];
+
+            const b8 outputs_exist =
+                std::all_of(outputs.begin(), outputs.end(), [](const str& output) { return fs::exists(output); });
+
+            u64 hash = 0;
+            if (outputs_exist && hash_entry(entry, dependencies, hash) && previous_entry["Hash"] == hash)
+            {
+                entry.hash = hash;
+                entry.dependencies = dependencies;
+                entry.outputs = outputs;
+                entry.status = CookStatus::Skipped;
+                return true;
+            }
+        }
+
+        b8 result = false;
+        if (entry.type == "Model")
+        {
+            result = cook_model(entry);
+        }
+
+        else if (entry.type == "Texture")
+        {
+            result = cook_texture(entry);
+        }
+
+        // Hashed after cooking, the dependencies are only known then
+        result = result && hash_entry(entry, entry.dependencies, entry.hash);
+
+        entry.status = result ? CookStatus::Cooked : CookStatus::Failed;
+        return result;
+    }
+
+    b8 AssetCooker::IMPL::hash_entry(const CookEntry& entry, const std::vector<str>& dependencies, u64& hash) const
+    {
+        Buffer buffer;
+        if (!fs::read_binary_data(entry.file_path, buffer))
+        {
+            return false;
+        }
+
+        // The output format and color space are part of the hash, so changing them cooks the asset again
+        hash = hash_data(&entry.texture_format, sizeof(TextureFormat), hash_buffer(buffer));
+        hash = hash_data(&entry.color_space, sizeof(ColorSpace), hash);
+
+        // So are the dependencies, a missing one only contributes its path
+        for (const auto& dependency : dependencies)
+        {
+            hash = hash_data(dependency.data(), dependency.size(), hash);
+
+            if (fs::exists(dependency) && fs::read_binary_data(dependency, buffer))
+            {
+                hash = hash_data(buffer.data.data(), buffer.get_size(), hash);
+            }
+        }
+
+        return true;
+    }
+
+    b8 AssetCooker::IMPL::cook_model(CookEntry& entry)
+    {
+        // Assimp importers are not thread safe, so each job gets its own
+        ModelImporter importer(job_system, entry.texture_format);
+
+        str imported_model_path = "";
+        if (!importer.import(entry.file_path, imported_model_path))
+        {
+            return false;
+        }
+
+        entry.dependencies = importer.get_dependencies();
+        entry.outputs = importer.get_outputs();
+        return true;
+    }
+
+    b8 AssetCooker::IMPL::cook_texture(CookEntry& entry)
+    {
+        TextureImporter importer(&job_system);
+
+        str imported_texture_path = "";
+        if (!importer.import(entry.file_path, imported_texture_path, entry.texture_format, entry.color_space))
+        {
+            return false;
+        }
+
+        entry.outputs = {imported_texture_path};
+        return true;
+    }
+
+    b8 AssetCooker::IMPL::write_pack(const str& asset_directory, const std::vector<CookEntry>& entries,
+                                     const str& pack_file_path) const
+    {
+        // Only what the application loads: the cooked outputs and the files that are loaded as they are. Sources,
+        // the buffers of the source models and the sources that failed to cook are left out.
+        static const std::vector<str> runtime_extensions = {".json", SCENE_FILE_EXTENSION, ".ttf"};
+
+        std::set<str> output_file_paths;
+        for (const auto& entry : entries)
+        {
+            if (entry.status == CookStatus::Failed)
+            {
+                continue;
+            }
+
+            for (const auto& output : entry.outputs)
+            {
+                output_file_paths.insert(fs::get_fixed_path(output).string());
+            }
+        }
+
+        std::vector<str> file_paths;
+        for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(asset_directory))
+        {
+            const auto path = fs::get_fixed_path(dir_entry.path());
+            const str file_path = path.string();
+            if (!dir_entry.is_regular_file() || file_path.ends_with(MANIFEST_FILE_NAME) ||
+                file_path.ends_with(PACK_FILE_EXTENSION))
+            {
+                continue;
+            }
+
+            // Materials, model binaries and packed textures are written next to the cooked outputs
+            const b8 is_cooked = output_file_paths.contains(file_path) ||
+                                 path.parent_path().filename() == NATIVE_DIRECTORY_NAME;
+
+            const b8 is_runtime_file = std::any_of(runtime_extensions.begin(), runtime_extensions.end(),
+                                                   [&file_path](const str& extension)
+                                                   { return file_path.ends_with(extension); });
+
+            if (is_cooked || is_runtime_file)
+            {
+                file_paths.push_back(file_path);
+            }
+        }
+
+        // Same pack for the same assets
+        std::sort(file_paths.begin(), file_paths.end());
+
+        return PackFile::write(pack_file_path, file_paths);
+    }
+
+    void AssetCooker::IMPL::find_data_textures(const str& asset_directory, std::set<str>& normal_maps,
+                                               std::set<str>& data_textures) const
+    {
+        static const std::vector<str> data_slots = {"Normal", "Roughness", "Metalness", "AmbientOcclusion",
+                                                    "RoughnessMetalness"};
+
+        for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(asset_directory))
+        {
+            const str file_path = fs::get_fixed_path(dir_entry.path()).string();
+            if (!dir_entry.is_regular_file() || !file_path.ends_with(".mat.json"))
+            {
+                continue;
+            }
+
+            json data;
+            if (!fs::read_json_data(file_path, data) || !data.contains("Textures"))
+            {
+                continue;
+            }
+
+            for (const auto& slot : data_slots)
+            {
+                if (!data["Textures"].contains(slot))
+                {
+                    continue;
+                }
+
+                const str texture = data["Textures"][slot];
+                const str texture_path = fs::get_normalized_path(texture).string();
+
+                data_textures.insert(texture_path);
+                if (slot == "Normal")
+                {
+                    normal_maps.insert(texture_path);
+                }
+            }
+        }
+    }
+
+    TextureFormat AssetCooker::IMPL::select_texture_format(const CookEntry& entry, const std::set<str>& normal_maps,
+                                                           const CookOptions& options) const
+    {
+        const str file_path = fs::get_normalized_path(entry.file_path).string();
+
+        u32 width = 0, height = 0, channels = 0, mip_levels = 0;
+        TextureFormat format = TextureFormat::RGBA8;
+
+        if (!options.compress_textures)
+        {
+            resource::get_image_info(file_path, &width, &height, &channels, &mip_levels, &format);
+            return format;
+        }
+
+        if (normal_maps.contains(file_path))
+        {
+            return TextureFormat::BC5;
+        }
+
+        // Single and dual channel textures are already small, keep them uncompressed
+        if (resource::get_image_info(file_path, &width, &height, &channels, &mip_levels, &format) &&
+            format != TextureFormat::RGBA8)
+        {
+            return format;
+        }
+
+        // Translucent textures are stored as BC3 instead of BC1 (see TextureImporter)
+        return options.fast_compression ? TextureFormat::BC1 : TextureFormat::BC7;
+    }
+
+    const CookStatistics& AssetCooker::get_statistics() const { return impl->statistics; }
+};  // namespace mag
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    class JobSystem;
+
+    struct CookOptions
+    {
+            // Cook all assets, even the ones that did not change
+            b8 force = false;
+
+            // Use BCn formats for textures (BC7 for color, BC5 for normal maps)
+            b8 compress_textures = true;
+
+            // Use BC1/BC3 instead of BC7. Lower quality, but faster to encode.
+            b8 fast_compression = false;
+
+            // Also pack the cooked assets into this file (see PackFile), empty for no pack
+            str pack_file_path = "";
+    };
+
+    struct CookStatistics
+    {
+            u32 cooked = 0;
+            u32 skipped = 0;
+            u32 failed = 0;
+    };
+
+    // Converts every supported asset of a directory to the native formats. Unchanged assets (same content hash as the
+    // one stored in the manifest) are skipped. Does not need a window or a renderer.
+    class AssetCooker
+    {
+        public:
+            AssetCooker(JobSystem& job_system);
+            ~AssetCooker();
+
+            b8 cook(const str& asset_directory, const CookOptions& options = {});
+
+            const CookStatistics& get_statistics() const;
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
@@ -0,0 +1,470 @@
+#include "tools/block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "core/logger.hpp"
+#include "resources/image.hpp"
+
+namespace mag
+{
+    namespace bc
+    {
+        // Helpers
+        // -------------------------------------------------------------------------------------------------------------
+
+        // Find the principal axis of the block with a few power iterations. Returns the min and max projections.
+        void find_endpoints(const u8* block, const u32 channels, const u32 stride, f32* min_endpoint,
+                            f32* max_endpoint)
+        {
+            f32 mean[4] = {};
+            for (u32 i = 0; i < 16; i++)
+            {
+                for (u32 c = 0; c < channels; c++)
+                {
+                    mean[c] += block[i * stride + c];
+                }
+            }
+
+            for (u32 c = 0; c < channels; c++)
+            {
+                mean[c] /= 16.0f;
+            }
+
+            f32 covariance[4][4] = {};
+            for (u32 i = 0; i < 16; i++)
+            {
+                for (u32 a = 0; a < channels; a++)
+                {
+                    for (u32 b = 0; b < channels; b++)
+                    {
+                        covariance[a][b] += (block[i * stride + a] - mean[a]) * (block[i * stride + b] - mean[b]);
+                    }
+                }
+            }
+
+            f32 axis[4] = {1, 1, 1, 1};
+            for (u32 iteration = 0; iteration < 8; iteration++)
+            {
+                f32 next[4] = {};
+                for (u32 a = 0; a < channels; a++)
+                {
+                    for (u32 b = 0; b < channels; b++)
+                    {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                }
+
+                f32 length = 0;
+                for (u32 c = 0; c < channels; c++)
+                {
+                    length = std::max(length, std::abs(next[c]));
+                }
+
+                // Flat block, any axis will do
+                if (length < 1e-6f)
+                {
+                    break;
+                }
+
+                for (u32 c = 0; c < channels; c++)
+                {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            f32 min_t = std::numeric_limits<f32>::max();
+            f32 max_t = std::numeric_limits<f32>::lowest();
+            for (u32 i = 0; i < 16; i++)
+            {
+                f32 t = 0;
+                for (u32 c = 0; c < channels; c++)
+                {
+                    t += (block[i * stride + c] - mean[c]) * axis[c];
+                }
+
+                min_t = std::min(min_t, t);
+                max_t = std::max(max_t, t);
+            }
+
+            f32 axis_length_sqr = 0;
+            for (u32 c = 0; c < channels; c++)
+            {
+                axis_length_sqr += axis[c] * axis[c];
+            }
+
+            for (u32 c = 0; c < channels; c++)
+            {
+                const f32 scale = axis[c] / std::max(axis_length_sqr, 1e-6f);
+                min_endpoint[c] = std::clamp(mean[c] + min_t * scale, 0.0f, 255.0f);
+                max_endpoint[c] = std::clamp(mean[c] + max_t * scale, 0.0f, 255.0f);
+            }
+        }
+
+        u16 pack_565(const f32* color)
+        {
+            const u16 r = static_cast<u16>(std::round(color[0] * 31.0f / 255.0f));
+            const u16 g = static_cast<u16>(std::round(color[1] * 63.0f / 255.0f));
+            const u16 b = static_cast<u16>(std::round(color[2] * 31.0f / 255.0f));
+
+            return (r << 11) | (g << 5) | b;
+        }
+
+        void unpack_565(const u16 packed, i32* color)
+        {
+            const i32 r = (packed >> 11) & 31;
+            const i32 g = (packed >> 5) & 63;
+            const i32 b = packed & 31;
+
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        // Writes 'count' bits to a 128 bit block, starting at 'offset'
+        void write_bits(u8* output, u32& offset, const u32 value, const u32 count)
+        {
+            for (u32 i = 0; i < count; i++, offset++)
+            {
+                if (value & (1u << i))
+                {
+                    output[offset / 8] |= 1u << (offset % 8);
+                }
+            }
+        }
+
+        // Encoders
+        // -------------------------------------------------------------------------------------------------------------
+
+        void encode_bc1(const u8* block_rgba, u8* output)
+        {
+            f32 min_endpoint[4], max_endpoint[4];
+            find_endpoints(block_rgba, 3, 4, min_endpoint, max_endpoint);
+
+            u16 c0 = pack_565(max_endpoint);
+            u16 c1 = pack_565(min_endpoint);
+
+            // Always use the 4 color mode (c0 > c1)
+            if (c0 < c1)
+            {
+                std::swap(c0, c1);
+            }
+
+            i32 palette[4][3];
+            unpack_565(c0, palette[0]);
+            unpack_565(c1, palette[1]);
+
+            for (u32 c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            u32 indices = 0;
+            if (c0 != c1)
+            {
+                for (u32 i = 0; i < 16; i++)
+                {
+                    u32 best_index = 0;
+                    i32 best_error = std::numeric_limits<i32>::max();
+
+                    for (u32 p = 0; p < 4; p++)
+                    {
+                        i32 error = 0;
+                        for (u32 c = 0; c < 3; c++)
+                        {
+                            const i32 diff = block_rgba[i * 4 + c] - palette[p][c];
+                            error += diff * diff;
+                        }
+
+                        if (error < best_error)
+                        {
+                            best_error = error;
+                            best_index = p;
+                        }
+                    }
+
+                    indices |= best_index << (i * 2);
+                }
+            }
+
+            memcpy(output + 0, &c0, sizeof(u16));
+            memcpy(output + 2, &c1, sizeof(u16));
+            memcpy(output + 4, &indices, sizeof(u32));
+        }
+
+        void encode_bc4(const u8* block_values, u8* output)
+        {
+            u8 e0 = 0, e1 = 255;
+            for (u32 i = 0; i < 16; i++)
+            {
+                e0 = std::max(e0, block_values[i]);
+                e1 = std::min(e1, block_values[i]);
+            }
+
+            // e0 > e1 selects the 8 value mode
+            i32 palette[8] = {e0, e1};
+            for (u32 p = 2; p < 8; p++)
+            {
+                palette[p] = ((8 - p) * e0 + (p - 1) * e1) / 7;
+            }
+
+            u64 indices = 0;
+            if (e0 != e1)
+            {
+                for (u32 i = 0; i < 16; i++)
+                {
+                    u64 best_index = 0;
+                    i32 best_error = std::numeric_limits<i32>::max();
+
+                    for (u32 p = 0; p < 8; p++)
+                    {
+                        const i32 error = std::abs(block_values[i] - palette[p]);
+                        if (error < best_error)
+                        {
+                            best_error = error;
+                            best_index = p;
+                        }
+                    }
+
+                    indices |= best_index << (i * 3);
+                }
+            }
+
+            output[0] = e0;
+            output[1] = e1;
+            for (u32 i = 0; i < 6; i++)
+            {
+                output[2 + i] = static_cast<u8>(indices >> (i * 8));
+            }
+        }
+
+        void encode_bc3(const u8* block_rgba, u8* output)
+        {
+            u8 alpha[16];
+            for (u32 i = 0; i < 16; i++)
+            {
+                alpha[i] = block_rgba[i * 4 + 3];
+            }
+
+            encode_bc4(alpha, output);
+            encode_bc1(block_rgba, output + 8);
+        }
+
+        void encode_bc5(const u8* block_rgba, u8* output)
+        {
+            u8 red[16], green[16];
+            for (u32 i = 0; i < 16; i++)
+            {
+                red[i] = block_rgba[i * 4 + 0];
+                green[i] = block_rgba[i * 4 + 1];
+            }
+
+            encode_bc4(red, output);
+            encode_bc4(green, output + 8);
+        }
+
+        // Only mode 6 is used: a single subset with RGBA endpoints (7 bits + shared p-bit) and 4 bit indices. It is
+        // not as good as a full BC7 encoder, but it is fast and handles smooth gradients and alpha well.
+        void encode_bc7(const u8* block_rgba, u8* output)
+        {
+            static const u32 weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+            f32 endpoints[2][4];
+            find_endpoints(block_rgba, 4, 4, endpoints[0], endpoints[1]);
+
+            // Quantize each endpoint to 7 bits + p-bit, picking the p-bit with the lowest error
+            u32 quantized[2][4];
+            u32 p_bits[2];
+            i32 decoded[2][4];
+
+            for (u32 e = 0; e < 2; e++)
+            {
+                f32 best_error = std::numeric_limits<f32>::max();
+
+                for (u32 p = 0; p < 2; p++)
+                {
+                    f32 error = 0;
+                    u32 candidate[4];
+
+                    for (u32 c = 0; c < 4; c++)
+                    {
+                        const f32 value = (endpoints[e][c] - p) / 2.0f;
+                        candidate[c] = static_cast<u32>(std::clamp(std::round(value), 0.0f, 127.0f));
+
+                        const f32 diff = endpoints[e][c] - static_cast<f32>((candidate[c] << 1) | p);
+                        error += diff * diff;
+                    }
+
+                    if (error < best_error)
+                    {
+                        best_error = error;
+                        p_bits[e] = p;
+                        memcpy(quantized[e], candidate, sizeof(candidate));
+                    }
+                }
+
+                for (u32 c = 0; c < 4; c++)
+                {
+                    decoded[e][c] = (quantized[e][c] << 1) | p_bits[e];
+                }
+            }
+
+            i32 palette[16][4];
+            for (u32 w = 0; w < 16; w++)
+            {
+                for (u32 c = 0; c < 4; c++)
+                {
+                    palette[w][c] = ((64 - weights[w]) * decoded[0][c] + weights[w] * decoded[1][c] + 32) >> 6;
+                }
+            }
+
+            u32 indices[16];
+            for (u32 i = 0; i < 16; i++)
+            {
+                i32 best_error = std::numeric_limits<i32>::max();
+                indices[i] = 0;
+
+                for (u32 w = 0; w < 16; w++)
+                {
+                    i32 error = 0;
+                    for (u32 c = 0; c < 4; c++)
+                    {
+                        const i32 diff = block_rgba[i * 4 + c] - palette[w][c];
+                        error += diff * diff;
+                    }
+
+                    if (error < best_error)
+                    {
+                        best_error = error;
+                        indices[i] = w;
+                    }
+                }
+            }
+
+            // The MSB of the first index is implicit (anchor), so swap the endpoints if needed
+            if (indices[0] & 8)
+            {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(p_bits[0], p_bits[1]);
+
+                for (u32 i = 0; i < 16; i++)
+                {
+                    indices[i] = 15 - indices[i];
+                }
+            }
+
+            memset(output, 0, 16);
+
+            u32 offset = 0;
+            write_bits(output, offset, 1 << 6, 7);  // Mode 6
+
+            for (u32 c = 0; c < 4; c++)
+            {
+                write_bits(output, offset, quantized[0][c], 7);
+                write_bits(output, offset, quantized[1][c], 7);
+            }
+
+            write_bits(output, offset, p_bits[0], 1);
+            write_bits(output, offset, p_bits[1], 1);
+
+            write_bits(output, offset, indices[0], 3);
+            for (u32 i = 1; i < 16; i++)
+            {
+                write_bits(output, offset, indices[i], 4);
+            }
+        }
+
+        void encode_block(const TextureFormat format, const u8* block_rgba, u8* output)
+        {
+            switch (format)
+            {
+                case TextureFormat::BC1:
+                    encode_bc1(block_rgba, output);
+                    break;
+
+                case TextureFormat::BC3:
+                    encode_bc3(block_rgba, output);
+                    break;
+
+                case TextureFormat::BC5:
+                    encode_bc5(block_rgba, output);
+                    break;
+
+                case TextureFormat::BC7:
+                    encode_bc7(block_rgba, output);
+                    break;
+
+                default:
+                    LOG_ERROR("Invalid block compression format");
+                    break;
+            }
+        }
+
+        b8 compress(Image& image, const TextureFormat format)
+        {
+            if (!is_block_compressed(format))
+            {
+                return true;
+            }
+
+            if (image.format != TextureFormat::RGBA8 || image.channels != 4)
+            {
+                LOG_ERROR("Only RGBA8 images can be compressed");
+                return false;
+            }
+
+            if (image.pixels.size() < get_mip_chain_size(image))
+            {
+                LOG_ERROR("Image must contain all mip levels before compression");
+                return false;
+            }
+
+            Image compressed = image;
+            compressed.format = format;
+            compressed.pixels.resize(get_mip_chain_size(compressed));
+
+            const u32 block_size = get_block_size(format);
+
+            u64 src_offset = 0;
+            u64 dst_offset = 0;
+
+            for (u32 i = 0; i < image.mip_levels; i++)
+            {
+                const u32 width = std::max(image.width >> i, 1u);
+                const u32 height = std::max(image.height >> i, 1u);
+                const u8* src = image.pixels.data() + src_offset;
+
+                for (u32 block_y = 0; block_y < height; block_y += 4)
+                {
+                    for (u32 block_x = 0; block_x < width; block_x += 4)
+                    {
+                        // Gather the block. Pixels outside of the image clamp to the edge.
+                        u8 block[16 * 4];
+                        for (u32 y = 0; y < 4; y++)
+                        {
+                            for (u32 x = 0; x < 4; x++)
+                            {
+                                const u32 px = std::min(block_x + x, width - 1);
+                                const u32 py = std::min(block_y + y, height - 1);
+
+                                memcpy(&block[(y * 4 + x) * 4], &src[(py * width + px) * 4], 4);
+                            }
+                        }
+
+                        encode_block(format, block, compressed.pixels.data() + dst_offset);
+                        dst_offset += block_size;
+                    }
+                }
+
+                src_offset += get_mip_size(image, i);
+            }
+
+            image = std::move(compressed);
+            return true;
+        }
+    };  // namespace bc
+};      // namespace mag
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    struct Image;
+
+    enum class TextureFormat;
+
+    // CPU encoders for the BCn block formats. Each block is 4x4 pixels, RGBA8 input.
+    namespace bc
+    {
+        void encode_bc1(const u8* block_rgba, u8* output);
+        void encode_bc3(const u8* block_rgba, u8* output);
+        void encode_bc4(const u8* block_values, u8* output);
+        void encode_bc5(const u8* block_rgba, u8* output);
+        void encode_bc7(const u8* block_rgba, u8* output);
+        void encode_block(const TextureFormat format, const u8* block_rgba, u8* output);
+
+        // Compress all mip levels of an uncompressed RGBA8 image
+        b8 compress(Image& image, const TextureFormat format);
+    };  // namespace bc
+};      // namespace mag
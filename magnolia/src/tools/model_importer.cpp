@@ -1,18 +1,22 @@
 #include "tools/model_importer.hpp"
 
+#include <map>
+#include <set>
 #include <vector>
 
+#include "assimp/DefaultIOSystem.h"
 #include "assimp/Importer.hpp"
 #include "assimp/material.h"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
-#include "core/application.hpp"
 #include "core/buffer.hpp"
 #include "core/logger.hpp"
 #include "meshoptimizer.h"
 #include "platform/file_system.hpp"
-#include "resources/material.hpp"
+#include "resources/image.hpp"
 #include "resources/model.hpp"
+#include "threads/job_system.hpp"
+#include "tools/texture_importer.hpp"
 
 namespace mag
 {
@@ -20,24 +24,72 @@ namespace mag
 #define MODEL_FILE_EXTENSION ".model.json"
 #define BINARY_FILE_EXTENSION ".model.bin"
 
+    // Vertices and indices of a single mesh, relative to the mesh itself
+    struct MeshData
+    {
+            std::vector<Vertex> vertices;
+            std::vector<u32> indices;
+    };
+
+    // Keeps track of the files assimp opens, a model may be split in many files (i.e. .gltf + .bin, .obj + .mtl)
+    class RecordingIOSystem : public Assimp::DefaultIOSystem
+    {
+        public:
+            RecordingIOSystem(std::set<str>& opened_files) : opened_files(opened_files) {}
+
+            Assimp::IOStream* Open(const char* file_path, const char* mode) override
+            {
+                Assimp::IOStream* stream = Assimp::DefaultIOSystem::Open(file_path, mode);
+                if (stream)
+                {
+                    opened_files.insert(fs::get_normalized_path(file_path).string());
+                }
+
+                return stream;
+            }
+
+        private:
+            std::set<str>& opened_files;
+    };
+
     struct ModelImporter::IMPL
     {
-            IMPL() : importer(new Assimp::Importer()) {}
+            IMPL(JobSystem& job_system, const TextureFormat packed_texture_format)
+                : importer(new Assimp::Importer()),
+                  job_system(job_system),
+                  packed_texture_format(packed_texture_format)
+            {
+                // The importer owns the io system
+                importer->SetIOHandler(new RecordingIOSystem(opened_files));
+            }
+
             ~IMPL() = default;
 
-            b8 create_native_file(const str& output_directory, const Model& model, str& imported_model_path);
+            b8 create_native_file(const str& file_path, const str& output_directory, const Model& model,
+                                  str& imported_model_path);
 
-            b8 initialize_mesh(const u32 mesh_idx, const aiMesh* ai_mesh, Model& model);
-            void initialize_materials(const aiScene* ai_scene, const str& file_path, const str& output_directory,
-                                      Model& model);
-            void optimize_mesh(std::vector<Vertex>& vertices, std::vector<u32>& indices, Model& model);
+            b8 initialize_mesh(const aiMesh* ai_mesh, Mesh& mesh, MeshData& mesh_data) const;
+            b8 initialize_materials(const aiScene* ai_scene, const str& file_path, const str& output_directory,
+                                    Model& model);
+            void merge_meshes(std::vector<MeshData>& meshes_data, Model& model) const;
+            void optimize_mesh(MeshData& mesh_data) const;
 
             const str find_texture(const aiMaterial* ai_material, aiTextureType ai_type, const str& directory) const;
 
             unique<Assimp::Importer> importer;
+            JobSystem& job_system;
+            TextureFormat packed_texture_format;
+
+            std::set<str> opened_files;
+            std::vector<str> dependencies;
+            std::vector<str> outputs;
     };
 
-    ModelImporter::ModelImporter() : impl(new ModelImporter::IMPL()) {}
+    ModelImporter::ModelImporter(JobSystem& job_system, const TextureFormat packed_texture_format)
+        : impl(new ModelImporter::IMPL(job_system, packed_texture_format))
+    {
+    }
+
     ModelImporter::~ModelImporter() = default;
 
     b8 ModelImporter::import(const str& file_path, str& imported_model_path)
@@ -45,6 +97,10 @@ namespace mag
         const u32 flags = aiProcessPreset_TargetRealtime_Fast | aiProcess_FlipUVs | aiProcess_GenBoundingBoxes |
                           aiProcess_PreTransformVertices | aiProcess_Debone;
 
+        impl->opened_files.clear();
+        impl->dependencies.clear();
+        impl->outputs.clear();
+
         const aiScene* scene = impl->importer->ReadFile(file_path, flags);
         if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE))
         {
@@ -58,19 +114,33 @@ namespace mag
             return false;
         }
 
+        auto& job_system = impl->job_system;
+
         Model model = {};
         model.name = scene->mRootNode->mName.C_Str();
         model.meshes.resize(scene->mNumMeshes);
 
+        // Each mesh is loaded and optimized independently, so fan them out to the job system
+        std::vector<MeshData> meshes_data(scene->mNumMeshes);
+        std::vector<JobExecuteFn> mesh_jobs;
+        mesh_jobs.reserve(scene->mNumMeshes);
+
         for (u32 m = 0; m < scene->mNumMeshes; m++)
         {
-            const aiMesh* mesh = scene->mMeshes[m];
-            if (!impl->initialize_mesh(m, mesh, model))
-            {
-                return false;
-            }
+            auto execute = [this, scene, m, &model, &meshes_data]
+            { return impl->initialize_mesh(scene->mMeshes[m], model.meshes[m], meshes_data[m]); };
+
+            mesh_jobs.push_back(execute);
         }
 
+        if (!job_system.execute_and_wait(mesh_jobs))
+        {
+            LOG_ERROR("Failed to initialize meshes of model '{0}'", file_path);
+            return false;
+        }
+
+        impl->merge_meshes(meshes_data, model);
+
         // Sort meshes by ascending order of material index
         std::sort(model.meshes.begin(), model.meshes.end(),
                   [](const Mesh& a, const Mesh& b) { return a.material_index < b.material_index; });
@@ -82,11 +152,24 @@ namespace mag
             return false;
         }
 
-        impl->initialize_materials(scene, file_path, output_directory, model);
-        return impl->create_native_file(output_directory, model, imported_model_path);
+        if (!impl->initialize_materials(scene, file_path, output_directory, model))
+        {
+            return false;
+        }
+
+        if (!impl->create_native_file(file_path, output_directory, model, imported_model_path))
+        {
+            return false;
+        }
+
+        // The model file itself is not a dependency
+        impl->opened_files.erase(fs::get_normalized_path(file_path).string());
+        impl->dependencies.insert(impl->dependencies.end(), impl->opened_files.begin(), impl->opened_files.end());
+
+        return true;
     }
 
-    b8 ModelImporter::IMPL::create_native_file(const str& output_directory, const Model& model,
+    b8 ModelImporter::IMPL::create_native_file(const str& file_path, const str& output_directory, const Model& model,
                                                str& imported_model_path)
     {
         const str native_model_file_path = output_directory + "/" + model.name + MODEL_FILE_EXTENSION;
@@ -100,12 +183,16 @@ namespace mag
         data["Type"] = "Model";
         data["Name"] = model.name;
         data["File"] = binary_file_path;
+        data["Source"] = file_path;  // Imported again when it changes (see AssetGraph)
         data["Materials"] = model.materials;
 
         data["NumVertices"] = model.vertices.size();
         data["NumIndices"] = model.indices.size();
         data["NumMeshes"] = model.meshes.size();
 
+        // Identical models share one copy when loaded (see ModelManager)
+        data["Hash"] = get_model_hash(model);
+
         // Write the data to the native file format
         if (!fs::write_json_data(native_model_file_path, data))
         {
@@ -152,11 +239,14 @@ namespace mag
             return false;
         }
 
+        outputs.push_back(native_model_file_path);
+        outputs.push_back(binary_file_path);
+
         imported_model_path = native_model_file_path;
         return true;
     }
 
-    b8 ModelImporter::IMPL::initialize_mesh(const u32 mesh_idx, const aiMesh* ai_mesh, Model& model)
+    b8 ModelImporter::IMPL::initialize_mesh(const aiMesh* ai_mesh, Mesh& mesh, MeshData& mesh_data) const
     {
         if (!ai_mesh->HasFaces())
         {
@@ -188,14 +278,18 @@ namespace mag
             return false;
         }
 
-        model.meshes[mesh_idx].base_index = model.indices.size();
-        model.meshes[mesh_idx].base_vertex = model.vertices.size();
-        model.meshes[mesh_idx].index_count = ai_mesh->mNumFaces * 3;
-        model.meshes[mesh_idx].material_index = ai_mesh->mMaterialIndex;
-        model.meshes[mesh_idx].aabb_min = {ai_mesh->mAABB.mMin.x, ai_mesh->mAABB.mMin.y, ai_mesh->mAABB.mMin.z};
-        model.meshes[mesh_idx].aabb_max = {ai_mesh->mAABB.mMax.x, ai_mesh->mAABB.mMax.y, ai_mesh->mAABB.mMax.z};
+        // Base vertex/index are only known after all meshes are loaded (see merge_meshes)
+        mesh.base_index = 0;
+        mesh.base_vertex = 0;
+        mesh.index_count = ai_mesh->mNumFaces * 3;
+        mesh.material_index = ai_mesh->mMaterialIndex;
+        mesh.aabb_min = {ai_mesh->mAABB.mMin.x, ai_mesh->mAABB.mMin.y, ai_mesh->mAABB.mMin.z};
+        mesh.aabb_max = {ai_mesh->mAABB.mMax.x, ai_mesh->mAABB.mMax.y, ai_mesh->mAABB.mMax.z};
 
-        std::vector<u32> indices(ai_mesh->mNumFaces * 3);
+        auto& indices = mesh_data.indices;
+        auto& vertices = mesh_data.vertices;
+
+        indices.resize(ai_mesh->mNumFaces * 3);
 
         // Indices
         for (u32 i = 0; i < ai_mesh->mNumFaces; i++)
@@ -212,7 +306,7 @@ namespace mag
             indices[i * 3 + 2] = face.mIndices[2];
         }
 
-        std::vector<Vertex> vertices(indices.size());
+        vertices.resize(indices.size());
 
         // Vertices - load with duplicates. The optimization step will create a better vertex/index buffer.
         for (u32 i = 0; i < indices.size(); i++)
@@ -230,12 +324,46 @@ namespace mag
         }
 
         // Optimize
-        optimize_mesh(vertices, indices, model);
+        optimize_mesh(mesh_data);
         return true;
     }
 
-    void ModelImporter::IMPL::optimize_mesh(std::vector<Vertex>& vertices, std::vector<u32>& indices, Model& model)
+    void ModelImporter::IMPL::merge_meshes(std::vector<MeshData>& meshes_data, Model& model) const
+    {
+        // Meshes are merged in their original order so the output does not depend on job scheduling
+        u64 vertex_count = 0;
+        u64 index_count = 0;
+        for (u32 m = 0; m < meshes_data.size(); m++)
+        {
+            model.meshes[m].base_vertex = vertex_count;
+            model.meshes[m].base_index = index_count;
+
+            vertex_count += meshes_data[m].vertices.size();
+            index_count += meshes_data[m].indices.size();
+        }
+
+        model.vertices.resize(vertex_count);
+        model.indices.resize(index_count);
+
+        for (u32 m = 0; m < meshes_data.size(); m++)
+        {
+            auto& mesh_data = meshes_data[m];
+
+            std::copy(mesh_data.vertices.begin(), mesh_data.vertices.end(),
+                      model.vertices.begin() + model.meshes[m].base_vertex);
+            std::copy(mesh_data.indices.begin(), mesh_data.indices.end(),
+                      model.indices.begin() + model.meshes[m].base_index);
+
+            // Release the mesh memory as soon as possible
+            mesh_data = {};
+        }
+    }
+
+    void ModelImporter::IMPL::optimize_mesh(MeshData& mesh_data) const
     {
+        auto& vertices = mesh_data.vertices;
+        auto& indices = mesh_data.indices;
+
         const u32 vertex_count = vertices.size();
         const u32 index_count = indices.size();
 
@@ -263,18 +391,20 @@ namespace mag
         meshopt_optimizeVertexFetch(optimized_vertices.data(), optimized_indices.data(), index_count,
                                     optimized_vertices.data(), optimized_vertex_count, sizeof(Vertex));
 
-        // Insert result into array
-        model.vertices.insert(model.vertices.end(), optimized_vertices.begin(), optimized_vertices.end());
-        model.indices.insert(model.indices.end(), optimized_indices.begin(), optimized_indices.end());
+        // Replace the mesh data with the optimized result
+        vertices = std::move(optimized_vertices);
+        indices = std::move(optimized_indices);
     }
 
-    void ModelImporter::IMPL::initialize_materials(const aiScene* ai_scene, const str& file_path,
-                                                   const str& output_directory, Model& model)
+    b8 ModelImporter::IMPL::initialize_materials(const aiScene* ai_scene, const str& file_path,
+                                                 const str& output_directory, Model& model)
     {
         const str model_directory = file_path.substr(0, file_path.find_last_of('/'));
 
         model.materials.resize(ai_scene->mNumMaterials);
 
+        // Build all material files first. Materials with the same name map to the same file, so only write it once.
+        std::map<str, json> materials_data;
         for (u32 i = 0; i < ai_scene->mNumMaterials; i++)
         {
             const aiMaterial* ai_material = ai_scene->mMaterials[i];
@@ -291,7 +421,11 @@ namespace mag
 
             model.materials[i] = material_file_path;
 
-            // Write material data to file
+            if (materials_data.contains(material_file_path))
+            {
+                continue;
+            }
+
             json data;
             data["Type"] = "Material";
             data["Name"] = material_name;
@@ -299,21 +433,91 @@ namespace mag
             data["Textures"]["Normal"] = find_texture(ai_material, aiTextureType_NORMALS, model_directory);
             data["Textures"]["Roughness"] = find_texture(ai_material, aiTextureType_DIFFUSE_ROUGHNESS, model_directory);
             data["Textures"]["Metalness"] = find_texture(ai_material, aiTextureType_METALNESS, model_directory);
+            data["Textures"]["AmbientOcclusion"] =
+                find_texture(ai_material, aiTextureType_AMBIENT_OCCLUSION, model_directory);
+
+            // Sampled by the shaders instead of the individual maps
+            const b8 has_roughness_metalness = data["Textures"]["Roughness"] != DEFAULT_ROUGHNESS_TEXTURE_NAME ||
+                                               data["Textures"]["Metalness"] != DEFAULT_METALNESS_TEXTURE_NAME ||
+                                               data["Textures"]["AmbientOcclusion"] != "";
+
+            data["Textures"]["RoughnessMetalness"] =
+                has_roughness_metalness ? output_directory + "/" + material_name + PACKED_TEXTURE_FILE_EXTENSION
+                                        : DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME;
+
+            materials_data[material_file_path] = data;
+        }
+
+        // Then pack the textures and write them all at once
+        TextureImporter texture_importer(&job_system);
+
+        std::vector<JobExecuteFn> material_jobs;
+        material_jobs.reserve(materials_data.size());
 
-            if (!fs::write_json_data(material_file_path, data))
+        for (auto& material : materials_data)
+        {
+            auto execute = [this, &material, &texture_importer]
+            {
+                const json& textures = material.second["Textures"];
+                const str packed_texture_path = textures["RoughnessMetalness"];
+
+                if (packed_texture_path != DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME &&
+                    !texture_importer.pack_roughness_metalness(textures["Roughness"], textures["Metalness"],
+                                                               textures["AmbientOcclusion"], packed_texture_path,
+                                                               packed_texture_format))
+                {
+                    return false;
+                }
+
+                if (!fs::write_json_data(material.first, material.second))
+                {
+                    LOG_ERROR("Failed to create material file: {0}", material.first);
+                    return false;
+                }
+
+                return true;
+            };
+
+            material_jobs.push_back(execute);
+        }
+
+        if (!job_system.execute_and_wait(material_jobs))
+        {
+            return false;
+        }
+
+        // Packed textures are cooked again when one of their sources changes (see AssetCooker)
+        std::set<str> packed_sources;
+        for (const auto& material : materials_data)
+        {
+            const json& textures = material.second["Textures"];
+            const str packed_texture_path = textures["RoughnessMetalness"];
+
+            outputs.push_back(material.first);
+            if (packed_texture_path == DEFAULT_ROUGHNESS_METALNESS_TEXTURE_NAME)
             {
-                LOG_ERROR("Failed to create material file: {0}", material_file_path);
                 continue;
             }
+
+            outputs.push_back(packed_texture_path);
+            const std::vector<str> sources = {textures["Roughness"], textures["Metalness"],
+                                              textures["AmbientOcclusion"]};
+            for (const auto& source : sources)
+            {
+                if (fs::exists(source))
+                {
+                    packed_sources.insert(fs::get_normalized_path(source).string());
+                }
+            }
         }
+
+        dependencies.insert(dependencies.end(), packed_sources.begin(), packed_sources.end());
+        return true;
     }
 
     const str ModelImporter::IMPL::find_texture(const aiMaterial* ai_material, aiTextureType ai_type,
                                                 const str& directory) const
     {
-        auto& app = get_application();
-        auto& material_manager = app.get_material_manager();
-
         const str material_name = ai_material->GetName().C_Str();
 
         // For some reason, assimp may identify normal textures as height textures
@@ -324,24 +528,31 @@ namespace mag
             texture_count = ai_material->GetTextureCount(ai_type);
         }
 
+        // And glTF occlusion textures as lightmaps
+        if (ai_type == aiTextureType_AMBIENT_OCCLUSION && texture_count == 0)
+        {
+            ai_type = aiTextureType_LIGHTMAP;
+            texture_count = ai_material->GetTextureCount(ai_type);
+        }
+
         str texture_name = "";
         switch (ai_type)
         {
             case aiTextureType_DIFFUSE:
-                texture_name = material_manager.get_default()->textures[TextureSlot::Albedo];
+                texture_name = DEFAULT_ALBEDO_TEXTURE_NAME;
                 break;
 
             case aiTextureType_NORMALS:
             case aiTextureType_HEIGHT:
-                texture_name = material_manager.get_default()->textures[TextureSlot::Normal];
+                texture_name = DEFAULT_NORMAL_TEXTURE_NAME;
                 break;
 
             case aiTextureType_DIFFUSE_ROUGHNESS:
-                texture_name = material_manager.get_default()->textures[TextureSlot::Roughness];
+                texture_name = DEFAULT_ROUGHNESS_TEXTURE_NAME;
                 break;
 
             case aiTextureType_METALNESS:
-                texture_name = material_manager.get_default()->textures[TextureSlot::Metalness];
+                texture_name = DEFAULT_METALNESS_TEXTURE_NAME;
                 break;
 
             default:
@@ -378,6 +589,10 @@ namespace mag
         return texture_name;
     }
 
+    const std::vector<str>& ModelImporter::get_dependencies() const { return impl->dependencies; }
+
+    const std::vector<str>& ModelImporter::get_outputs() const { return impl->outputs; }
+
     b8 ModelImporter::is_extension_supported(const str& extension_with_dot)
     {
         return impl->importer->IsExtensionSupported(extension_with_dot);
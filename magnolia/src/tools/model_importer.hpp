@@ -1,21 +1,34 @@
 #pragma once
 
+#include <vector>
+
 #include "core/types.hpp"
+#include "resources/image.hpp"
 
 namespace mag
 {
+    class JobSystem;
+
     struct Model;
     struct Vertex;
 
+    // The importer does not depend on the application, so it can also be used by offline tools (see magnolia_cook)
     class ModelImporter
     {
         public:
-            ModelImporter();
+            // Roughness, metalness and ambient occlusion maps of each material are packed into a single texture with
+            // the given format (see TextureImporter)
+            ModelImporter(JobSystem& job_system, const TextureFormat packed_texture_format = TextureFormat::RGBA8);
             ~ModelImporter();
 
             b8 import(const str& name, str& imported_model_path);
             b8 is_extension_supported(const str& extension_with_dot);
 
+            // Files read by the last import besides the model file (i.e. .bin/.mtl files and the packed textures
+            // sources) and every file it wrote
+            const std::vector<str>& get_dependencies() const;
+            const std::vector<str>& get_outputs() const;
+
         private:
             struct IMPL;
             unique<IMPL> impl;
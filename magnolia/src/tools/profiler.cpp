@@ -10,6 +10,8 @@ namespace mag
         auto& app = get_application();
         auto& window = app.get_window();
 
+        std::lock_guard<std::mutex> lock(results_mutex);
+
         if (!results.contains(name))
         {
             results[name] = {};
@@ -31,7 +33,11 @@ namespace mag
         }
     }
 
-    void ProfilerManager::clear_results() { results.clear(); }
+    void ProfilerManager::clear_results()
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        results.clear();
+    }
 
     const std::map<str, ProfileResult>& ProfilerManager::get_results() const { return results; }
 
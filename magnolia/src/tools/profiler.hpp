@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 
 #include "core/types.hpp"
 
@@ -28,6 +29,9 @@ namespace mag
         private:
             // Keep the results ordered
             std::map<str, ProfileResult> results = {};
+
+            // Passes may be profiled from the threads that record them (see RenderGraph)
+            std::mutex results_mutex;
     };
 
     class ScopedProfiler
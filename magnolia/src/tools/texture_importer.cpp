@@ -0,0 +1,228 @@
+#include "tools/texture_importer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/logger.hpp"
+#include "platform/file_system.hpp"
+#include "resources/image.hpp"
+#include "resources/mip_generator.hpp"
+#include "resources/resource_loader.hpp"
+#include "tools/block_compression.hpp"
+
+namespace mag
+{
+    struct TextureImporter::IMPL
+    {
+            IMPL(JobSystem* job_system);
+            ~IMPL() = default;
+
+            b8 encode(Image& image, const TextureFormat format, const str& output_file_path) const;
+            b8 load_source(const str& file_path, Image& image) const;
+            u8 get_channel(const Image& image, const u32 x, const u32 y, const u32 channel) const;
+
+            void expand_to_rgba(Image& image) const;
+            b8 has_translucency(const Image& image) const;
+
+            // Mips are split across the job system when there is one
+            JobSystem* job_system;
+    };
+
+    TextureImporter::IMPL::IMPL(JobSystem* job_system) : job_system(job_system) {}
+
+    TextureImporter::TextureImporter(JobSystem* job_system) : impl(new TextureImporter::IMPL(job_system)) {}
+    TextureImporter::~TextureImporter() = default;
+
+    b8 TextureImporter::import(const str& file_path, str& imported_texture_path, const TextureFormat format,
+                               const ColorSpace color_space)
+    {
+        Image image;
+        if (!resource::load(file_path, &image))
+        {
+            LOG_ERROR("Failed to import texture '{0}'", file_path);
+            return false;
+        }
+
+        // BC5 has no sRGB variant, it only holds data (normal maps)
+        image.color_space = format == TextureFormat::BC5 ? ColorSpace::Linear : color_space;
+
+        const str native_file_path = resource::get_native_texture_path(file_path);
+        if (!impl->encode(image, format, native_file_path))
+        {
+            LOG_ERROR("Failed to import texture '{0}'", file_path);
+            return false;
+        }
+
+        imported_texture_path = native_file_path;
+        return true;
+    }
+
+    b8 TextureImporter::pack_roughness_metalness(const str& roughness_path, const str& metalness_path,
+                                                 const str& ambient_occlusion_path, const str& output_file_path,
+                                                 const TextureFormat format)
+    {
+        Image roughness, metalness, ambient_occlusion;
+        if (!impl->load_source(roughness_path, roughness) || !impl->load_source(metalness_path, metalness) ||
+            !impl->load_source(ambient_occlusion_path, ambient_occlusion))
+        {
+            LOG_ERROR("Failed to pack roughness/metalness texture '{0}'", output_file_path);
+            return false;
+        }
+
+        // Sources may have different sizes, use the biggest one
+        Image image;
+        image.format = TextureFormat::RGBA8;
+        image.color_space = ColorSpace::Linear;
+        image.channels = 4;
+        image.width = std::max({roughness.width, metalness.width, ambient_occlusion.width});
+        image.height = std::max({roughness.height, metalness.height, ambient_occlusion.height});
+        image.mip_levels = static_cast<u32>(std::floor(std::log2(std::max(image.width, image.height)))) + 1;
+        image.pixels.resize(image.width * image.height * image.channels);
+
+        for (u32 y = 0; y < image.height; y++)
+        {
+            for (u32 x = 0; x < image.width; x++)
+            {
+                u8* out = image.pixels.data() + (y * image.width + x) * image.channels;
+
+                // Nearest sample of each source
+                out[0] = impl->get_channel(ambient_occlusion, x * ambient_occlusion.width / image.width,
+                                           y * ambient_occlusion.height / image.height, 0);
+                out[1] = impl->get_channel(roughness, x * roughness.width / image.width,
+                                           y * roughness.height / image.height, 1);
+                out[2] = impl->get_channel(metalness, x * metalness.width / image.width,
+                                           y * metalness.height / image.height, 2);
+                out[3] = 255;
+            }
+        }
+
+        if (!impl->encode(image, format, output_file_path))
+        {
+            LOG_ERROR("Failed to pack roughness/metalness texture '{0}'", output_file_path);
+            return false;
+        }
+
+        return true;
+    }
+
+    b8 TextureImporter::IMPL::encode(Image& image, const TextureFormat format, const str& output_file_path) const
+    {
+        // Mips of sRGB textures are filtered in linear space (same as the GPU blit), data is filtered as stored
+        mip::generate(image, image.color_space == ColorSpace::Srgb, job_system);
+
+        // Block compression and RGBA8 need all 4 channels
+        if (image.format != format && (is_block_compressed(format) || format == TextureFormat::RGBA8))
+        {
+            expand_to_rgba(image);
+        }
+
+        if (image.format != format && !is_block_compressed(format))
+        {
+            LOG_ERROR("Can't convert texture to an uncompressed format with fewer channels");
+            return false;
+        }
+
+        // The BC1 encoder is always opaque, so keep the alpha of translucent textures with BC3
+        TextureFormat compressed_format = format;
+        if (format == TextureFormat::BC1 && has_translucency(image))
+        {
+            compressed_format = TextureFormat::BC3;
+        }
+
+        if (!bc::compress(image, compressed_format))
+        {
+            LOG_ERROR("Failed to compress texture '{0}'", output_file_path);
+            return false;
+        }
+
+        const str output_directory = output_file_path.substr(0, output_file_path.find_last_of('/'));
+        if (!fs::create_directories(output_directory))
+        {
+            LOG_ERROR("Failed to create directory: '{0}'", output_directory);
+            return false;
+        }
+
+        return resource::save(output_file_path, &image);
+    }
+
+    b8 TextureImporter::IMPL::load_source(const str& file_path, Image& image) const
+    {
+        // Missing sources are a single pixel with the default values
+        if (file_path.empty() || file_path == DEFAULT_ROUGHNESS_TEXTURE_NAME ||
+            file_path == DEFAULT_METALNESS_TEXTURE_NAME)
+        {
+            image.format = TextureFormat::RGBA8;
+            image.channels = 4;
+            image.width = 1;
+            image.height = 1;
+            image.mip_levels = 1;
+            image.pixels = {255, 128, 0, 255};
+
+            return true;
+        }
+
+        return resource::load(file_path, &image);
+    }
+
+    u8 TextureImporter::IMPL::get_channel(const Image& image, const u32 x, const u32 y, const u32 channel) const
+    {
+        const u8* pixel = image.pixels.data() + (static_cast<u64>(y) * image.width + x) * image.channels;
+
+        // Same values as the sampled texture (see RendererImage)
+        switch (image.channels)
+        {
+            case 1:
+                return channel < 3 ? pixel[0] : 255;
+
+            case 2:
+                return channel < 3 ? pixel[0] : pixel[1];
+
+            default:
+                return pixel[channel];
+        }
+    }
+
+    void TextureImporter::IMPL::expand_to_rgba(Image& image) const
+    {
+        if (image.channels == 4)
+        {
+            return;
+        }
+
+        Image expanded = image;
+        expanded.format = TextureFormat::RGBA8;
+        expanded.channels = 4;
+        expanded.pixels.resize(image.pixels.size() / image.channels * expanded.channels);
+
+        for (u64 i = 0; i < image.pixels.size() / image.channels; i++)
+        {
+            const u8* src = image.pixels.data() + i * image.channels;
+            u8* dst = expanded.pixels.data() + i * expanded.channels;
+
+            dst[0] = dst[1] = dst[2] = src[0];
+            dst[3] = image.channels == 2 ? src[1] : 255;
+        }
+
+        image = std::move(expanded);
+    }
+
+    b8 TextureImporter::IMPL::has_translucency(const Image& image) const
+    {
+        if (image.channels != 4)
+        {
+            return false;
+        }
+
+        // The base level is enough
+        const u64 base_size = get_mip_size(image, 0);
+        for (u64 i = 3; i < base_size; i += 4)
+        {
+            if (image.pixels[i] != 255)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};  // namespace mag
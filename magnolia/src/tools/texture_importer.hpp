@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace mag
+{
+    class JobSystem;
+
+    struct Image;
+
+    enum class TextureFormat;
+    enum class ColorSpace;
+
+    // Converts images to the native texture format, with all mip levels precomputed and optionally block compressed.
+    // BC5 is meant for normal maps. Data textures are imported with the linear color space, so they are sampled as
+    // UNORM.
+    class TextureImporter
+    {
+        public:
+            TextureImporter(JobSystem* job_system = nullptr);
+            ~TextureImporter();
+
+            b8 import(const str& file_path, str& imported_texture_path, const TextureFormat format,
+                      const ColorSpace color_space);
+
+            // Packs the roughness, metalness and ambient occlusion maps into a single texture, using the same layout
+            // as glTF: R - ambient occlusion | G - roughness | B - metalness. Roughness is read from the green channel
+            // and metalness from the blue channel of the sources, so already packed textures keep their values.
+            // Missing sources (empty or the default texture names) are replaced by constant values. The packed texture
+            // holds data, so it is always linear.
+            b8 pack_roughness_metalness(const str& roughness_path, const str& metalness_path,
+                                        const str& ambient_occlusion_path, const str& output_file_path,
+                                        const TextureFormat format);
+
+        private:
+            struct IMPL;
+            unique<IMPL> impl;
+    };
+};  // namespace mag
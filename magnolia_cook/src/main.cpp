@@ -0,0 +1,146 @@
+#include <fmt/core.h>
+
+#include <chrono>
+#include <thread>
+
+#include "resources/image.hpp"
+#include "resources/mip_generator.hpp"
+#include "resources/resource_loader.hpp"
+#include "threads/job_system.hpp"
+#include "tools/asset_cooker.hpp"
+
+// Headless asset cooker. Converts every supported asset of a directory to the native formats.
+// Usage: magnolia_cook <asset_directory> [--force] [--no-compression] [--fast] [--pack <pack_file>]
+//        magnolia_cook --benchmark-mips <image_file>
+
+#define MIP_BENCHMARK_RUNS 10
+
+// Average time (in milliseconds) to decode the image and to generate its mips on the CPU. Only the CPU paths are
+// compared, the GPU blits are not measured.
+i32 benchmark_mips(const str& file_path, mag::JobSystem& job_system)
+{
+    using clock = std::chrono::steady_clock;
+
+    mag::Image image;
+
+    f64 decode_time = 0.0;
+    for (u32 i = 0; i < MIP_BENCHMARK_RUNS; i++)
+    {
+        const auto start = clock::now();
+        if (!mag::resource::load(file_path, &image))
+        {
+            fmt::print("Failed to load image '{0}'\n", file_path);
+            return 1;
+        }
+
+        decode_time += std::chrono::duration<f64, std::milli>(clock::now() - start).count();
+    }
+
+    if (mag::is_block_compressed(image.format) || image.pixels.size() >= mag::get_mip_chain_size(image))
+    {
+        fmt::print("Image '{0}' already has its mips\n", file_path);
+        return 1;
+    }
+
+    fmt::print("{0}: {1}x{2}, {3} channels, {4} mips\n", file_path, image.width, image.height, image.channels,
+               image.mip_levels);
+    fmt::print("Decode: {0:.2f} ms\n", decode_time / MIP_BENCHMARK_RUNS);
+
+    struct Mode
+    {
+            str name;
+            b8 srgb;
+            b8 use_simd;
+            mag::JobSystem* job_system;
+    };
+
+    const std::vector<Mode> modes = {{"Scalar", false, false, nullptr},
+                                     {"SIMD", false, true, nullptr},
+                                     {"SIMD + jobs", false, true, &job_system},
+                                     {"sRGB scalar", true, false, nullptr},
+                                     {"sRGB SIMD", true, true, nullptr},
+                                     {"sRGB SIMD + jobs", true, true, &job_system}};
+
+    for (const auto& mode : modes)
+    {
+        f64 time = 0.0;
+        for (u32 i = 0; i < MIP_BENCHMARK_RUNS; i++)
+        {
+            mag::Image mips = image;
+
+            const auto start = clock::now();
+            mag::mip::generate(mips, mode.srgb, mode.job_system, mode.use_simd);
+            time += std::chrono::duration<f64, std::milli>(clock::now() - start).count();
+        }
+
+        fmt::print("{0}: {1:.2f} ms\n", mode.name, time / MIP_BENCHMARK_RUNS);
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fmt::print("Usage: {0} <asset_directory> [--force] [--no-compression] [--fast] [--pack <pack_file>]\n",
+                   argv[0]);
+        fmt::print("       {0} --benchmark-mips <image_file>\n", argv[0]);
+        return 1;
+    }
+
+    if (str(argv[1]) == "--benchmark-mips")
+    {
+        if (argc < 3)
+        {
+            fmt::print("Missing image file\n");
+            return 1;
+        }
+
+        mag::JobSystem job_system(std::thread::hardware_concurrency());
+        return benchmark_mips(argv[2], job_system);
+    }
+
+    const str asset_directory = argv[1];
+
+    mag::CookOptions options;
+    for (i32 i = 2; i < argc; i++)
+    {
+        const str arg = argv[i];
+        if (arg == "--force")
+        {
+            options.force = true;
+        }
+
+        else if (arg == "--no-compression")
+        {
+            options.compress_textures = false;
+        }
+
+        else if (arg == "--fast")
+        {
+            options.fast_compression = true;
+        }
+
+        else if (arg == "--pack" && i + 1 < argc)
+        {
+            options.pack_file_path = argv[++i];
+        }
+
+        else
+        {
+            fmt::print("Unknown argument: '{0}'\n", arg);
+            return 1;
+        }
+    }
+
+    mag::JobSystem job_system(std::thread::hardware_concurrency());
+    mag::AssetCooker cooker(job_system);
+
+    const b8 result = cooker.cook(asset_directory, options);
+
+    const auto& statistics = cooker.get_statistics();
+    fmt::print("Cooked: {0}, skipped: {1}, failed: {2}\n", statistics.cooked, statistics.skipped, statistics.failed);
+
+    return result ? 0 : 1;
+}
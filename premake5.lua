@@ -228,6 +228,79 @@ project "sprout_editor"
         optimize "full" -- '-O3'
         runtime "release"
 
+-- Asset Cooker --------------------------------------------------------------------------------------------------------
+project "magnolia_cook"
+    targetname ("%{prj.name}_%{cfg.buildcfg}")
+    kind "consoleapp"
+
+    files
+    {
+        "%{prj.name}/src/**.hpp",
+        "%{prj.name}/src/**.cpp"
+    }
+
+    includedirs 
+    { 
+        "%{prj.name}/src",
+        "magnolia/src",
+
+        lib_includes
+    }
+
+    libdirs
+    { 
+        libdir
+    }
+
+    links
+    {
+        "magnolia", lib_links
+    }
+
+    filter "system:linux"
+        pic "on"
+        links
+        {
+            "vulkan", "sdl"
+        }
+
+    filter "system:windows"
+        systemversion "latest"
+
+        defines
+        {
+            "_CRT_SECURE_NO_WARNINGS"
+        }
+
+        links
+        {
+            "vulkan-1",
+            "SDL2",
+            "SDL2main",
+        }
+        -- entrypoint("mainCRTStartup")            
+        
+    filter "configurations:debug"
+        buildoptions { "-Wall", "-Wextra", "-ftime-trace" }
+        defines { "MAG_CONFIG_DEBUG=1", "MAG_ASSERTIONS_ENABLED=1", "MAG_PROFILE_ENABLED=1" }
+        symbols "on" -- '-g'
+        optimize "off" -- '-O0'
+        runtime "debug"
+
+    filter "configurations:profile"
+        defines { "NDEBUG", "MAG_CONFIG_PROFILE=1", "MAG_PROFILE_ENABLED=1" }
+        flags { build_flags }
+        symbols "off"
+        optimize "on" -- '-O2'
+        runtime "release"
+
+    filter "configurations:release"
+        defines { "NDEBUG", "MAG_CONFIG_RELEASE=1", "MAG_PROFILE_ENABLED=1" }
+        flags { build_flags }
+        symbols "off"
+        optimize "full" -- '-O3'
+        runtime "release"
+
 -- Scripting -----------------------------------------------------------------------------------------------------------
 local script_dir = "sprout_editor/assets/scripts/"
 local script_files = os.matchfiles(script_dir .. "*.cpp")
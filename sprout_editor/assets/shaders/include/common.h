@@ -12,6 +12,7 @@ using namespace mag::math;
 #else
 
     #define f32 float
+    #define u32 uint
     #define alignas(x)
 
 // See this: https://developer.nvidia.com/vulkan-shader-resource-binding
@@ -49,7 +50,10 @@ struct alignas(16) SpriteData
 
 struct alignas(16) MaterialData
 {
-        vec4 albedo;    // 16 bytes
-        f32 roughness;  // 4 bytes
-        f32 metallic;   // 4 bytes
+        vec4 albedo;                      // 16 bytes
+        f32 roughness;                    // 4 bytes
+        f32 metallic;                     // 4 bytes
+        u32 albedo_texture;               // 4 bytes - Bindless texture indices
+        u32 normal_texture;               // 4 bytes
+        u32 roughness_metalness_texture;  // 4 bytes
 };
@@ -67,6 +67,7 @@ float attenuation(vec3 light_position, vec3 frag_position)
 }
 
 vec3 pbr_shading(MaterialData material,
+                 float ambient_occlusion,
                  vec3 normal,
                  vec3 camera_position,
                  vec3 frag_position,
@@ -119,7 +120,7 @@ vec3 pbr_shading(MaterialData material,
     }   
     
     // @TODO: GI goes here
-    vec3 ambient = vec3(0.03) * material.albedo.rgb;
+    vec3 ambient = vec3(0.03) * material.albedo.rgb * ambient_occlusion;
     
     vec3 color = ambient + Lo;
 
@@ -22,6 +22,9 @@ vec3 calculate_normals_from_normal_map(vec3 texture_normal, vec3 vertex_normal,
 {
     vec3 tangent_normal = texture_normal * 2.0 - 1.0;
 
+    // Two channel normal maps (BC5) don't store z, so always reconstruct it
+    tangent_normal.z = sqrt(max(1.0 - dot(tangent_normal.xy, tangent_normal.xy), 0.0));
+
     vec3 Q1  = dFdx(frag_position);
     vec3 Q2  = dFdy(frag_position);
     vec2 st1 = dFdx(tex_coords);
@@ -17,15 +17,11 @@ void main()
 {
 	vec4 object_color = texture(ALBEDO_TEXTURE, in_tex_coords);
 	vec4 object_normal = texture(NORMAL_TEXTURE, in_tex_coords);
-	vec4 object_roughness = texture(ROUGHNESS_TEXTURE, in_tex_coords);
-	vec4 object_metalness = texture(METALNESS_TEXTURE, in_tex_coords);
+	vec4 object_roughness_metalness = texture(ROUGHNESS_METALNESS_TEXTURE, in_tex_coords);
 
-	// @TODO: we are loading all images (including normal maps) in the srgb format, but they should be
-	// loaded with the linear format. In the future, there should be a import or json file describing
-	// information about an images color space and other relevant data
-	object_normal.rgb = linear_to_srgb(object_normal.rgb);
-	object_roughness.rgb = linear_to_srgb(object_roughness.rgb);
-	object_metalness.rgb = linear_to_srgb(object_metalness.rgb);
+	float object_ambient_occlusion = object_roughness_metalness.r;
+	float object_roughness = object_roughness_metalness.g;
+	float object_metalness = object_roughness_metalness.b;
 
 	// @TODO: this is pretty slow, but for now its ok
 	vec3 camera_position = vec3(inverse(VIEW_MATRIX)[3]);
@@ -51,10 +47,11 @@ void main()
 	
 	MaterialData material = u_material.materials[u_push_constants.material_index];
 	material.albedo *= object_color;
-	material.roughness *= object_roughness.g;
-	material.metallic *= object_metalness.b;
+	material.roughness *= object_roughness;
+	material.metallic *= object_metalness;
 
 	pbr_color.rgb = pbr_shading(material,
+								object_ambient_occlusion,
 								normal,
 								camera_position,
 								in_frag_position,
@@ -97,12 +94,12 @@ void main()
 
 		// Roughness
 		case 5:
-			out_frag_color = vec4(object_roughness.g);
+			out_frag_color = vec4(object_roughness);
 			break;
 			
 		// Metalness
 		case 6:
-			out_frag_color = vec4(object_metalness.b);
+			out_frag_color = vec4(object_metalness);
 			break;
 
 		default:
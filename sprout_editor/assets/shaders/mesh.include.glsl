@@ -1,9 +1,12 @@
+#extension GL_EXT_nonuniform_qualifier : require
+
 #include "include/common.h"
 
-#define ALBEDO_TEXTURE u_material_textures[0]
-#define NORMAL_TEXTURE u_material_textures[1]
-#define ROUGHNESS_TEXTURE u_material_textures[2]
-#define METALNESS_TEXTURE u_material_textures[3]
+// The material of a draw is the same for all its invocations, so the indices don't need to be nonuniform
+#define MATERIAL u_material.materials[u_push_constants.material_index]
+#define ALBEDO_TEXTURE u_textures[MATERIAL.albedo_texture]
+#define NORMAL_TEXTURE u_textures[MATERIAL.normal_texture]
+#define ROUGHNESS_METALNESS_TEXTURE u_textures[MATERIAL.roughness_metalness_texture]
 
 // @TODO: for now, only fragment shaders support push constants
 // Push constants (dont exceed 128 bytes)
@@ -47,6 +50,6 @@ layout (std140, set = 3, binding = 0) readonly buffer MaterialBuffer
     MaterialData materials[];
 } u_material;
 
-// Material textures
-// 0 - Albedo | 1 - Normal
-layout (set = 4, binding = 0) uniform sampler2D u_material_textures[4];
+// Bindless textures, indexed by the materials
+// Albedo | Normal | Roughness/Metalness (R - AO, G - Roughness, B - Metalness)
+layout (set = 4, binding = 0) uniform sampler2D u_textures[];
@@ -31,6 +31,9 @@
 #include "renderer/renderer.hpp"
 #include "scene/scene_serializer.hpp"
 
+// Time spent merging the entities of the scenes being loaded each frame (in milliseconds)
+#define SCENE_LOAD_TIME_BUDGET 4.0
+
 mag::Application *mag::create_application() { return new sprout::Editor("sprout_editor/config.json"); }
 
 namespace sprout
@@ -57,6 +60,7 @@ namespace sprout
             unique<RenderGraph> render_graph;
             std::vector<ref<EditorScene>> open_scenes;
             std::vector<u32> open_scenes_marked_for_deletion;
+            std::vector<unique<SceneLoader>> scene_loaders;
 
             u32 selected_scene_index = 0;
             u32 next_scene_index = 0;
@@ -159,10 +163,7 @@ namespace sprout
 
         build_render_graph(window_size, get_viewport_size());
 
-        EditorScene *scene = new EditorScene();
-        scene::load("sprout_editor/assets/scenes/Test.mag.json", *scene);
-
-        add_scene(scene);
+        load_scene("sprout_editor/assets/scenes/Test.mag.json");
         set_active_scene(0);
     }
 
@@ -215,6 +216,19 @@ namespace sprout
             set_active_scene(impl->next_scene_index);
         }
 
+        // Merge the entities of the scenes being loaded
+        for (i32 i = impl->scene_loaders.size() - 1; i >= 0; i--)
+        {
+            auto &loader = impl->scene_loaders[i];
+            loader->update(SCENE_LOAD_TIME_BUDGET);
+
+            const SceneLoadState state = loader->get_state();
+            if (state == SceneLoadState::Finished || state == SceneLoadState::Failed)
+            {
+                impl->scene_loaders.erase(impl->scene_loaders.begin() + i);
+            }
+        }
+
         auto &active_scene = get_active_scene();
 
         // @TODO: this is a hack. We want to resize the editor viewport but we want to decouple the application from the
@@ -322,11 +336,37 @@ namespace sprout
 
     void Editor::add_scene(EditorScene *scene) { impl->open_scenes.emplace_back(scene); }
 
+    void Editor::load_scene(const str &file_path)
+    {
+        add_scene(new EditorScene());
+        impl->scene_loaders.push_back(create_unique<SceneLoader>(file_path, impl->open_scenes.back()));
+    }
+
     void Editor::close_scene(const ref<EditorScene> &scene)
     {
-        const str file_path = "sprout_editor/assets/scenes/" + scene->get_name() + ".mag.json";
+        // A scene that is still loading is incomplete and is not saved
+        b8 loading = false;
+        for (u32 i = 0; i < impl->scene_loaders.size(); i++)
+        {
+            if (impl->scene_loaders[i]->get_scene() == scene)
+            {
+                impl->scene_loaders.erase(impl->scene_loaders.begin() + i);
+                loading = true;
+                break;
+            }
+        }
 
-        scene::save(file_path, *scene);
+        if (loading)
+        {
+            LOG_WARNING("Scene '{0}' was closed before it finished loading and was not saved", scene->get_name());
+        }
+
+        else
+        {
+            const str file_path = "sprout_editor/assets/scenes/" + scene->get_name() + ".mag.json";
+
+            scene::save(file_path, *scene);
+        }
 
         // @TODO: linear search but w e. It is unlikely that this will hinder the performance
         u32 idx = Invalid_ID;
@@ -391,6 +431,8 @@ namespace sprout
     EditorScene &Editor::get_active_scene() { return *impl->open_scenes[impl->selected_scene_index]; }
     RenderGraph &Editor::get_render_graph() { return *impl->render_graph; }
     const std::vector<ref<EditorScene>> &Editor::get_open_scenes() const { return impl->open_scenes; }
+
+    const std::vector<unique<SceneLoader>> &Editor::get_scene_loaders() const { return impl->scene_loaders; }
     u32 Editor::get_selected_scene_index() const { return impl->selected_scene_index; }
     const uvec2 &Editor::get_viewport_size() const { return impl->viewport_panel->get_viewport_size(); }
 
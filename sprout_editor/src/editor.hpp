@@ -6,6 +6,7 @@ namespace mag
 {
     class RenderGraph;
     class RendererImage;
+    class SceneLoader;
 }  // namespace mag
 
 namespace sprout
@@ -27,6 +28,10 @@ namespace sprout
             virtual void on_event(const Event& e) override;
 
             void add_scene(EditorScene* scene);
+
+            // The scene is opened right away and filled in as it loads (see SceneLoader)
+            void load_scene(const str& file_path);
+
             void close_scene(const ref<EditorScene>& scene);
 
             void set_input_disabled(const b8 disable);
@@ -38,6 +43,7 @@ namespace sprout
             EditorScene& get_active_scene();
             RenderGraph& get_render_graph();
             const std::vector<ref<EditorScene>>& get_open_scenes() const;
+            const std::vector<unique<SceneLoader>>& get_scene_loaders() const;
             const uvec2& get_viewport_size() const;
             u32 get_selected_scene_index() const;
 
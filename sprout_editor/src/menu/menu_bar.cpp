@@ -94,8 +94,11 @@ namespace sprout
         auto& editor = get_editor();
         auto& scene = editor.get_active_scene();
 
-        const str& file_path = FileDialog::save_file("Save Scene As...", scene.get_name() + ".mag.json",
-                                                     {"Scene Files (.mag.json)", "*.mag.json"});
+        // Json is kept as an export format, the binary one is faster for big scenes
+        const str& file_path = FileDialog::save_file(
+            "Save Scene As...", scene.get_name() + SCENE_FILE_EXTENSION,
+            {"Scene Files (" SCENE_FILE_EXTENSION ")", "*" SCENE_FILE_EXTENSION, "Json Scene Files (.mag.json)",
+             "*.mag.json"});
 
         if (!file_path.empty())
         {
@@ -110,21 +113,18 @@ namespace sprout
     {
         auto& editor = get_editor();
 
-        const str file_path = FileDialog::open_file("Open Scene", {"Scene Files (.mag.json)", "*.mag.json"});
+        const str file_path = FileDialog::open_file(
+            "Open Scene", {"Scene Files (" SCENE_FILE_EXTENSION " .mag.json)", "*" SCENE_FILE_EXTENSION " *.mag.json"});
 
         if (!file_path.empty())
         {
-            EditorScene* scene = new EditorScene();
-
-            scene::load(file_path, *scene);
-
             scene_file_path = file_path;
 
             // @TODO: Check if scene isnt already opened.
 
-            editor.add_scene(scene);
+            editor.load_scene(file_path);
 
-            LOG_SUCCESS("Loaded scene '{0}' from {1}", scene->get_name(), file_path);
+            LOG_INFO("Loading scene from {0}", file_path);
         }
     }
 
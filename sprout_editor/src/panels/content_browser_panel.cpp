@@ -30,8 +30,9 @@ namespace sprout
         auto& renderer = app.get_renderer();
         auto& texture_manager = app.get_texture_manager();
 
-        auto folder_tex = texture_manager.get("sprout_editor/assets/images/fa-folder-solid.png");
-        auto file_tex = texture_manager.get("sprout_editor/assets/images/fa-file-solid.png");
+        // The ImGui descriptors reference the image views, so these can't be streamed
+        auto folder_tex = texture_manager.get("sprout_editor/assets/images/fa-folder-solid.png", false);
+        auto file_tex = texture_manager.get("sprout_editor/assets/images/fa-file-solid.png", false);
 
         impl->folder_image = renderer.get_renderer_image(folder_tex.get());
         impl->file_image = renderer.get_renderer_image(file_tex.get());
@@ -4,7 +4,14 @@
 #include "icon_font_cpp/IconsFontAwesome6.h"
 #include "implot/implot.h"
 #include "renderer/context.hpp"
+#include "renderer/descriptors.hpp"
+#include "renderer/geometry_arena.hpp"
 #include "renderer/render_graph.hpp"
+#include "renderer/renderer.hpp"
+#include "resources/image.hpp"
+#include "resources/material.hpp"
+#include "resources/model.hpp"
+#include "scene/scene_serializer.hpp"
 #include "tools/profiler.hpp"
 
 namespace sprout
@@ -107,19 +114,106 @@ namespace sprout
             {
                 const auto &performance = pass->get_performance_results();
                 final_performance_results.draw_calls += performance.draw_calls;
+                final_performance_results.draw_commands += performance.draw_commands;
                 final_performance_results.rendered_triangles += performance.rendered_triangles;
+                final_performance_results.state_changes += performance.state_changes;
+                final_performance_results.skipped_state_changes += performance.skipped_state_changes;
 
                 if (ImGui::CollapsingHeader(pass->get_name().c_str()))
                 {
                     ImGui::Text("Triangles: %u", performance.rendered_triangles);
-                    ImGui::Text("Draw Calls: %u", performance.draw_calls);
+                    ImGui::Text("Draw Calls: %u (%u indirect commands)", performance.draw_calls,
+                                performance.draw_commands);
+                    ImGui::Text("State Changes: %u (%u skipped)", performance.state_changes,
+                                performance.skipped_state_changes);
                 }
             }
 
             if (ImGui::CollapsingHeader("Final Results"))
             {
                 ImGui::Text("Triangles: %u", final_performance_results.rendered_triangles);
-                ImGui::Text("Draw Calls: %u", final_performance_results.draw_calls);
+                ImGui::Text("Draw Calls: %u (%u indirect commands)", final_performance_results.draw_calls,
+                            final_performance_results.draw_commands);
+                ImGui::Text("State Changes: %u (%u skipped)", final_performance_results.state_changes,
+                            final_performance_results.skipped_state_changes);
+            }
+        }
+
+        // Texture streaming
+        {
+            const auto &statistics = editor.get_texture_manager().get_streaming_statistics();
+
+            const f64 mib = 1024.0 * 1024.0;
+
+            ImGui::SeparatorText("Texture Streaming");
+            ImGui::Text("Resident: %.2f / %.2f MiB", statistics.resident_size / mib, statistics.budget / mib);
+            ImGui::Text("Streamed Textures: %u", statistics.streamed_textures);
+            ImGui::Text("Pending Loads: %u", statistics.pending_loads);
+            ImGui::Text("Evicted Textures: %u", statistics.evicted_textures);
+            ImGui::Text("Deduplicated Textures: %u (%.2f MiB saved)", statistics.deduplicated_textures,
+                        statistics.deduplicated_size / mib);
+        }
+
+        // Cached resources
+        {
+            const auto &model_statistics = editor.get_model_manager().get_statistics();
+            const auto &material_statistics = editor.get_material_manager().get_statistics();
+
+            const f64 mib = 1024.0 * 1024.0;
+
+            ImGui::SeparatorText("Resources");
+            ImGui::Text("Models: %u (%.2f / %.2f MiB)", model_statistics.resources, model_statistics.size / mib,
+                        model_statistics.budget / mib);
+            ImGui::Text("Materials: %u (%.2f / %.2f MiB)", material_statistics.resources,
+                        material_statistics.size / mib, material_statistics.budget / mib);
+            ImGui::Text("Evicted Models: %u", model_statistics.evicted_resources);
+            ImGui::Text("Evicted Materials: %u", material_statistics.evicted_resources);
+            ImGui::Text("Deduplicated Models: %u (%.2f MiB saved)", model_statistics.deduplicated_resources,
+                        model_statistics.deduplicated_size / mib);
+            ImGui::Text("Deduplicated Materials: %u (%.2f MiB saved)", material_statistics.deduplicated_resources,
+                        material_statistics.deduplicated_size / mib);
+        }
+
+        // Geometry of every uploaded model
+        {
+            const auto &statistics = get_application().get_renderer().get_geometry_statistics();
+
+            ImGui::SeparatorText("Geometry Arena");
+            ImGui::Text("Vertices: %u / %u", static_cast<u32>(statistics.used_vertices),
+                        static_cast<u32>(statistics.vertex_capacity));
+            ImGui::Text("Indices: %u / %u", static_cast<u32>(statistics.used_indices),
+                        static_cast<u32>(statistics.index_capacity));
+        }
+
+        // Descriptor pools, the frame allocator only holds the sets of the current frame
+        {
+            auto &mutable_context = get_context();
+
+            const auto &persistent = mutable_context.get_descriptor_allocator().get_statistics();
+            const auto &frame = mutable_context.get_frame_descriptor_allocator().get_statistics();
+
+            ImGui::SeparatorText("Descriptors");
+            ImGui::Text("Persistent Sets: %u / %u (peak %u)", static_cast<u32>(persistent.allocated_sets),
+                        static_cast<u32>(persistent.set_capacity), static_cast<u32>(persistent.peak_allocated_sets));
+            ImGui::Text("Persistent Pools: %u / %u (%u overflows)", persistent.used_pool_count, persistent.pool_count,
+                        persistent.pool_overflows);
+            ImGui::Text("Frame Sets: %u / %u (peak %u)", static_cast<u32>(frame.allocated_sets),
+                        static_cast<u32>(frame.set_capacity), static_cast<u32>(frame.peak_allocated_sets));
+            ImGui::Text("Frame Pools: %u / %u (%u overflows)", frame.used_pool_count, frame.pool_count,
+                        frame.pool_overflows);
+        }
+
+        // Scenes being loaded
+        if (!editor.get_scene_loaders().empty())
+        {
+            ImGui::SeparatorText("Scene Loading");
+
+            for (const auto &loader : editor.get_scene_loaders())
+            {
+                const b8 reading = loader->get_state() == SceneLoadState::Reading;
+
+                ImGui::Text("%s", loader->get_file_path().c_str());
+                ImGui::ProgressBar(loader->get_progress(), ImVec2(-1.0f, 0.0f), reading ? "Reading..." : nullptr);
             }
         }
 
@@ -90,7 +90,7 @@ namespace sprout
 #endif
                     // @TODO: cleanup
 
-                    // @TODO: might be better to recompile only changed shaders, not all of them
+                    // @NOTE: changed shaders are already recompiled automatically (see AssetGraph), this rebuilds all
                     const str rebuild_script = "python3 build.py shaders " + configuration;
                     if (system(rebuild_script.c_str()) == 0)
                     {
@@ -187,7 +187,9 @@ namespace sprout
                         const c8 *path = static_cast<const c8 *>(payload->Data);
                         const str extension = fs::get_file_extension(path);
 
-                        ModelImporter importer;
+                        auto &job_system = app.get_job_system();
+
+                        ModelImporter importer(job_system);
 
                         // First check if the path exists
                         if (!fs::exists(path))
@@ -201,6 +203,11 @@ namespace sprout
                             LOG_ERROR("Path is a directory: {0}", path);
                         }
 
+                        else if (str(path).ends_with(SCENE_FILE_EXTENSION))
+                        {
+                            editor.load_scene(path);
+                        }
+
                         // Check if asset is a json file
                         else if (extension == ".json")
                         {
@@ -219,11 +226,7 @@ namespace sprout
 
                             else if (type == "Scene")
                             {
-                                EditorScene *new_scene = new EditorScene();
-
-                                scene::load(path, *new_scene);
-
-                                editor.add_scene(new_scene);
+                                editor.load_scene(path);
                             }
 
                             else if (type == "Material")
@@ -237,14 +240,12 @@ namespace sprout
                         // Check if asset is a model that needs to be imported
                         else if (importer.is_extension_supported(extension))
                         {
-                            auto &job_system = app.get_job_system();
-
                             // This is a bit ugly but gets the job done (just don't forget to delete it)
                             str *imported_model_path = new str("");
 
-                            auto on_execute = [path, imported_model_path]
+                            auto on_execute = [path, imported_model_path, &job_system]
                             {
-                                ModelImporter importer;
+                                ModelImporter importer(job_system);
                                 return importer.import(path, *imported_model_path);
                             };
 
@@ -38,7 +38,7 @@ namespace sprout
     void EditorPass::on_render(RenderGraph& render_graph)
     {
         auto& context = get_context();
-        auto& cmd = context.get_curr_frame().command_buffer;
+        auto& cmd = context.get_command_buffer();
         auto& scene = get_editor().get_active_scene();
         auto& ecs = scene.get_ecs();
         auto& camera = scene.get_camera();
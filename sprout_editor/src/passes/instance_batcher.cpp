@@ -0,0 +1,101 @@
+#include "passes/instance_batcher.hpp"
+
+#include <algorithm>
+
+#include "camera/camera.hpp"
+#include "core/logger.hpp"
+#include "ecs/components.hpp"
+#include "math/type_definitions.hpp"
+#include "resources/model.hpp"
+
+namespace sprout
+{
+    void InstanceBatcher::build(const std::vector<std::tuple<TransformComponent*, ModelComponent*>>& model_entities,
+                                const Camera& camera)
+    {
+        entity_transforms.clear();
+        instances.clear();
+        transforms.clear();
+        batches.clear();
+        draw_commands.clear();
+
+        // Cull each mesh of each entity
+        for (u32 i = 0; i < model_entities.size(); i++)
+        {
+            const auto& transform = std::get<0>(model_entities[i]);
+            const auto& model = std::get<1>(model_entities[i])->model;
+
+            const u32 entity_index = entity_transforms.size();
+            entity_transforms.push_back(transform->get_transformation_matrix());
+
+            for (u32 m = 0; m < model->meshes.size(); m++)
+            {
+                const auto& mesh = model->meshes[m];
+
+                // @TODO: improve AABB calculation performance. I think its not a terrible ideia to apply the transform
+                // and use a dirty flag to recalculate the bounding box.
+
+                // Calculate transformed aabbs
+                BoundingBox mesh_aabb;
+                mesh_aabb.min = mesh.aabb_min;
+                mesh_aabb.max = mesh.aabb_max;
+                mesh_aabb = mesh_aabb.get_transformed_bounding_box(entity_transforms[entity_index]);
+
+                // Skip rendering if not visible
+                if (!camera.is_aabb_visible(mesh_aabb))
+                {
+                    continue;
+                }
+
+                instances.push_back({model.get(), mesh.material_index, m, entity_index});
+            }
+        }
+
+        // Equal meshes end up next to each other
+        std::sort(instances.begin(), instances.end(),
+                  [](const MeshInstance& a, const MeshInstance& b)
+                  {
+                      return std::tie(a.model, a.material_index, a.mesh_index, a.entity_index) <
+                             std::tie(b.model, b.material_index, b.mesh_index, b.entity_index);
+                  });
+
+        // Truncated after sorting, the dropped instances are the last in batch order
+        if (instances.size() > MAX_INSTANCES)
+        {
+            LOG_WARNING("Too many visible instances ({0}), only the first {1} are drawn", instances.size(),
+                        MAX_INSTANCES);
+            instances.resize(MAX_INSTANCES);
+        }
+
+        // Write the transforms contiguously and split them into batches
+        for (const auto& instance : instances)
+        {
+            const u32 instance_index = transforms.size();
+            transforms.push_back(entity_transforms[instance.entity_index]);
+
+            if (!batches.empty() && batches.back().model == instance.model &&
+                batches.back().mesh_index == instance.mesh_index)
+            {
+                batches.back().instance_count++;
+                continue;
+            }
+
+            batches.push_back({instance.model, instance.mesh_index, instance_index, 1});
+        }
+
+        for (const auto& batch : batches)
+        {
+            const auto& model = batch.model;
+            const auto& mesh = model->meshes[batch.mesh_index];
+
+            draw_commands.push_back({mesh.index_count, batch.instance_count, model->base_index + mesh.base_index,
+                                     static_cast<i32>(model->base_vertex + mesh.base_vertex), batch.first_instance});
+        }
+    }
+
+    const std::vector<math::mat4>& InstanceBatcher::get_transforms() const { return transforms; }
+
+    const std::vector<InstanceBatch>& InstanceBatcher::get_batches() const { return batches; }
+
+    const std::vector<DrawIndexedCommand>& InstanceBatcher::get_draw_commands() const { return draw_commands; }
+};  // namespace sprout
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+
+#include "core/types.hpp"
+#include "math/mat.hpp"
+#include "math/types.hpp"
+#include "renderer/buffers.hpp"
+#include "renderer/shader.hpp"
+
+namespace mag
+{
+    struct TransformComponent;
+    struct ModelComponent;
+    struct Model;
+
+    class Camera;
+};  // namespace mag
+
+namespace sprout
+{
+    using namespace mag;
+
+// One transform per element of the instance buffers
+#define MAX_INSTANCES MAX_STORAGE_BUFFER_ELEMENTS
+
+    // Visible instances of a mesh. Their transforms are contiguous, starting at 'first_instance'.
+    struct InstanceBatch
+    {
+            Model* model;
+            u32 mesh_index;
+            u32 first_instance;
+            u32 instance_count;
+    };
+
+    // Groups the visible meshes of the scene by (model, material, mesh), so each group is drawn with a single
+    // instanced draw. The batches of a model are sorted by material to avoid swapping materials between them.
+    class InstanceBatcher
+    {
+        public:
+            void build(const std::vector<std::tuple<TransformComponent*, ModelComponent*>>& model_entities,
+                       const Camera& camera);
+
+            // One transform per instance, in batch order
+            const std::vector<math::mat4>& get_transforms() const;
+            const std::vector<InstanceBatch>& get_batches() const;
+
+            // One command per batch, in the same order (see Renderer::draw_indexed_indirect)
+            const std::vector<DrawIndexedCommand>& get_draw_commands() const;
+
+        private:
+            struct MeshInstance
+            {
+                    Model* model;
+                    u32 material_index;
+                    u32 mesh_index;
+                    u32 entity_index;
+            };
+
+            std::vector<math::mat4> entity_transforms;
+            std::vector<MeshInstance> instances;
+
+            std::vector<math::mat4> transforms;
+            std::vector<InstanceBatch> batches;
+            std::vector<DrawIndexedCommand> draw_commands;
+    };
+};  // namespace sprout
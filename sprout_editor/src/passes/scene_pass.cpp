@@ -1,5 +1,8 @@
 #include "passes/scene_pass.hpp"
 
+#include <limits>
+#include <map>
+
 #include "../assets/shaders/include/common.h"
 #include "core/application.hpp"
 #include "editor.hpp"
@@ -7,7 +10,9 @@
 #include "math/generic.hpp"
 #include "math/type_definitions.hpp"
 #include "private/renderer_type_conversions.hpp"
+#include "renderer/bindless_textures.hpp"
 #include "renderer/render_graph.hpp"
+#include "renderer/render_queue.hpp"
 #include "renderer/renderer.hpp"
 #include "renderer/shader.hpp"
 #include "resources/image.hpp"
@@ -24,9 +29,15 @@ namespace sprout
         // Shaders
         depth_prepass_shader = shader_manager.get("sprout_editor/assets/shaders/depth_prepass_shader.mag.json");
 
+        depth_prepass_uniforms.view = depth_prepass_shader->get_handle("u_global", "view");
+        depth_prepass_uniforms.projection = depth_prepass_shader->get_handle("u_global", "projection");
+        depth_prepass_uniforms.near_far = depth_prepass_shader->get_handle("u_global", "near_far");
+        depth_prepass_uniforms.models = depth_prepass_shader->get_handle("u_instance", "models");
+
         add_output_attachment("OutputDepth", AttachmentType::DepthStencil, size);
 
         pass.size = size;
+        pass.record_in_parallel = true;
         pass.color_clear_value = vec4(0.0, 1.0, 1.0, 1.0);
         pass.depth_stencil_clear_value = vec2(1.0f, 1.0f);
     }
@@ -52,44 +63,26 @@ namespace sprout
 
         depth_prepass_shader->bind();
 
-        depth_prepass_shader->set_uniform("u_global", "view", value_ptr(camera.get_view()));
-        depth_prepass_shader->set_uniform("u_global", "projection", value_ptr(camera.get_projection()));
-        depth_prepass_shader->set_uniform("u_global", "near_far", value_ptr(camera.get_near_far()));
-
-        for (u32 i = 0; i < model_entities.size(); i++)
-        {
-            const auto& transform = std::get<0>(model_entities[i]);
-            const auto& model = std::get<1>(model_entities[i])->model;
+        depth_prepass_shader->set_uniform(depth_prepass_uniforms.view, camera.get_view());
+        depth_prepass_shader->set_uniform(depth_prepass_uniforms.projection, camera.get_projection());
+        depth_prepass_shader->set_uniform(depth_prepass_uniforms.near_far, camera.get_near_far());
 
-            // @TODO: hardcoded data offset (should the shader deal with this automagically?)
-            const auto& model_matrix = transform->get_transformation_matrix();
-            depth_prepass_shader->set_uniform("u_instance", "models", value_ptr(model_matrix), sizeof(mat4) * i);
+        // Every model lives in the same vertex and index buffers
+        renderer.bind_geometry();
 
-            renderer.bind_buffers(model.get());
+        instance_batcher.build(model_entities, camera);
 
-            for (auto& mesh : model->meshes)
-            {
-                // @TODO: improve AABB calculation performance. I think its not a terrible ideia to apply the transform
-                // and use a dirty flag to recalculate the bounding box.
+        const auto& transforms = instance_batcher.get_transforms();
+        depth_prepass_shader->set_uniform_array(depth_prepass_uniforms.models, transforms.data(), transforms.size());
 
-                // Calculate transformed aabbs
-                BoundingBox mesh_aabb;
-                mesh_aabb.min = mesh.aabb_min;
-                mesh_aabb.max = mesh.aabb_max;
-                mesh_aabb = mesh_aabb.get_transformed_bounding_box(model_matrix);
+        // Every batch is drawn with the same pipeline and descriptors
+        const auto& draw_commands = instance_batcher.get_draw_commands();
+        performance_results.draw_calls += renderer.draw_indexed_indirect(draw_commands.data(), draw_commands.size());
 
-                // Skip rendering if not visible
-                if (!camera.is_aabb_visible(mesh_aabb))
-                {
-                    continue;
-                }
-
-                // Draw the mesh
-                renderer.draw_indexed(mesh.index_count, 1, mesh.base_index, mesh.base_vertex, i);
-
-                performance_results.draw_calls++;
-                performance_results.rendered_triangles += mesh.index_count / 3;
-            }
+        for (const auto& command : draw_commands)
+        {
+            performance_results.draw_commands++;
+            performance_results.rendered_triangles += (command.index_count / 3) * command.instance_count;
         }
     }
 
@@ -102,6 +95,22 @@ namespace sprout
         mesh_shader = shader_manager.get("sprout_editor/assets/shaders/mesh_shader.mag.json");
         sprite_shader = shader_manager.get("sprout_editor/assets/shaders/sprite_shader.mag.json");
 
+        mesh_uniforms.view = mesh_shader->get_handle("u_global", "view");
+        mesh_uniforms.projection = mesh_shader->get_handle("u_global", "projection");
+        mesh_uniforms.near_far = mesh_shader->get_handle("u_global", "near_far");
+        mesh_uniforms.texture_output = mesh_shader->get_handle("u_push_constants", "texture_output");
+        mesh_uniforms.normal_output = mesh_shader->get_handle("u_push_constants", "normal_output");
+        mesh_uniforms.number_of_lights = mesh_shader->get_handle("u_push_constants", "number_of_lights");
+        mesh_uniforms.material_index = mesh_shader->get_handle("u_push_constants", "material_index");
+        mesh_uniforms.lights = mesh_shader->get_handle("u_lights", "lights");
+        mesh_uniforms.models = mesh_shader->get_handle("u_instance", "models");
+        mesh_uniforms.materials = mesh_shader->get_handle("u_material", "materials");
+
+        sprite_uniforms.view = sprite_shader->get_handle("u_global", "view");
+        sprite_uniforms.projection = sprite_shader->get_handle("u_global", "projection");
+        sprite_uniforms.screen_size = sprite_shader->get_handle("u_global", "screen_size");
+        sprite_uniforms.sprites = sprite_shader->get_handle("u_instance", "sprites");
+
         add_input_attachment("OutputDepth", AttachmentType::DepthStencil, size, AttachmentState::Load);
 
         add_output_attachment("OutputColorScene", AttachmentType::Color, size);
@@ -121,6 +130,7 @@ namespace sprout
         auto& app = get_application();
         auto& renderer = app.get_renderer();
         auto& material_manager = app.get_material_manager();
+        auto& texture_manager = app.get_texture_manager();
         auto& editor = get_editor();
         auto& scene = editor.get_active_scene();
         auto& ecs = scene.get_ecs();
@@ -136,21 +146,21 @@ namespace sprout
 
         mesh_shader->bind();
 
-        mesh_shader->set_uniform("u_global", "view", value_ptr(camera.get_view()));
-        mesh_shader->set_uniform("u_global", "projection", value_ptr(camera.get_projection()));
-        mesh_shader->set_uniform("u_global", "near_far", value_ptr(camera.get_near_far()));
-        mesh_shader->set_uniform("u_push_constants", "texture_output", &editor.get_texture_output());
-        mesh_shader->set_uniform("u_push_constants", "normal_output", &editor.get_normal_output());
+        mesh_shader->set_uniform(mesh_uniforms.view, camera.get_view());
+        mesh_shader->set_uniform(mesh_uniforms.projection, camera.get_projection());
+        mesh_shader->set_uniform(mesh_uniforms.near_far, camera.get_near_far());
+        mesh_shader->set_uniform(mesh_uniforms.texture_output, editor.get_texture_output());
+        mesh_shader->set_uniform(mesh_uniforms.normal_output, editor.get_normal_output());
 
         u32 l = 0;
         const u32 number_of_lights = light_entities.size();
-        mesh_shader->set_uniform("u_push_constants", "number_of_lights", &number_of_lights);
+        mesh_shader->set_uniform(mesh_uniforms.number_of_lights, number_of_lights);
 
         for (const auto& [transform, light] : light_entities)
         {
             LightData point_light = {light->color, light->intensity, transform->translation};
 
-            mesh_shader->set_uniform("u_lights", "lights", &point_light, sizeof(point_light) * l++);
+            mesh_shader->set_uniform(mesh_uniforms.lights, point_light, sizeof(point_light) * l++);
         }
 
         // Set light uniforms so vulkan stops complaining about unbound descriptor sets
@@ -159,96 +169,176 @@ namespace sprout
             static const LightData dummy_light = {.color = vec3(0), .intensity = 0, .position = vec3(0)};
             static const u32 num_lights = 1;
 
-            mesh_shader->set_uniform("u_push_constants", "number_of_lights", &num_lights);
-            mesh_shader->set_uniform("u_lights", "lights", &dummy_light);
+            mesh_shader->set_uniform(mesh_uniforms.number_of_lights, num_lights);
+            mesh_shader->set_uniform(mesh_uniforms.lights, dummy_light);
         }
 
-        for (u32 i = 0; i < model_entities.size(); i++)
-        {
-            const auto& transform = std::get<0>(model_entities[i]);
-            const auto& model = std::get<1>(model_entities[i])->model;
+        // Every model lives in the same vertex and index buffers
+        renderer.bind_geometry();
+
+        instance_batcher.build(model_entities, camera);
 
-            // @TODO: hardcoded data offset (should the shader deal with this automagically?)
-            const auto& model_matrix = transform->get_transformation_matrix();
-            mesh_shader->set_uniform("u_instance", "models", value_ptr(model_matrix), sizeof(mat4) * i);
+        const auto& transforms = instance_batcher.get_transforms();
+        mesh_shader->set_uniform_array(mesh_uniforms.models, transforms.data(), transforms.size());
 
-            renderer.bind_buffers(model.get());
+        // Sort the batches by material, then by model and depth (front to back). There are never more batches than
+        // instances, so the ids always fit in the sort keys.
+        const auto& batches = instance_batcher.get_batches();
+        const auto& draw_commands = instance_batcher.get_draw_commands();
 
-            i32 last_material_idx = -1;
-            for (auto& mesh : model->meshes)
+        std::map<Material*, u32> material_ids;
+        std::map<Model*, u32> geometry_ids;
+        std::vector<Material*> materials;
+
+        const vec3& camera_position = camera.get_position();
+        const f32 far = camera.get_near_far().y;
+
+        render_queue.clear();
+        for (u32 i = 0; i < batches.size(); i++)
+        {
+            const auto& batch = batches[i];
+            const auto& mesh = batch.model->meshes[batch.mesh_index];
+            const auto& material = material_manager.get(batch.model->materials[mesh.material_index]);
+
+            // Meshes of different models may use the same material
+            const auto [material_it, inserted] = material_ids.emplace(material.get(), materials.size());
+            if (inserted)
             {
-                // @TODO: improve AABB calculation performance. I think its not a terrible ideia to apply the transform
-                // and use a dirty flag to recalculate the bounding box.
+                materials.push_back(material.get());
+            }
+
+            const u32 geometry_id = geometry_ids.emplace(batch.model, geometry_ids.size()).first->second;
+            const f32 depth = length(vec3(transforms[batch.first_instance][3]) - camera_position) / far;
+
+            render_queue.push(RenderQueue::make_sort_key(0, 0, material_it->second, geometry_id, depth), i);
+        }
+
+        render_queue.sort();
 
-                // Calculate transformed aabbs
-                BoundingBox mesh_aabb;
-                mesh_aabb.min = mesh.aabb_min;
-                mesh_aabb.max = mesh.aabb_max;
-                mesh_aabb = mesh_aabb.get_transformed_bounding_box(model_matrix);
+        // Write the materials of the frame, the shader finds their textures in the bindless texture array. Textures
+        // that are not resident yet use the default texture.
+        const u32 default_texture_index = renderer.get_texture_index(texture_manager.get_default().get());
+
+        for (u32 material_id = 0; material_id < materials.size(); material_id++)
+        {
+            Material* material = materials[material_id];
 
-                // Skip rendering if not visible
-                if (!camera.is_aabb_visible(mesh_aabb))
+            u32 texture_indices[static_cast<u32>(TextureSlot::TextureCount)];
+            for (u32 slot = 0; slot < static_cast<u32>(TextureSlot::TextureCount); slot++)
+            {
+                texture_indices[slot] = default_texture_index;
+
+                auto texture_it = material->textures.find(static_cast<TextureSlot>(slot));
+                if (texture_it == material->textures.end())
                 {
                     continue;
                 }
 
-                // Set the material. The meshes are sorted by material index (see model loader), so we draw all meshes
-                // with the same material before swapping to the next one.
-                if (last_material_idx != static_cast<i32>(mesh.material_index))
+                // Only the albedo is a color, the other slots hold data
+                const ColorSpace color_space =
+                    static_cast<TextureSlot>(slot) == TextureSlot::Albedo ? ColorSpace::Srgb : ColorSpace::Linear;
+
+                Image* texture = texture_manager.get(texture_it->second, true, color_space).get();
+                const u32 texture_index = renderer.get_texture_index(texture);
+                if (texture_index != BINDLESS_INVALID_INDEX)
                 {
-                    last_material_idx = mesh.material_index;
-                    const auto& material = material_manager.get(model->materials[mesh.material_index]);
-
-                    // @TODO: hardcoded material parameters
-                    static MaterialData material_data;
-                    material_data.albedo = vec4(1, 1, 1, 1);
-                    material_data.roughness = 1;
-                    material_data.metallic = 1;
-
-                    mesh_shader->set_uniform("u_push_constants", "material_index", &mesh.material_index);
-                    mesh_shader->set_uniform("u_material", "materials", &material_data,
-                                             sizeof(MaterialData) * mesh.material_index);
-                    mesh_shader->set_material("u_material_textures", material.get());
+                    texture_indices[slot] = texture_index;
                 }
 
-                // Draw the mesh
-                renderer.draw_indexed(mesh.index_count, 1, mesh.base_index, mesh.base_vertex, i);
+                texture_manager.mark_as_used(texture);
+            }
+
+            // Keep visible materials and their textures resident
+            material_manager.mark_as_used(material);
+
+            if (material->loading_state == MaterialLoadingState::LoadingFinished)
+            {
+                material->loading_state = MaterialLoadingState::UploadedToGPU;
+            }
+
+            // @TODO: hardcoded material parameters
+            const MaterialData material_data = {
+                .albedo = vec4(1, 1, 1, 1),
+                .roughness = 1,
+                .metallic = 1,
+                .albedo_texture = texture_indices[static_cast<u32>(TextureSlot::Albedo)],
+                .normal_texture = texture_indices[static_cast<u32>(TextureSlot::Normal)],
+                .roughness_metalness_texture = texture_indices[static_cast<u32>(TextureSlot::RoughnessMetalness)]};
+
+            mesh_shader->set_uniform(mesh_uniforms.materials, material_data, sizeof(MaterialData) * material_id);
+        }
+
+        // Replay the queue, the material is only set when it changes. Draws between changes are submitted together.
+        sorted_draw_commands.clear();
+
+        u32 first_command = 0;
+        u32 last_material_id = std::numeric_limits<u32>::max();
+        for (const auto& packet : render_queue.get_packets())
+        {
+            const u32 material_id = RenderQueue::get_material(packet.sort_key);
+            if (material_id == last_material_id)
+            {
+                performance_results.skipped_state_changes++;
+            }
+
+            else
+            {
+                // Draw the mesh instances of the previous material
+                performance_results.draw_calls += renderer.draw_indexed_indirect(
+                    sorted_draw_commands.data() + first_command, sorted_draw_commands.size() - first_command);
+                first_command = sorted_draw_commands.size();
+
+                // Set the material, only its index changes
+                last_material_id = material_id;
+                mesh_shader->set_uniform(mesh_uniforms.material_index, material_id);
 
-                performance_results.draw_calls++;
-                performance_results.rendered_triangles += mesh.index_count / 3;
+                performance_results.state_changes++;
             }
+
+            const auto& command = draw_commands[packet.index];
+            sorted_draw_commands.push_back(command);
+
+            performance_results.draw_commands++;
+            performance_results.rendered_triangles += (command.index_count / 3) * command.instance_count;
         }
 
+        performance_results.draw_calls += renderer.draw_indexed_indirect(sorted_draw_commands.data() + first_command,
+                                                                         sorted_draw_commands.size() - first_command);
+
         // Render sprites
 
         sprite_shader->bind();
 
-        sprite_shader->set_uniform("u_global", "view", value_ptr(camera.get_view()));
-        sprite_shader->set_uniform("u_global", "projection", value_ptr(camera.get_projection()));
-        sprite_shader->set_uniform("u_global", "screen_size", value_ptr(pass.size));
+        sprite_shader->set_uniform(sprite_uniforms.view, camera.get_view());
+        sprite_shader->set_uniform(sprite_uniforms.projection, camera.get_projection());
+        sprite_shader->set_uniform(sprite_uniforms.screen_size, pass.size);
 
         for (u32 i = 0; i < sprite_entities.size(); i++)
         {
             const auto& transform = std::get<0>(sprite_entities[i]);
             const auto& sprite = std::get<1>(sprite_entities[i]);
 
-            // Remove rotation if sprite is aligned to the camera
-            const vec3 model_rotation = transform->rotation;
+            // Remove rotation if sprite is aligned to the camera. The component is not changed, the other passes may
+            // be reading it.
+            TransformComponent sprite_transform = *transform;
             if (sprite->always_face_camera)
             {
-                transform->rotation = vec3(0);
+                sprite_transform.rotation = vec3(0);
             }
 
-            const auto& sprite_tex = sprite->texture;
-
-            const auto model_matrix = transform->get_transformation_matrix();
+            const auto model_matrix = sprite_transform.get_transformation_matrix();
             const SpriteData sprite_data = {.model = model_matrix,
                                             .size_const_face = {sprite->texture->width, sprite->texture->height,
                                                                 sprite->constant_size, sprite->always_face_camera}};
 
-            transform->rotation = model_rotation;
+            sprite_shader->set_uniform(sprite_uniforms.sprites, sprite_data, sizeof(SpriteData) * i);
+        }
+
+        // The sprite data is uploaded once with the first draw
+        for (u32 i = 0; i < sprite_entities.size(); i++)
+        {
+            const auto& sprite_tex = std::get<1>(sprite_entities[i])->texture;
 
-            sprite_shader->set_uniform("u_instance", "sprites", &sprite_data, sizeof(SpriteData) * i);
             sprite_shader->set_texture("u_sprite_texture", sprite_tex.get());
 
             renderer.draw(6, 1, 0, i);
@@ -266,10 +356,13 @@ namespace sprout
         // Shaders
         post_shader = shader_manager.get("sprout_editor/assets/shaders/post_shader.mag.json");
 
+        post_uniforms.apply_tonemapping = post_shader->get_handle("u_push_constants", "apply_tonemapping");
+
         add_input_attachment("OutputColorScene", AttachmentType::Color, size, AttachmentState::Load);
         add_output_attachment("OutputColor", AttachmentType::Color, size);
 
         pass.size = size;
+        pass.record_in_parallel = true;
         pass.color_clear_value = vec4(0.1, 0.1, 0.1, 1.0);
         pass.depth_stencil_clear_value = vec2(1.0f, 1.0f);
     }
@@ -284,13 +377,14 @@ namespace sprout
 
         performance_results = {};
 
-        // Only apply post processing to the final combined result
-        const b8 apply_tonemapping = editor.get_texture_output() == 0;
-        post_shader->set_uniform("u_push_constants", "apply_tonemapping", &apply_tonemapping);
-
         auto& screen_color = render_graph.get_attachment("OutputColorScene");
 
         post_shader->bind();
+
+        // Only apply post processing to the final combined result (a shader bool is 4 bytes)
+        const u32 apply_tonemapping = editor.get_texture_output() == 0;
+        post_shader->set_uniform(post_uniforms.apply_tonemapping, apply_tonemapping);
+
         post_shader->set_texture("u_screen_color_texture", &screen_color);
 
         renderer.draw(6);
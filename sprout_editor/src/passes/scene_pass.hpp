@@ -1,11 +1,9 @@
 #pragma once
 
+#include "passes/instance_batcher.hpp"
 #include "renderer/render_graph.hpp"
-
-namespace mag
-{
-    class Shader;
-};
+#include "renderer/render_queue.hpp"
+#include "renderer/shader.hpp"
 
 namespace sprout
 {
@@ -21,6 +19,13 @@ namespace sprout
 
         private:
             ref<Shader> depth_prepass_shader;
+            InstanceBatcher instance_batcher;
+
+            // Resolved once in the constructor
+            struct
+            {
+                    UniformHandle view, projection, near_far, models;
+            } depth_prepass_uniforms;
     };
 
     class ScenePass : public RenderGraphPass
@@ -34,6 +39,21 @@ namespace sprout
         private:
             ref<Shader> mesh_shader;
             ref<Shader> sprite_shader;
+            InstanceBatcher instance_batcher;
+
+            // Resolved once in the constructor
+            struct
+            {
+                    UniformHandle view, projection, near_far, texture_output, normal_output, number_of_lights,
+                        material_index, lights, models, materials;
+            } mesh_uniforms;
+
+            struct
+            {
+                    UniformHandle view, projection, screen_size, sprites;
+            } sprite_uniforms;
+            RenderQueue render_queue;
+            std::vector<DrawIndexedCommand> sorted_draw_commands;
     };
 
     class PostProcessingPass : public RenderGraphPass
@@ -46,5 +66,11 @@ namespace sprout
 
         private:
             ref<Shader> post_shader;
+
+            // Resolved once in the constructor
+            struct
+            {
+                    UniformHandle apply_tonemapping;
+            } post_uniforms;
     };
 };  // namespace sprout